@@ -6,329 +6,13 @@
 // For the original code, see github.com/munificient/smallpt
 // For the original license, see smallpt.LICENSE.txt
 
-#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 
-#define SYCL_SIMPLE_SWIZZLES
-#include <CL/sycl.hpp>
-
-#include "classes.h"
+#include "sycl_gtx_kernel.h"
 #include "win.h"
 
-#ifndef float_type
-#define float_type double
-#endif
-#ifndef modify_sample_rate
-#define modify_sample_rate 1
-#endif
-
-using Vec = Vec_detail<float_type>;
-using Ray = Ray_detail<float_type>;
-using Sphere = Sphere_detail<float_type, modify_sample_rate>;
-
-#ifndef SYCL_GTX
-#include <CL/sycl_gtx_compatibility.h>
-#endif
-
-namespace ns_sycl_gtx {
-
-using namespace cl::sycl;
-
-static const int numSpheres = 9;
-static Sphere spheres[numSpheres] = {
-    // Scene: radius, position, emission, color, material
-    Sphere(1e4, Vec(1e4 + 1, 40.8, 81.6), Vec(), Vec(.75, .25, .25),
-           DIFF),  // Left
-    Sphere(1e4, Vec(-1e4 + 99, 40.8, 81.6), Vec(), Vec(.25, .25, .75),
-           DIFF),                                                      // Rght
-    Sphere(1e4, Vec(50, 40.8, 1e4), Vec(), Vec(.75, .75, .75), DIFF),  // Back
-    Sphere(1e4, Vec(50, 40.8, -1e4 + 170), Vec(), Vec(), DIFF),        // Frnt
-    Sphere(1e4, Vec(50, 1e4, 81.6), Vec(), Vec(.75, .75, .75), DIFF),  // Botm
-    Sphere(1e4, Vec(50, -1e4 + 81.6, 81.6), Vec(), Vec(.75, .75, .75),
-           DIFF),                                                       // Top
-    Sphere(16.5, Vec(27, 16.5, 47), Vec(), Vec(1, 1, 1) * .999, SPEC),  // Mirr
-    Sphere(16.5, Vec(73, 16.5, 78), Vec(), Vec(1, 1, 1) * .999, REFR),  // Glas
-    Sphere(600, Vec(50, 681.6 - .27, 81.6), Vec(12, 12, 12), Vec(),
-           DIFF)  // Lite
-};
-
-using spheres_t =
-    accessor<float16, 1, access::mode::read, access::target::global_buffer>;
-
-struct Vector : public ::Vec_detail<float1> {
- private:
-  using Base = ::Vec_detail<float1>;
-
- public:
-  Vector(float x = 0, float y = 0, float z = 0) : Base(x, y, z) {}
-  Vector(const ::Vec_detail<float_type>& base)
-      : Base(static_cast<float>(base.x), static_cast<float>(base.y),
-             static_cast<float>(base.z)) {}
-  template <typename t = float1>
-  Vector(const Base& base,
-         typename std::enable_if<!std::is_same<t, float_type>::value>::type* =
-             nullptr)
-      : Base(base) {}
-  Vector(float3 data) : Base(data.x(), data.y(), data.z()) {}
-};
-
-using RaySycl = ::Ray_detail<float1>;
-
-struct SphereSycl : public ::Sphere_detail<float1> {
-  float1 refl;
-
-  SphereSycl(const float16& data)
-      : ::Sphere_detail<float1>(
-            data.lo().lo().w(), Vector(data.lo().lo().xyz()),
-            Vector(data.lo().hi().xyz()), Vector(data.hi().lo().xyz()),
-            Refl_t::DIFF  // Not important
-            ),
-        refl(data.hi().lo().w()) {}
-
-  float1 intersect(
-      const Ray_detail<float1>& r) const {  // returns distance, 0 if no hit
-    float1 return_vec;
-    Vector op = p - r.o;  // Solve t^2*d.d + 2*t*(o-p).d + (o-p).(o-p)-R^2 = 0
-    float1 t;
-    float1 eps = 1e-2f;
-    float1 b = op.dot(r.d);
-    float1 det = b * b - op.dot(op) + rad * rad;
-
-    SYCL_IF(det < 0) {
-      return_vec = 0;
-    }
-    SYCL_ELSE {
-      det = cl::sycl::sqrt(det);
-      t = b - det;
-      SYCL_IF(t > eps) {
-        return_vec = t;
-      }
-      SYCL_ELSE {
-        t = b + det;
-        SYCL_IF(t > eps) {
-          return_vec = t;
-        }
-        SYCL_ELSE {
-          return_vec = 0;
-        }
-        SYCL_END;
-      }
-      SYCL_END;
-    }
-    SYCL_END;
-
-    return return_vec;
-  }
-};
-
-inline void clamp(float1& x) {
-  SYCL_IF(x < 0) {
-    x = 0;
-  }
-  SYCL_ELSE_IF(x > 1) {
-    x = 1;
-  }
-  SYCL_END;
-}
-
-inline bool1 intersect(spheres_t spheres, const RaySycl& r, float1& t,
-                       int1& id) {
-  using namespace cl::sycl;
-  float1 d;
-  float1 inf = t = 1e20f;
-
-  int1 i = ns_sycl_gtx::numSpheres;
-  SYCL_WHILE(i > 0) {
-    i -= 1;
-    d = SphereSycl(spheres[i]).intersect(r);
-    SYCL_IF(d != 0 && d < t) {
-      t = d;
-      id = i;
-    }
-    SYCL_END;
-  }
-  SYCL_END;
-
-  return t < inf;
-}
-
-// http://stackoverflow.com/a/16077942
-static float1 getRandom(uint2& seed) {
-  // Note: Should not be declared static
-  const float1 invMaxInt = 1.0f / 4294967296.0f;
-  uint1 x = seed.x() * 17 + seed.y() * 13123;
-  seed.x() = (x << 13) ^ x;
-  seed.y() = seed.y() ^ x << 7;
-  return static_cast<float1>((x * (x * x * 15731 + 74323) + 871483) *
-                             invMaxInt);
-}
-
-static void radiance(Vector& return_vec, spheres_t spheres, RaySycl r,
-                     uint2& randomSeed, Vector cl = {0, 0, 0},
-                     Vector cf = {1, 1, 1}) {
-  using namespace cl::sycl;
-
-  float1 t;     // distance to intersection
-  int1 id = 0;  // id of intersected object
-  int1 depth = 0;
-
-  // cl is accumulated color
-  // cf is accumulated reflectance
-
-  RaySycl reflRay(Vector(0), Vector(0));
-  Vector x, tdir;
-
-  SYCL_WHILE(true) {
-    SYCL_IF(!intersect(spheres, r, t, id)) {
-      // if miss, don't add anything
-      return_vec = cl;
-      SYCL_BREAK;
-    }
-    SYCL_END;
-
-    auto obj = SphereSycl(spheres[id]);  // the hit object
-    x = r.o + r.d * t;
-
-    Vector n = Vector(x - obj.p).norm();
-    Vector nl = n;
-    SYCL_IF(n.dot(r.d) > 0) {
-      nl = nl * -1;
-    }
-    SYCL_END;
-
-    Vector f = obj.c;
-
-    float1 p;  // max refl
-    SYCL_IF(f.x > f.y && f.x > f.z) {
-      p = f.x;
-    }
-    SYCL_ELSE_IF(f.y > f.z) {
-      p = f.y;
-    }
-    SYCL_ELSE {
-      p = f.z;
-    }
-    SYCL_END;
-
-    cl = cl + cf.mult(obj.e);
-
-    depth += 1;
-    SYCL_IF(depth > 5) {
-      SYCL_IF(getRandom(randomSeed) < p) {
-        f = f * (1 / p);
-      }
-      SYCL_ELSE {
-        return_vec = cl;
-        SYCL_BREAK;
-      }
-      SYCL_END;
-    }
-    SYCL_END;
-
-    cf = cf.mult(f);
-
-    SYCL_IF(obj.refl == (::cl_float)DIFF) {  // Ideal DIFFUSE reflection
-      float1 r1 = static_cast<float1>(2 * M_PI * getRandom(randomSeed));
-      float1 r2 = getRandom(randomSeed);
-      float1 r2s = cl::sycl::sqrt(r2);
-      Vector w = nl;
-
-      Vector u(0, 0, 0);
-      SYCL_IF(cl::sycl::fabs(w.x) > .1f) {
-        u.y = 1;
-      }
-      SYCL_ELSE {
-        u.x = 1;
-      }
-      SYCL_END;
-      u = (u % w).norm();
-
-      Vector v = w % u;
-      Vector d =
-          Vector(u * cl::sycl::cos(r1) * r2s + v * cl::sycl::sin(r1) * r2s +
-                 w * cl::sycl::sqrt(1 - r2))
-              .norm();
-
-      // Recursion
-      r = RaySycl(x, d);
-      SYCL_CONTINUE;
-    }
-    SYCL_ELSE_IF(obj.refl == (::cl_float)SPEC) {  // Ideal SPECULAR reflection
-      // Recursion
-      r = RaySycl(x, r.d - n * 2 * n.dot(r.d));
-      SYCL_CONTINUE;
-    }
-    SYCL_END;
-
-    reflRay =
-        RaySycl(x, r.d - n * 2 * n.dot(r.d));  // Ideal dielectric REFRACTION
-    bool1 into = n.dot(nl) > 0;                // Ray from outside going in?
-    float1 nc = 1;
-    float1 nt = 1.5f;
-
-    float1 nnt;
-    SYCL_IF(into) {
-      nnt = nc / nt;
-    }
-    SYCL_ELSE {
-      nnt = nt / nc;
-    }
-    SYCL_END;
-
-    float1 ddn = r.d.dot(nl);
-    float1 cos2t = 1 - nnt * nnt * (1 - ddn * ddn);
-    SYCL_IF(cos2t < 0) {  // Total internal reflection
-      // Recursion
-      r = reflRay;
-      SYCL_CONTINUE;
-    }
-    SYCL_END;
-
-    float1 tmp = 1;
-    SYCL_IF(!into) {
-      tmp = -1;
-    }
-    SYCL_END;
-
-    tdir = Vector(r.d * nnt - n * (tmp * (ddn * nnt + cl::sycl::sqrt(cos2t))))
-               .norm();
-    float1 a = nt - nc;
-    float1 b = nt + nc;
-    float1 R0 = a * a / (b * b);
-
-    float1 c = 1;
-    SYCL_IF(into) {
-      c += ddn;
-    }
-    SYCL_ELSE {
-      c -= tdir.dot(n);
-    }
-    SYCL_END;
-
-    float1 Re = R0 + (1 - R0) * c * c * c * c * c;
-    float1 Tr = 1 - Re;
-    float1 P = .25f + .5f * Re;
-    float1 RP = Re / P;
-    float1 TP = Tr / (1 - P);
-
-    // Tail recursion
-    SYCL_IF(getRandom(randomSeed) < P) {
-      cf = cf * RP;
-      r = reflRay;
-    }
-    SYCL_ELSE {
-      cf = cf * TP;
-      r = RaySycl(x, tdir);
-    }
-    SYCL_END;
-  }
-  SYCL_END;
-}
-
-}  // namespace ns_sycl_gtx
-
 static void compute_sycl_gtx(void* dev, int w, int h, int samps, Ray cameraRay,
                              Vec cxIn, Vec cyIn, Vec rIn, Vec* cVecOut) {
   using namespace std;
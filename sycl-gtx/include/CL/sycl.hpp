@@ -17,6 +17,7 @@
 #include "SYCL/program.h"
 #include "SYCL/queue.h"
 #include "SYCL/ranges.h"
+#include "SYCL/scalar_arg.h"
 #include "SYCL/vectors/swizzled_vec.h"
 #include "SYCL/vectors/vec.h"
 #include "SYCL/workitem_functions.h"
@@ -8,6 +8,9 @@
 namespace cl {
 namespace sycl {
 
+// Forward declaration
+class handler;
+
 namespace detail {
 
 // Forward declaration
@@ -43,6 +46,7 @@ class accessor_core : public accessor_base {
   virtual ~accessor_core() = default;
 
  protected:
+  friend class ::cl::sycl::handler;
   friend class kernel_ns::source;
 
   virtual void* resource() const {
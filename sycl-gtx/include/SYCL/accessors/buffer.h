@@ -11,36 +11,43 @@ namespace cl {
 namespace sycl {
 
 // Forward declarations
-template <typename DataType, int dimensions>
-struct buffer;
 class handler;
+namespace detail {
+template <typename DataType, int dimensions>
+class buffer_detail;
+}  // namespace detail
 
 #if MSVC_2013_OR_LOWER
 #define SYCL_ADD_ACCESSOR_BUFFER(mode, target)                                \
   SYCL_ADD_ACCESSOR(mode, target) {                                           \
     using Base = detail::accessor_detail<DataType, dimensions, mode, target>; \
+    using buffer_t = detail::buffer_detail<DataType, dimensions>;             \
                                                                               \
    public:                                                                    \
-    accessor(buffer<DataType, dimensions>& bufferRef,                         \
-             handler& commandGroupHandler)                                    \
+    accessor(buffer_t& bufferRef, handler& commandGroupHandler)               \
         : Base(bufferRef, commandGroupHandler) {}                             \
-    accessor(buffer<DataType, dimensions>& bufferRef,                         \
-             handler& commandGroupHandler, range<dimensions> offset,          \
-             range<dimensions> range)                                         \
+    accessor(buffer_t& bufferRef, handler& commandGroupHandler,               \
+             range<dimensions> offset, range<dimensions> range)               \
         : Base(bufferRef, commandGroupHandler, offset, range) {}              \
     accessor(Base&& move) : Base(std::move(move)) {}                          \
   };
-#define SYCL_ADD_ACCESSOR_HOST_BUFFER(mode)                                \
-  SYCL_ADD_ACCESSOR(mode, access::target::host_buffer) {                   \
-    using Base = detail::accessor_detail<DataType, dimensions, mode,       \
-                                         access::target::host_buffer>;     \
-                                                                           \
-   public:                                                                 \
-    accessor(buffer<DataType, dimensions>& bufferRef) : Base(bufferRef) {} \
-    accessor(buffer<DataType, dimensions>& bufferRef,                      \
-             range<dimensions> offset, range<dimensions> range)            \
-        : Base(bufferRef, offset, range) {}                                \
-    accessor(Base&& move) : Base(std::move(move)) {}                       \
+#define SYCL_ADD_ACCESSOR_HOST_BUFFER(mode)                            \
+  SYCL_ADD_ACCESSOR(mode, access::target::host_buffer) {               \
+    using Base = detail::accessor_detail<DataType, dimensions, mode,   \
+                                         access::target::host_buffer>; \
+    using buffer_t = detail::buffer_detail<DataType, dimensions>;      \
+                                                                       \
+   public:                                                             \
+    accessor(buffer_t& bufferRef) : Base(bufferRef) {}                 \
+    accessor(buffer_t& bufferRef, range<dimensions> offset,            \
+             range<dimensions> range)                                  \
+        : Base(bufferRef, offset, range) {}                            \
+    accessor(buffer_t& bufferRef, handler& commandGroupHandler)        \
+        : Base(bufferRef, commandGroupHandler) {}                      \
+    accessor(buffer_t& bufferRef, handler& commandGroupHandler,        \
+             range<dimensions> offset, range<dimensions> range)        \
+        : Base(bufferRef, commandGroupHandler, offset, range) {}       \
+    accessor(Base&& move) : Base(std::move(move)) {}                   \
   };
 #else
 #define SYCL_ADD_ACCESSOR_BUFFER(mode, target)                                \
@@ -7,12 +7,14 @@ namespace cl {
 namespace sycl {
 
 // Forward declarations
-template <typename DataType, int dimensions>
-struct buffer;
 class handler;
 
 namespace detail {
 
+// Forward declaration
+template <typename DataType, int dimensions>
+class buffer_detail;
+
 /**
  * Core buffer accessor class
  *
@@ -21,13 +23,14 @@ namespace detail {
 template <typename DataType, int dimensions>
 class accessor_buffer {
  protected:
-  buffer<DataType, dimensions>* buf;
+  // Whatever allocator the buffer uses
+  buffer_detail<DataType, dimensions>* buf;
   handler* commandGroupHandler;
   range<dimensions> offset;
   range<dimensions> rang;
 
  public:
-  accessor_buffer(buffer<DataType, dimensions>& bufferRef,
+  accessor_buffer(buffer_detail<DataType, dimensions>& bufferRef,
                   handler* commandGroupHandler, range<dimensions> offset,
                   range<dimensions> range)
       : buf(&bufferRef),
@@ -42,6 +45,10 @@ class accessor_buffer {
   ::size_t access_buffer_range(int n) const {
     return buf->rang.get(n);
   }
+  /** Differs from the buffer range for sub-buffers */
+  ::size_t access_host_range(int n) const {
+    return buf->host_rang.get(n);
+  }
   typename base_host_data<DataType>::type* access_host_data() const {
     return buf->host_data.get();
   }
@@ -32,13 +32,13 @@ SYCL_ACCESSOR_CLASS(target == access::target::constant_buffer ||
       accessor_device_ref<dimensions, DataType, dimensions, mode, target>;
 
  public:
-  accessor_detail(cl::sycl::buffer<DataType, dimensions> & bufferRef,
+  accessor_detail(buffer_detail<DataType, dimensions> & bufferRef,
                   handler & commandGroupHandler, range<dimensions> offset,
                   range<dimensions> range)
       : base_acc_buffer(bufferRef, &commandGroupHandler, offset, range),
         base_acc_device_ref(this, {}) {}
 
-  accessor_detail(cl::sycl::buffer<DataType, dimensions> & bufferRef,
+  accessor_detail(buffer_detail<DataType, dimensions> & bufferRef,
                   handler & commandGroupHandler)
       : accessor_detail(bufferRef, commandGroupHandler,
                         detail::empty_range<dimensions>(),
@@ -71,7 +71,7 @@ SYCL_ACCESSOR_CLASS(target == access::target::constant_buffer ||
 
   return_t operator[](id<dimensions> index) const {
     auto resource_name = kernel_ns::register_resource(*this);
-    return return_t(resource_name + "[" + data_ref::get_name(index) + "]");
+    return return_t(ir::subscript(resource_name, data_ref::get_name(index)));
   }
 
  private:
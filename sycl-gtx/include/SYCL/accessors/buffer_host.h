@@ -59,7 +59,7 @@ class accessor_host_ref<1, DataType, dimensions, mode> {
     int multiplier = 1;
     for (int i = 0; i < dimensions; ++i) {
       index += static_cast<int>(rang[i] * multiplier);
-      multiplier *= static_cast<int>(parent->access_buffer_range(i));
+      multiplier *= static_cast<int>(parent->access_host_range(i));
     }
     return parent->access_host_data()[index];
   }
@@ -76,27 +76,45 @@ SYCL_ACCESSOR_CLASS(target == access::target::host_buffer)
       accessor_host_ref<dimensions, DataType, dimensions, mode>;
 
  public:
-  accessor_detail(buffer<DataType, dimensions> & bufferRef,
+  accessor_detail(buffer_detail<DataType, dimensions> & bufferRef,
                   range<dimensions> offset, range<dimensions> range)
       : base_acc_buffer(bufferRef, nullptr, offset, range),
         base_acc_host_ref(this, std::array<::size_t, 3>{0, 0, 0}) {
-    synchronizer::add(this, base_acc_buffer::buf);
+    synchronizer::add(this, base_acc_buffer::buf, mode);
   }
-  accessor_detail(buffer<DataType, dimensions> & bufferRef)
+  accessor_detail(buffer_detail<DataType, dimensions> & bufferRef)
       : accessor_detail(bufferRef, detail::empty_range<dimensions>(),
                         bufferRef.get_range()) {
-    synchronizer::add(this, base_acc_buffer::buf);
+    synchronizer::add(this, base_acc_buffer::buf, mode);
   }
+  /**
+   * Accessor for a host task of the command group,
+   * which only waits for the buffer once the task runs
+   */
+  accessor_detail(buffer_detail<DataType, dimensions> & bufferRef,
+                  handler & commandGroupHandler, range<dimensions> offset,
+                  range<dimensions> range)
+      : base_acc_buffer(bufferRef, &commandGroupHandler, offset, range),
+        base_acc_host_ref(this, std::array<::size_t, 3>{0, 0, 0}) {}
+  accessor_detail(buffer_detail<DataType, dimensions> & bufferRef,
+                  handler & commandGroupHandler)
+      : accessor_detail(bufferRef, commandGroupHandler,
+                        detail::empty_range<dimensions>(),
+                        bufferRef.get_range()) {}
   accessor_detail(const accessor_detail& copy)
       : base_acc_buffer(static_cast<const base_acc_buffer&>(copy)),
         base_acc_host_ref(this, copy) {
-    synchronizer::add(this, base_acc_buffer::buf);
+    if (!is_in_host_task()) {
+      synchronizer::add(this, base_acc_buffer::buf, mode);
+    }
   }
   accessor_detail(accessor_detail && move) noexcept
       : base_acc_buffer(std::move(static_cast<base_acc_buffer&&>(move))),
         base_acc_host_ref(this,
                           std::move(static_cast<base_acc_host_ref&&>(move))) {
-    synchronizer::add(this, base_acc_buffer::buf);
+    if (!is_in_host_task()) {
+      synchronizer::add(this, base_acc_buffer::buf, mode);
+    }
   }
 
   accessor_detail& operator=(const accessor_detail& copy) {
@@ -112,7 +130,14 @@ SYCL_ACCESSOR_CLASS(target == access::target::host_buffer)
   }
 
   ~accessor_detail() {
-    synchronizer::remove(this, base_acc_buffer::buf);
+    if (!is_in_host_task()) {
+      synchronizer::remove(this, base_acc_buffer::buf);
+    }
+  }
+
+ private:
+  bool is_in_host_task() const {
+    return base_acc_buffer::commandGroupHandler != nullptr;
   }
 };
 
@@ -39,9 +39,9 @@ struct subscript_helper<1, DataType, dimensions, mode, target> {
   template <int, typename, int, access::mode, access::target>                 \
   friend class accessor_device_ref;                                           \
   const acc_t* parent;                                                        \
-  vector_class<string_class> rang;                                            \
-  accessor_device_ref(const acc_t* parent, vector_class<string_class> range)  \
-      : parent(parent), rang(range) {                                         \
+  vector_class<ir::expr> rang;                                                \
+  accessor_device_ref(const acc_t* parent, vector_class<ir::expr> range)      \
+      : parent(parent), rang(std::move(range)) {                              \
     rang.resize(3);                                                           \
   }                                                                           \
   accessor_device_ref(const acc_t* parent, const accessor_device_ref& copy)   \
@@ -94,15 +94,17 @@ class accessor_device_ref<1, DataType, dimensions, mode, target> {
     // strings
     auto rang_copy = rang;
     rang_copy[dimensions - 1] = data_ref::get_name(index);
-    string_class ind(std::move(rang_copy[0]));
+    auto ind = std::move(rang_copy[0]);
     auto multiplier = parent->access_buffer_range(0);
     for (int i = 1; i < dimensions; ++i) {
-      ind += string_class(" + ") + std::move(rang_copy[i]) + " * " +
-             get_string<decltype(multiplier)>::get(multiplier);
+      ind = ir::infix(
+          "+", ind,
+          ir::infix("*", rang_copy[i],
+                    get_string<decltype(multiplier)>::get(multiplier)));
       multiplier *= parent->access_buffer_range(i);
     }
     auto resource_name = kernel_ns::register_resource(*parent);
-    return subscript_return_t(resource_name + "[" + ind + "]");
+    return subscript_return_t(ir::subscript(resource_name, ind));
   }
 
  public:
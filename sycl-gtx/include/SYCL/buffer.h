@@ -3,10 +3,12 @@
 // 3.4.2 Buffers
 
 #include "SYCL/access.h"
+#include "SYCL/buffer_allocator.h"
 #include "SYCL/buffer_base.h"
 #include "SYCL/command_group.h"
 #include "SYCL/detail/common.h"
 #include "SYCL/detail/debug.h"
+#include "SYCL/detail/mem_pool.h"
 #include "SYCL/detail/synchronizer.h"
 #include "SYCL/error_handler.h"
 #include "SYCL/event.h"
@@ -15,6 +17,7 @@
 #include "SYCL/ranges.h"
 #include "SYCL/refc.h"
 #include <algorithm>
+#include <memory>
 
 namespace cl {
 namespace sycl {
@@ -22,7 +25,8 @@ namespace sycl {
 // Forward declarations
 template <typename, int, access::mode, access::target>
 class accessor;
-template <typename, int = 1>
+template <typename DataType, int dimensions = 1,
+          typename AllocatorT = buffer_allocator<DataType>>
 struct buffer;
 class handler;
 class queue;
@@ -51,10 +55,15 @@ class buffer_detail : public buffer_base {
 
   range<dimensions> rang;
   ptr_t host_data;
+  // Layout of the host data, the parent range for sub-buffers
+  range<dimensions> host_rang;
 
   bool is_read_only = false;
+  // Destruction waits and writes the data back to the host
   bool is_blocking = true;
   bool is_initialized = false;
+  // The host storage is allocated by the runtime, see mem_pool
+  bool owns_host_data = false;
 
   friend class accessor_base;
   friend class accessor_buffer<DataType_t, dimensions>;
@@ -65,6 +74,7 @@ class buffer_detail : public buffer_base {
                 bool is_read_only, bool is_blocking = true)
       : host_data(ptr_t(host_data, [](value_type* ptr) {})),
         rang(range),
+        host_rang(range),
         is_read_only(is_read_only),
         is_blocking(is_blocking) {}
 
@@ -103,22 +113,25 @@ class buffer_detail : public buffer_base {
       : buffer_detail(const_cast<DataType*>(hostData),  // NOLINT
                       range, true) {}
 
+ protected:
   /**
    * Create a new buffer of the given size with storage managed by the SYCL
-  // runtime.
-   * The default behavior is to use the default host buffer allocator,
-   * in order to allow for host accesses.
-   * If the type of the buffer has the const qualifier,
-   * then the default allocator will remove the qualifier
+   * runtime.
+   * The storage comes from the allocator of the buffer, rebound to the
+   * host data type, which removes the const qualifier of the buffer type
    * to allow host access to the data.
    * @param range<dimensions> defines the size.
    */
-  buffer_detail(const range<dimensions>& range)
-      : host_data(ptr_t(new DataType[range.size()])),
+  template <class AllocatorT>
+  buffer_detail(const range<dimensions>& range, AllocatorT allocator)
+      : host_data(allocate_host_data(range.size(), allocator)),
         rang(range),
+        host_rang(range),
         is_read_only(false),
-        is_blocking(false) {}
+        is_blocking(false),
+        owns_host_data(true) {}
 
+ public:
   /**
    * Create a new buffer with associated memory, using the data in hostData.
    * The ownership of the hostData is shared between the runtime and the user.
@@ -141,10 +154,10 @@ class buffer_detail : public buffer_base {
   buffer_detail(unique_ptr_class<void>&& hostData,
                 const range<dimensions>& bufferRange);
 
-  // TODO(progtx):
   /**
    * Create a new sub-buffer without allocation to have separate accessors
    * later.
+   * Only the region of the sub-buffer is copied to and from the device.
    * @param b is the buffer with the real data.
    * @param baseIndex specifies the origin of the sub-buffer inside the buffer
    * b.
@@ -153,21 +166,43 @@ class buffer_detail : public buffer_base {
   buffer_detail(buffer_detail& b, const id<dimensions>& baseIndex,
                 const range<dimensions>& subRange)
       : rang(subRange),
+        host_rang(b.rang),
         is_read_only(b.is_read_only),
-        is_blocking(b.is_blocking) {
-    DataType* start = b.host_data.get();
-
-    if (dimensions == 1) {
-      start += static_cast<::size_t>(baseIndex.get(0));
-    } else if (dimensions == 2) {
-      start += static_cast<::size_t>(baseIndex.get(1)) *
-                   static_cast<::size_t>(rang.get(0)) +
-               static_cast<::size_t>(baseIndex.get(0));
-    } else if (dimensions == 3) {
-      // TODO(progtx):
+        // The host data is that of the parent, even without final data
+        is_blocking(true) {
+    if (b.parent != nullptr) {
+      // Neither can OpenCL sub-buffers
+      detail::error::report(CL_INVALID_MEM_OBJECT);
+    }
+    ::size_t start = 0;
+    ::size_t multiplier = 1;
+    bool is_contiguous = true;
+    for (int i = 0; i < dimensions; ++i) {
+      auto base = static_cast<::size_t>(baseIndex.get(i));
+      auto size = static_cast<::size_t>(rang.get(i));
+      auto parent_size = static_cast<::size_t>(b.rang.get(i));
+      if (base + size > parent_size) {
+        detail::error::report(CL_INVALID_VALUE);
+      }
+      start += base * multiplier;
+      multiplier *= parent_size;
+      // Only the outermost dimension can be narrower
+      if (i < dimensions - 1 && size != parent_size) {
+        is_contiguous = false;
+      }
     }
 
-    host_data = ptr_t(start, [](DataType* ptr) {});
+    auto element_size = data_size<DataType_t>::get();
+    parent = &b;
+    origin = start * element_size;
+    if (!is_contiguous) {
+      host_row_pitch = static_cast<::size_t>(b.rang.get(0)) * element_size;
+      host_slice_pitch =
+          (dimensions == 3
+               ? host_row_pitch * static_cast<::size_t>(b.rang.get(1))
+               : 0);
+    }
+    host_data = ptr_t(b.host_data.get() + start, [](DataType* ptr) {});
   }
 
   /**
@@ -187,7 +222,9 @@ class buffer_detail : public buffer_base {
   buffer_detail& operator=(buffer_detail&&) = default;  // NOLINT
 
   ~buffer_detail() {
+    synchronizer::flush_deferred(this);
     event::wait_and_throw(events);
+    release_device_data(is_blocking && !is_read_only);
   }
 
   /**
@@ -199,6 +236,14 @@ class buffer_detail : public buffer_base {
     return rang;
   }
 
+  vector_class<::size_t> get_shape() const override {
+    vector_class<::size_t> shape;
+    for (int i = 0; i < dimensions; ++i) {
+      shape.push_back(rang.get(i));
+    }
+    return shape;
+  }
+
   /** Total number of elements in the buffer */
   ::size_t get_count() const {
     ::size_t count = rang.get(0);
@@ -209,21 +254,64 @@ class buffer_detail : public buffer_base {
   }
 
   /** Total number of bytes in the buffer */
-  ::size_t get_size() const {
+  ::size_t get_size() const override {
     return get_count() * data_size<DataType_t>::get();
   }
 
  private:
-  static void create(queue* q, const vector_class<cl_event>& wait_events,
-                     buffer_detail* buffer) {
+  void* get_host_pointer() override {
+    return host_data.get();
+  }
+
+  /** Elements are default-initialized, same as with new[] */
+  template <class AllocatorT>
+  static ptr_t allocate_host_data(::size_t count, AllocatorT allocator) {
+    using alloc_t = typename std::allocator_traits<
+        AllocatorT>::template rebind_alloc<DataType>;
+    using traits = std::allocator_traits<alloc_t>;
+    alloc_t alloc(allocator);
+    DataType* data = traits::allocate(alloc, count);
+    for (::size_t i = 0; i < count; ++i) {
+      ::new (static_cast<void*>(data + i)) DataType;
+    }
+    return ptr_t(data, [alloc, count](DataType* ptr) mutable {
+      for (::size_t i = 0; i < count; ++i) {
+        ptr[i].~DataType();
+      }
+      traits::deallocate(alloc, ptr, count);
+    });
+  }
+
+  static cl_event create(queue* q, const vector_class<cl_event>& wait_events,
+                         buffer_detail* buffer) {
+    if (buffer->device_data.get() != nullptr) {
+      // Already created by an earlier replay of a recorded command group
+      return nullptr;
+    }
     ::cl_int error_code;
+    const cl_mem_flags access_flags =
+        (buffer->is_read_only ? CL_MEM_READ_ONLY : CL_MEM_READ_WRITE);
+    if (buffer->parent != nullptr) {
+      create(q, wait_events, static_cast<buffer_detail*>(buffer->parent));
+      return buffer->create_sub_buffer(q, wait_events, access_flags);
+    }
+    bool zero_copy =
+        (buffer->host_data != nullptr && buffer->enable_zero_copy(q));
+    if (!zero_copy && buffer->owns_host_data && mem_pool::is_enabled()) {
+      // Data is always copied explicitly, no need to use the host pointer
+      buffer->device_data = buffer_base::cl_create_pooled_buffer(
+          q, access_flags, buffer->get_size(), error_code);
+      detail::error::report(error_code);
+      return nullptr;
+    }
     const cl_mem_flags all_flags =
         ((buffer->host_data == nullptr) ? 0 : CL_MEM_USE_HOST_PTR) |
-        (buffer->is_read_only ? CL_MEM_READ_ONLY : CL_MEM_READ_WRITE);
+        access_flags;
     buffer->device_data = buffer_base::cl_create_buffer(
         q, all_flags, buffer->get_size(), buffer->host_data.get(), error_code);
     detail::error::report(error_code);
     buffer->device_data.release_one();
+    return nullptr;
   }
 
   void init() {
@@ -282,9 +370,9 @@ class buffer_detail : public buffer_base {
                clEnqueueBuffer_f clEnqueueBuffer) final {
     cl_event evnt;
     auto error_code = this->cl_enqueue_buffer(
-        q, get_size(), host_data.get(), wait_events, evnt, clEnqueueBuffer);
+        q, false, host_data.get(), wait_events, &evnt, clEnqueueBuffer);
     detail::error::report(error_code);
-    events.emplace_back(evnt);
+    add_event(evnt);
   }
 
  protected:
@@ -297,15 +385,16 @@ class buffer_detail : public buffer_base {
  public:
   void set_final_data(weak_ptr_class<DataType_t>& finalData);
 
-  // TODO(progtx): nullptr indicates not to copy back
-  void set_final_data(std::nullptr_t) {}
+  /** nullptr indicates not to copy back */
+  void set_final_data(std::nullptr_t) {
+    is_blocking = false;
+  }
 };
 
 }  // namespace detail
 
 #if MSVC_2013_OR_LOWER
 #define BUFFER_INHERIT_CONSTRUCTORS(dimensions)                            \
-  buffer(const range<dimensions>& range) : Base(range) {}                  \
   buffer(DataType* host_data, range<dimensions> range)                     \
       : Base(host_data, range) {}                                          \
   buffer(const DataType* host_data, range<dimensions> range)               \
@@ -323,8 +412,9 @@ class buffer_detail : public buffer_base {
       : Base(mem_object, from_queue, available_event) {}
 #endif
 
-template <typename DataType_t>
-struct buffer<DataType_t, 1> : public detail::buffer_detail<DataType_t, 1> {
+template <typename DataType_t, typename AllocatorT>
+struct buffer<DataType_t, 1, AllocatorT>
+    : public detail::buffer_detail<DataType_t, 1> {
  private:
   using Base = detail::buffer_detail<DataType_t, 1>;
   using DataType = typename Base::value_type;
@@ -335,15 +425,17 @@ struct buffer<DataType_t, 1> : public detail::buffer_detail<DataType_t, 1> {
 #else
   using Base::Base;
 #endif
+  /** Storage managed by the runtime comes from the allocator */
+  buffer(const range<1>& bufferRange, AllocatorT allocator = {})
+      : Base(bufferRange, allocator) {}
 
   /**
    * Create a new allocated 1D buffer initialized from the given elements
    * ranging from first up to one before last
    */
   template <class InputIterator>
-  buffer(InputIterator first, InputIterator last)
-      : Base(nullptr, last - first) {
-    this->host_data = this->ptr_t(new DataType[last - first]);
+  buffer(InputIterator first, InputIterator last, AllocatorT allocator = {})
+      : Base(range<1>(last - first), allocator) {
     std::copy(first, last, this->host_data.get());
   }
 
@@ -353,8 +445,9 @@ struct buffer<DataType_t, 1> : public detail::buffer_detail<DataType_t, 1> {
       : Base(host_data.data(), host_data.size()) {}
 };
 
-template <typename DataType_t>
-struct buffer<DataType_t, 2> : public detail::buffer_detail<DataType_t, 2> {
+template <typename DataType_t, typename AllocatorT>
+struct buffer<DataType_t, 2, AllocatorT>
+    : public detail::buffer_detail<DataType_t, 2> {
  private:
   using Base = detail::buffer_detail<DataType_t, 2>;
   using DataType = typename Base::value_type;
@@ -365,6 +458,9 @@ struct buffer<DataType_t, 2> : public detail::buffer_detail<DataType_t, 2> {
 #else
   using Base::Base;
 #endif
+  /** Storage managed by the runtime comes from the allocator */
+  buffer(const range<2>& bufferRange, AllocatorT allocator = {})
+      : Base(bufferRange, allocator) {}
   buffer(::size_t sizeX, ::size_t sizeY) : buffer(range<2>{sizeX, sizeY}) {}
   buffer(DataType* host_data, ::size_t sizeX, ::size_t sizeY)
       : buffer(host_data, {sizeX, sizeY}) {}
@@ -372,8 +468,9 @@ struct buffer<DataType_t, 2> : public detail::buffer_detail<DataType_t, 2> {
       : buffer(host_data, {sizeX, sizeY}) {}
 };
 
-template <typename DataType_t>
-struct buffer<DataType_t, 3> : public detail::buffer_detail<DataType_t, 3> {
+template <typename DataType_t, typename AllocatorT>
+struct buffer<DataType_t, 3, AllocatorT>
+    : public detail::buffer_detail<DataType_t, 3> {
  private:
   using Base = detail::buffer_detail<DataType_t, 3>;
   using DataType = typename Base::value_type;
@@ -384,6 +481,9 @@ struct buffer<DataType_t, 3> : public detail::buffer_detail<DataType_t, 3> {
 #else
   using Base::Base;
 #endif
+  /** Storage managed by the runtime comes from the allocator */
+  buffer(const range<3>& bufferRange, AllocatorT allocator = {})
+      : Base(bufferRange, allocator) {}
   buffer(::size_t sizeX, ::size_t sizeY, ::size_t sizeZ)
       : buffer(range<3>{sizeX, sizeY, sizeZ}) {}
   buffer(DataType* host_data, ::size_t sizeX, ::size_t sizeY, ::size_t sizeZ)
@@ -0,0 +1,43 @@
+#pragma once
+
+// 3.4.1 Host allocation
+
+#include "SYCL/detail/common.h"
+#include "SYCL/detail/host_memory.h"
+
+namespace cl {
+namespace sycl {
+
+/**
+ * Default allocator of the host storage of buffers
+ * created without host data.
+ * Memory comes from detail::host_memory, aligned for zero-copy.
+ */
+template <typename T>
+class buffer_allocator {
+ public:
+  using value_type = T;
+
+  buffer_allocator() = default;
+  template <typename U>
+  buffer_allocator(const buffer_allocator<U>&) {}
+
+  T* allocate(::size_t n) {
+    return static_cast<T*>(detail::host_memory::allocate(n * sizeof(T)));
+  }
+  void deallocate(T* ptr, ::size_t n) {
+    detail::host_memory::deallocate(ptr, n * sizeof(T));
+  }
+
+  template <typename U>
+  bool operator==(const buffer_allocator<U>&) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const buffer_allocator<U>&) const {
+    return false;
+  }
+};
+
+}  // namespace sycl
+}  // namespace cl
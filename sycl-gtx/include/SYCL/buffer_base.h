@@ -1,8 +1,12 @@
 #pragma once
 
+#include "SYCL/access.h"
 #include "SYCL/detail/common.h"
 #include "SYCL/detail/debug.h"
+#include "SYCL/detail/mem_pool.h"
 #include "SYCL/event.h"
+#include "SYCL/refc.h"
+#include <atomic>
 
 namespace cl {
 namespace sycl {
@@ -13,43 +17,263 @@ class queue;
 namespace detail {
 
 // Forward declarations
+class buffer_command;
+class host_task;
 class issue_command;
 namespace command {
 class group_detail;
 }
 
+/**
+ * Data is only copied between the host and device_data
+ * when the destination is out of date.
+ * Kernels leave the host data out of date until a host accessor
+ * or the destruction of the buffer needs it.
+ *
+ * On devices with host unified memory, device_data uses the host data
+ * and the copies are replaced by mapping it for the host
+ * and unmapping it before the device uses it again.
+ *
+ * Sub-buffers only copy their own region.
+ * When the region is contiguous and aligned and the parent device memory
+ * is up to date, device_data is a sub-buffer of it
+ * and kernels writing the sub-buffer also write the parent.
+ * Otherwise it has its own memory and rows are copied with rectangles.
+ * While the parent device memory is up to date it stays so:
+ * the host only reads and writes the region of the sub-buffer in it,
+ * and what kernels wrote to the own memory is copied into it on the device
+ * once a host accessor or the destruction needs it.
+ * Command groups using a sub-buffer also depend on its parent.
+ */
 class buffer_base {
  public:
+  struct transfer_stats {
+    ::size_t uploads;
+    ::size_t downloads;
+    ::size_t bytes_transferred;
+    ::size_t uploads_avoided;
+    ::size_t downloads_avoided;
+    ::size_t bytes_avoided;
+    // Copies replaced by mapping on host unified memory
+    ::size_t maps;
+  };
+
   virtual ~buffer_base() = default;
 
+  /** Number of elements in each dimension */
+  virtual vector_class<::size_t> get_shape() const {
+    return {};
+  }
+
+  /** Total number of bytes in the buffer */
+  virtual ::size_t get_size() const {
+    return 0;
+  }
+
+  /** Copies between the host and devices, summed over all buffers */
+  static transfer_stats get_transfer_stats();
+  /** Bytes copied by commands enqueued on the calling thread */
+  static ::size_t get_thread_bytes_transferred();
+
+  /**
+   * Whether buffers map instead of copying on host unified memory devices.
+   * On by default, SYCL_GTX_ZERO_COPY=0 turns it off.
+   * Only affects buffers used on a device for the first time afterwards.
+   */
+  static void set_zero_copy(bool enabled);
+  static bool is_zero_copy_enabled();
+
+  /** Expires when this object is destroyed, copies have their own */
+  weak_ptr_class<void> get_lifetime() const {
+    return lifetime.token;
+  }
+
  protected:
+  friend class buffer_command;
+  friend class host_task;
   friend class issue_command;
+  friend class synchronizer;
   friend class ::cl::sycl::queue;
   friend class command::group_detail;
 
+  using cl_queue_t =
+      refc<cl_command_queue, clRetainCommandQueue, clReleaseCommandQueue>;
+
   detail::refc<cl_mem, clRetainMemObject, clReleaseMemObject> device_data;
   vector_class<event> events;
 
+  // Whether the host data and device_data hold the latest values
+  bool host_valid = true;
+  bool device_valid = false;
+  // Used to read device_data back and to write the region of a sub-buffer,
+  // kept after the SYCL queue is gone
+  cl_queue_t device_queue;
+  // device_data uses the host data on host unified memory
+  bool is_zero_copy = false;
+  // Set while device_data is mapped for the host
+  void* mapped = nullptr;
+  // Of a sub-buffer, origin is its offset in bytes in the parent data
+  buffer_base* parent = nullptr;
+  ::size_t origin = 0;
+  // Set when device_data is a region of the parent device_data
+  bool aliases_parent = false;
+  // Non-zero when the rows of a sub-buffer are apart in the host data
+  ::size_t host_row_pitch = 0;
+  ::size_t host_slice_pitch = 0;
+  // Commands writing device_data, a sub-buffer keeps the count of its parent
+  // from when its data last matched the parent device data
+  ::size_t device_writes = 0;
+  ::size_t parent_writes = 0;
+  // Set while the host writes a sub-buffer whose parent is on the device
+  bool host_written = false;
+
+  // Lets a command_graph notice that the buffer is gone
+  struct lifetime_t {
+    shared_ptr_class<char> token = shared_ptr_class<char>(new char());
+
+    lifetime_t() = default;
+    lifetime_t(const lifetime_t&) noexcept {}
+    lifetime_t& operator=(const lifetime_t&) {
+      return *this;
+    }
+  };
+  lifetime_t lifetime;
+
+  // Updated by command groups flushed on any thread
+  struct shared_transfer_stats {
+    std::atomic<::size_t> uploads;
+    std::atomic<::size_t> downloads;
+    std::atomic<::size_t> bytes_transferred;
+    std::atomic<::size_t> uploads_avoided;
+    std::atomic<::size_t> downloads_avoided;
+    std::atomic<::size_t> bytes_avoided;
+    std::atomic<::size_t> maps;
+  };
+  static shared_transfer_stats stats;
+  SYCL_THREAD_LOCAL static ::size_t thread_bytes_transferred;
+  static mutex_class zero_copy_mutex;
+  static bool zero_copy_configured;
+  static bool zero_copy_enabled;
+
+  virtual void* get_host_pointer() {
+    return nullptr;
+  }
+
+  static void add_bytes_transferred(::size_t bytes);
+
   void create_accessor_command();
+  void add_event(cl_event evnt);
+
+  /** Takes a reference to the event of a kernel that writes device_data */
+  void set_device_written(cl_command_queue q, cl_event kernel_event);
+  /**
+   * Takes a reference to the event of a kernel that only reads device_data,
+   * the memory is only released or reused after it
+   */
+  void set_device_read(cl_event kernel_event);
+  /** Brings the host data up to date for a host accessor */
+  void use_on_host(access::mode mode);
+  /** Reads device_data back on destruction, if the host data is needed */
+  void release_device_data(bool write_back);
+  void update_host();
+
+  /** Whether commands wrote the parent device_data the sub-buffer lacks */
+  bool is_parent_newer() const;
+  /** Whether the region of the sub-buffer can be kept in the parent device */
+  bool is_parent_on_device() const;
+  /**
+   * Brings device_data or the host data of a sub-buffer up to date
+   * from the region of the parent device_data
+   */
+  cl_event enqueue_from_parent(queue* q,
+                               const vector_class<cl_event>& wait_events,
+                               bool to_device);
+  /**
+   * Writes what the host wrote through a sub-buffer
+   * to the region of the parent device_data
+   * @return the event of the write, nullptr if there was nothing to write
+   */
+  cl_event write_to_parent(cl_command_queue q, bool blocking,
+                           const vector_class<cl_event>& wait_events);
+  /** Copies what kernels wrote to device_data into the parent device_data */
+  void copy_to_parent();
+
+  /**
+   * Called when device_data is created for the host data,
+   * @return whether the device can use it without copies
+   */
+  bool enable_zero_copy(queue* q);
+  /** Maps device_data for the host, taking over the event */
+  void map(cl_command_queue q, const vector_class<cl_event>& wait_events,
+           bool blocking, cl_map_flags flags);
+  /** @return the event of unmapping, nullptr if it was not mapped */
+  cl_event unmap(cl_command_queue q, const vector_class<cl_event>& wait_events);
 
   using clEnqueueBuffer_f = decltype(&clEnqueueWriteBuffer);
+  /** clEnqueueReadBuffer as a clEnqueueBuffer_f */
+  static ::cl_int CL_API_CALL enqueue_read_buffer(
+      cl_command_queue q, cl_mem buffer, cl_bool blocking, ::size_t offset,
+      ::size_t size, const void* ptr, ::cl_uint num_events,
+      const cl_event* wait_list, cl_event* evnt);
   virtual void enqueue(queue* q, const vector_class<cl_event>& wait_events,
                        clEnqueueBuffer_f clEnqueueBuffer) {
     DSELF() << "not implemented";
   }
-  static void enqueue_command(queue* q,
-                              const vector_class<cl_event>& wait_events,
-                              buffer_base* buffer,
-                              clEnqueueBuffer_f clEnqueueBuffer) {
-    buffer->enqueue(q, wait_events, clEnqueueBuffer);
-  }
-  ::cl_int cl_enqueue_buffer(queue* q, ::size_t size, void* host_ptr,
+  /**
+   * Skips the copy if the destination is already up to date,
+   * maps or unmaps instead on host unified memory
+   */
+  static cl_event enqueue_command(queue* q,
+                                  const vector_class<cl_event>& wait_events,
+                                  buffer_base* buffer,
+                                  clEnqueueBuffer_f clEnqueueBuffer);
+  /**
+   * For data that won't be read, only maps or unmaps on host unified memory
+   * so that the host or the device can write it
+   */
+  static cl_event enqueue_map_command(queue* q,
+                                      const vector_class<cl_event>& wait_events,
+                                      buffer_base* buffer,
+                                      clEnqueueBuffer_f clEnqueueBuffer);
+  /** Copies the whole buffer, as a rectangle if the host rows are apart */
+  ::cl_int cl_enqueue_buffer(cl_command_queue q, bool blocking, void* host_ptr,
                              const vector_class<cl_event>& wait_events,
-                             cl_event& evnt, clEnqueueBuffer_f clEnqueueBuffer);
+                             cl_event* evnt, clEnqueueBuffer_f clEnqueueBuffer);
+  ::cl_int cl_enqueue_buffer(queue* q, bool blocking, void* host_ptr,
+                             const vector_class<cl_event>& wait_events,
+                             cl_event* evnt, clEnqueueBuffer_f clEnqueueBuffer);
+  /** Copies between the host data and the region in the parent device_data */
+  ::cl_int cl_enqueue_parent(cl_command_queue q, bool blocking,
+                             const vector_class<cl_event>& wait_events,
+                             cl_event* evnt, clEnqueueBuffer_f clEnqueueBuffer);
+  /** Copies between device_data and the region in the parent device_data */
+  ::cl_int cl_copy_parent(cl_command_queue q, bool to_parent,
+                          const vector_class<cl_event>& wait_events,
+                          cl_event* evnt);
+  /**
+   * Size of the rows of a sub-buffer for rectangle commands,
+   * and the origin of the first one in the parent
+   */
+  void get_rect(::size_t region[3], ::size_t parent_origin[3]) const;
+  /** Events of the sub-buffer and its parent, and wait_events */
+  vector_class<cl_event> get_parent_wait_events(
+      const vector_class<cl_event>& wait_events) const;
 
   static cl_mem cl_create_buffer(queue* q, const cl_mem_flags& flags,
                                  ::size_t size, void* host_ptr,
                                  ::cl_int& error_code);
+  /**
+   * Creates device_data of a sub-buffer, the parent device_data must exist
+   * @return an event to wait for before using it, or nullptr
+   */
+  cl_event create_sub_buffer(queue* q,
+                             const vector_class<cl_event>& wait_events,
+                             cl_mem_flags flags);
+  /** Device memory that goes back to the mem_pool once released */
+  static mem_pool::mem_t cl_create_pooled_buffer(queue* q,
+                                                 const cl_mem_flags& flags,
+                                                 ::size_t size,
+                                                 ::cl_int& error_code);
 };
 
 }  // namespace detail
@@ -5,6 +5,7 @@
 #include "SYCL/access.h"
 #include "SYCL/buffer_base.h"
 #include "SYCL/detail/common.h"
+#include "SYCL/detail/compile_pool.h"
 #include "SYCL/detail/debug.h"
 #include "SYCL/ranges.h"
 #include <set>
@@ -21,6 +22,8 @@ class queue;
 namespace detail {
 
 // Forward declarations
+class command_graph;
+class host_task;
 static inline unique_ptr_class<handler> get_handler(queue* q);
 template <typename, int>
 class buffer_detail;
@@ -30,7 +33,7 @@ namespace command {
 // Forward declaration
 class group_detail;
 
-enum class type_t { unspecified, get_accessor, copy_data, kernel };
+enum class type_t { unspecified, get_accessor, copy_data, kernel, host_task };
 
 static debug& operator<<(debug& d, type_t t) {
   string_class str("command::type::");
@@ -44,6 +47,9 @@ static debug& operator<<(debug& d, type_t t) {
     case type_t::kernel:
       str += "kernel";
       break;
+    case type_t::host_task:
+      str += "host_task";
+      break;
     case type_t::unspecified:
     default:
       str += "unspecified";
@@ -68,15 +74,42 @@ union metadata {
   metadata(buffer_copy buf_copy) : buf_copy(buf_copy) {}
 };
 
+/** Host value passed to kernels with scalar_arg */
+struct scalar {
+  string_class type_name;
+  // Name of the kernel parameter, empty if the value is in the source
+  string_class name;
+  vector_class<char> value;
+  bool specialized;
+
+  bool operator==(const scalar& other) const {
+    return type_name == other.type_name && name == other.name &&
+           value == other.value && specialized == other.specialized;
+  }
+};
+
+/** Kernel of a command group that the next kernel could be fused with */
+struct fusible_kernel {
+  shared_ptr_class<kernel> kern;
+  ::size_t kernel_name_id;
+  ::size_t num_work_items;
+};
+
 struct info {
-  using command_f = function_class<void(queue*, const vector_class<cl_event>&)>;
+  /** Returns the event of the enqueued OpenCL command, if there is one */
+  using command_f =
+      function_class<cl_event(queue*, const vector_class<cl_event>&)>;
 
   string_class name;  // Only for debugging
   command_f function;
   type_t type;
   metadata data;
+  // Only for kernels, so that a recorded command group can change arguments
+  shared_ptr_class<kernel> kern;
 
-  static void do_nothing(queue* q, const vector_class<cl_event>&) {}
+  static cl_event do_nothing(queue* q, const vector_class<cl_event>&) {
+    return nullptr;
+  }
 };
 
 }  // namespace command
@@ -90,6 +123,7 @@ struct info {
 class command_group {
  private:
   friend class kernel;
+  friend class command_graph;
   friend class command::group_detail;
   friend class ::cl::sycl::queue;
   using command_t = command::info;
@@ -98,10 +132,19 @@ class command_group {
   vector_class<command_t> commands;
   std::set<buffer_base*> read_buffers;
   std::set<buffer_base*> write_buffers;
+  vector_class<command::scalar> scalars;
+  // Kernels still building on compile threads when submitted
+  vector_class<compile_pool::future_t> builds;
+  // Set while the group is held back for the next kernel to be fused with
+  command::fusible_kernel fusible = {nullptr, 0, 0};
+  // Copied between the host and the device by the last run
+  ::size_t bytes_transferred = 0;
   queue* q;
 
   void enter();
   void exit();
+  /** Enqueues the commands, keeping them */
+  vector_class<event> run(vector_class<cl_event> wait_events, bool in_order);
 
  public:
   command_group(queue* q) : q(q) {}
@@ -140,8 +183,13 @@ class command_group {
   template <typename functorT>
   command_group(queue& primaryQueue, queue& secondaryQueue, functorT lambda);
 
-  void optimize();
-  void flush(vector_class<cl_event> wait_events);
+  /**
+   * Without an in-order queue, each command also waits for the earlier ones
+   * @return the events of the enqueued commands
+   */
+  vector_class<event> flush(vector_class<cl_event> wait_events,
+                            bool in_order = true);
+  bool is_building() const;
 };
 
 namespace command {
@@ -152,42 +200,56 @@ class group_detail {
 
   // TODO(progtx): Need to deal better with threads
   SYCL_THREAD_LOCAL static command_group* last;
+  // Previous command group of the same queue, while the next one is created
+  SYCL_THREAD_LOCAL static command_group* producer;
 
   template <class... Args>
-  using fn = void (*)(queue*, const vector_class<cl_event>&, Args...);
+  using fn = cl_event (*)(queue*, const vector_class<cl_event>&, Args...);
 
   template <class... Args>
-  using kern_fn = fn<shared_ptr_class<kernel>, event*, Args...>;
+  using kern_fn =
+      fn<shared_ptr_class<kernel>, shared_ptr_class<event>, Args...>;
 
   template <type_t type = type_t::unspecified, class F, class... Args>
   static void add_command(F function, string_class name, Args... params) {
     last->commands.push_back({name,
                               std::bind(function, std::placeholders::_1,
                                         std::placeholders::_2, params...),
-                              type});
+                              type, metadata(), nullptr});
   }
 
  public:
   static void add_kernel_enqueue_task(kern_fn<> function, string_class name,
                                       shared_ptr_class<kernel> kern,
-                                      event* evnt) {
-    add_command(function, name, kern, evnt);
+                                      shared_ptr_class<event> evnt) {
+    add_command<type_t::kernel>(function, name, kern, evnt);
+    last->commands.back().kern = kern;
   }
 
   template <int dimensions>
   static void add_kernel_enqueue_range(
       kern_fn<range<dimensions>, id<dimensions>> function, string_class name,
-      shared_ptr_class<kernel> kern, event* evnt,
+      shared_ptr_class<kernel> kern, shared_ptr_class<event> evnt,
       range<dimensions> num_work_items, id<dimensions> offset) {
-    add_command(function, name, kern, evnt, num_work_items, offset);
+    add_command<type_t::kernel>(function, name, kern, evnt, num_work_items,
+                                offset);
+    last->commands.back().kern = kern;
   }
 
   template <int dimensions>
   static void add_kernel_enqueue_nd_range(
       kern_fn<nd_range<dimensions>> function, string_class name,
-      shared_ptr_class<kernel> kern, event* evnt,
+      shared_ptr_class<kernel> kern, shared_ptr_class<event> evnt,
       nd_range<dimensions> execution_range) {
-    add_command(function, name, kern, evnt, execution_range);
+    add_command<type_t::kernel>(function, name, kern, evnt,
+                                execution_range);
+    last->commands.back().kern = kern;
+  }
+
+  static void add_host_task(fn<shared_ptr_class<host_task>> function,
+                            string_class name,
+                            shared_ptr_class<host_task> task) {
+    add_command<type_t::host_task>(function, name, task);
   }
 
   template <typename DataType, int dimensions>
@@ -197,6 +259,9 @@ class group_detail {
     add_command(function, name, buff);
   }
 
+  /** The command group waits for the build only when it is flushed */
+  static void add_build(compile_pool::future_t build);
+
   static void add_buffer_access(buffer_access buf_acc, string_class name);
 
   static void add_buffer_copy(
@@ -205,9 +270,38 @@ class group_detail {
       string_class name, buffer_base* buffer,
       buffer_base::clEnqueueBuffer_f enqueue_function);
 
+  /** Copies and fills that don't go between host data and device_data */
+  template <class F, class... Args>
+  static void add_buffer_command(buffer_access buf_acc, F function,
+                                 string_class name, Args... params) {
+    add_command<type_t::copy_data>(function, name, params...);
+    last->commands.back().data = metadata(buffer_copy{buf_acc, buf_acc.mode});
+    // A kernel fused later would run the producer kernel after the command
+    producer = nullptr;
+  }
+
   static bool in_scope();
   static void check_scope();
 
+  /** Accessors requested so far in the current command group */
+  static vector_class<buffer_access> get_accessors();
+
+  /** @return the name of the kernel parameter passing the scalar */
+  static string_class add_scalar(scalar s);
+  /** Scalars captured so far in the current command group */
+  static const vector_class<scalar>& get_scalars();
+
+  static void set_producer(command_group* group);
+  /**
+   * The kernel of the previous command group, if it is its last command
+   * and it can still be fused with
+   */
+  static fusible_kernel get_fusible_producer();
+  /** Moves the kernel of the previous command group into the current one */
+  static void take_over_kernel();
+  static bool has_kernel();
+  static void set_fusible(fusible_kernel fusible);
+
   using command_f = info::command_f;
 };
 
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+
+namespace cl {
+namespace sycl {
+
+// Forward declaration
+class device;
+
+namespace detail {
+
+/**
+ * Optional on-disk cache of linked program binaries,
+ * shared between processes.
+ *
+ * Disabled unless a directory is set,
+ * either with set_directory or the SYCL_GTX_CACHE_DIR environment variable.
+ * SYCL_GTX_CACHE_MAX_SIZE limits the total size in bytes;
+ * the least recently used binaries are evicted first.
+ */
+class binary_cache {
+ public:
+  using binaries_t = vector_class<vector_class<unsigned char>>;
+
+  /** Default limit for the total size of the cache directory */
+  static const ::size_t default_max_size = 256 * 1024 * 1024;
+
+ private:
+  // Guards the configuration, the files are replaced atomically instead
+  static mutex_class mutex;
+  static bool is_configured;
+  static string_class directory;
+  static ::size_t max_size;
+
+  static void configure();
+  static string_class get_path(const string_class& descriptor);
+  static void evict();
+
+ public:
+  static void set_directory(string_class path,
+                            ::size_t max_size_bytes = default_max_size);
+  static bool is_enabled();
+
+  /**
+   * Describes everything the binaries depend on:
+   * the kernel source, the devices with their drivers and the options
+   */
+  static string_class describe(const string_class& code,
+                               const vector_class<device>& devices,
+                               const string_class& options);
+
+  /** @return false if there is no valid entry */
+  static bool load(const string_class& descriptor, binaries_t& binaries);
+
+  /**
+   * The file is written under a temporary name and then renamed,
+   * so other processes never see a partial entry
+   */
+  static void store(const string_class& descriptor,
+                    const binaries_t& binaries);
+
+  static binaries_t get_binaries(cl_program prog, ::size_t num_devices);
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SYCL/access.h"
+#include "SYCL/detail/common.h"
+
+namespace cl {
+namespace sycl {
+
+// Forward declaration
+class queue;
+
+namespace detail {
+
+// Forward declaration
+class buffer_base;
+
+/**
+ * Commands of a command group copying or filling buffers without a kernel.
+ *
+ * They work on the device memory, so data already on the device
+ * never goes through the host data of the buffers.
+ * A source only valid on the host is written straight into the destination,
+ * or copied on the host when the destination is a host pointer.
+ * Buffers are tracked through the accessors requested from the handler,
+ * like for kernels.
+ * Host pointers must stay valid until the command group completes.
+ */
+class buffer_command {
+ private:
+  /** Uploads or unmaps the buffer, the event is added to wait_events */
+  static void use_on_device(queue* q, vector_class<cl_event>& wait_events,
+                            buffer_base* buffer, bool needs_data);
+  /** Takes over the event of a command writing dst and reading src */
+  static cl_event finish(queue* q, cl_event evnt, buffer_base* dst,
+                         buffer_base* src);
+  /** Whether the buffers share data, through the same parent */
+  static bool overlaps(buffer_base* first, buffer_base* second);
+
+  static cl_event enqueue_copy(queue* q,
+                               const vector_class<cl_event>& wait_events,
+                               buffer_base* src, buffer_base* dst);
+  static cl_event enqueue_read(queue* q,
+                               const vector_class<cl_event>& wait_events,
+                               buffer_base* src, void* dst);
+  static cl_event enqueue_write(queue* q,
+                                const vector_class<cl_event>& wait_events,
+                                const void* src, buffer_base* dst);
+  static cl_event enqueue_fill(queue* q,
+                               const vector_class<cl_event>& wait_events,
+                               buffer_base* dst, vector_class<char> pattern);
+
+ public:
+  /**
+   * The destination must be at least as large as the source
+   * and must not overlap it
+   */
+  static void copy(buffer_access src, buffer_access dst);
+  static void copy(buffer_access src, void* dst);
+  static void copy(const void* src, buffer_access dst);
+  /** The pattern size must be a power of two up to 128 bytes */
+  static void fill(buffer_access dst, vector_class<char> pattern);
+  /** Reads the buffer back into its host data without blocking */
+  static void update_host(buffer_access acc);
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/**
+ * How the kernels of a program are turned into an OpenCL program.
+ *
+ * By default every kernel is compiled on its own and the objects are linked,
+ * so that other programs can reuse the compiled kernels.
+ * In batched mode the kernels of a program are concatenated into one source
+ * and built with a single clBuildProgram.
+ * Selected with set or the SYCL_GTX_BUILD_MODE environment variable:
+ * "separate" or "batched".
+ */
+class build_mode {
+ public:
+  enum value_t { separate, batched };
+
+ private:
+  static mutex_class mutex;
+  static bool is_configured;
+  static value_t mode;
+
+  static void configure();
+
+ public:
+  static void set(value_t value);
+  static value_t get();
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
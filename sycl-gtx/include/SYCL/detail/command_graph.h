@@ -0,0 +1,99 @@
+#pragma once
+
+#include "SYCL/command_group.h"
+#include "SYCL/detail/common.h"
+#include "SYCL/detail/task_graph.h"
+#include "SYCL/event.h"
+#include <set>
+
+namespace cl {
+namespace sycl {
+
+// Forward declaration
+class queue;
+
+namespace detail {
+
+/**
+ * Sequence of command groups recorded by a queue,
+ * which the queue can enqueue again and again.
+ *
+ * The handlers, kernel tracing and dependencies between the command groups
+ * are only done while recording.
+ * A replay runs the recorded commands with the kernels already built,
+ * each command group waiting only on the command groups it depends on.
+ * The whole graph is a single node in the task graph of the queue.
+ * It refers to the buffers it uses, which must outlive it,
+ * replaying it after one of them is destroyed reports an error.
+ */
+class command_graph {
+ public:
+  struct stats {
+    ::size_t command_groups;
+    ::size_t replays;
+    ::size_t commands;
+  };
+
+ private:
+  friend class ::cl::sycl::queue;
+
+  struct recorded_group {
+    detail::command_group group;
+    // Indices of earlier command groups it depends on
+    vector_class<::size_t> predecessors;
+  };
+
+  vector_class<recorded_group> groups;
+  // Used by any of the command groups
+  std::set<buffer_base*> read_buffers;
+  std::set<buffer_base*> write_buffers;
+  vector_class<weak_ptr_class<void>> buffer_lifetimes;
+  // Only used while recording
+  task_graph dependencies;
+  stats totals = {0, 0, 0};
+
+  template <typename T>
+  void add(queue& q, T cgf) {
+    groups.push_back({detail::command_group(q, cgf), {}});
+    add_dependencies(groups.back());
+  }
+  void add_dependencies(recorded_group& recorded);
+  void finish_recording();
+  /** Reports CL_INVALID_MEM_OBJECT if one of the buffers is gone */
+  void check_buffers() const;
+
+  /** @return the events of the enqueued commands */
+  vector_class<event> replay(queue* q,
+                             const vector_class<cl_event>& wait_events,
+                             bool in_order);
+
+  /** Copied between the host and the device by the last replay */
+  ::size_t get_bytes_transferred() const;
+
+  void set_scalar_value(::size_t group_index, ::size_t scalar_index,
+                        vector_class<char> value);
+
+ public:
+  ::size_t size() const {
+    return groups.size();
+  }
+
+  /**
+   * Changes a scalar_arg passed to the kernel of a recorded command group,
+   * for the following replays.
+   * The scalar index counts the kernel parameters created with scalar_arg
+   * in that command group, specialized ones excluded.
+   */
+  template <typename T>
+  void set_scalar(::size_t group_index, ::size_t scalar_index, T value) {
+    auto bytes = reinterpret_cast<const char*>(&value);  // NOLINT
+    set_scalar_value(group_index, scalar_index,
+                     vector_class<char>(bytes, bytes + sizeof(T)));
+  }
+
+  stats get_stats() const;
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
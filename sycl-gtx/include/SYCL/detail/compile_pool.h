@@ -0,0 +1,61 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <thread>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/**
+ * Worker threads that build kernel programs,
+ * so that the host keeps submitting while the OpenCL compiler runs.
+ * They also run the host tasks of command groups,
+ * on a thread of their own even when building on the submitting thread.
+ *
+ * Uses one thread per core by default.
+ * The SYCL_GTX_COMPILE_THREADS environment variable or set_num_threads
+ * change the number, with zero building on the submitting thread.
+ */
+class compile_pool {
+ public:
+  using task_t = function_class<void()>;
+  using future_t = std::shared_future<void>;
+
+ private:
+  static bool is_configured;
+  static unsigned int num_threads;
+  static bool stopping;
+  static ::size_t idle;
+  static mutex_class mutex;
+  static std::condition_variable wake;
+  static std::deque<std::packaged_task<void()>> tasks;
+  static vector_class<std::thread> workers;
+
+  static void configure();
+  static void work();
+  /** Finishes the queued tasks and joins the workers, at exit */
+  static void stop();
+
+ public:
+  /** Only affects threads started later */
+  static void set_num_threads(unsigned int num);
+  static bool is_enabled();
+
+  /**
+   * The returned future rethrows any exception thrown by the task
+   * @param on_worker a worker runs the task even with zero threads,
+   * because the caller must not block on it
+   */
+  static future_t submit(task_t task, bool on_worker = false);
+
+  /** @return true for finished tasks and invalid futures */
+  static bool is_done(const future_t& task);
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
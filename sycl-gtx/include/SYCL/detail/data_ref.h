@@ -1,7 +1,9 @@
 #pragma once
 
 #include "SYCL/detail/common.h"
+#include "SYCL/detail/counter.h"
 #include "SYCL/detail/debug.h"
+#include "SYCL/detail/ir.h"
 #include <type_traits>
 
 namespace cl {
@@ -13,8 +15,13 @@ struct id;
 
 namespace detail {
 
-// Forward declaration
-void kernel_add(string_class line);
+// Forward declarations
+void kernel_add(const ir::expr& expression);
+void kernel_assign(const ir::expr& lhs, const char* op, const ir::expr& rhs);
+void kernel_declare(const string_class& type, const ir::expr& name);
+void kernel_declare(const string_class& type, const ir::expr& name,
+                    const ir::expr& init);
+counter_t kernel_variable_id();
 
 /**
  * Data reference wrappers
@@ -31,28 +38,33 @@ class data_ref {
     expression,
   };
 
-  static const string_class open_parenthesis;
-  string_class name;
-  type_t type;
+  ir::expr name;
+  type_t type = type_t::general;
 
-  static string_class get_name(const data_ref& dref) {
+  static const ir::expr& get_name(const data_ref& dref) {
     return dref.name;
   }
 
+  static const ir::expr& get_name(const ir::expr& expression) {
+    return expression;
+  }
+
   template <typename T, typename std::enable_if<
                             std::is_arithmetic<T>::value>::type* = nullptr>
-  static string_class get_name(const T& n) {
+  static ir::expr get_name(const T& n) {
     return get_string<T>::get(n);
   }
 
   template <typename T,
             typename std::enable_if<std::is_enum<T>::value>::type* = nullptr>
-  static string_class get_name(const T& n) {
+  static ir::expr get_name(const T& n) {
     auto value = static_cast<typename std::underlying_type<T>::type>(n);
     return get_string<decltype(value)>::get(value);
   }
 
-  data_ref(string_class name) : name(name) {}
+  data_ref(ir::expr name) : name(std::move(name)) {}
+
+  data_ref(string_class name) : name(std::move(name)) {}
 
   data_ref(char* name) : name(name) {}
 
@@ -76,36 +88,34 @@ class data_ref {
 
   // We need to generate a new line, no matter whether moving or copying
   data_ref& operator=(const data_ref& dref) {
-    kernel_add(name + " = " + dref.name);
+    kernel_assign(name, "=", dref.name);
     return *this;
   }
   data_ref& operator=(data_ref&& dref) noexcept {
-    kernel_add(name + " = " + dref.name);
+    kernel_assign(name, "=", dref.name);
     return *this;
   }
 
   // TODO(progtx):
   // https://www.khronos.org/registry/cl/sdk/1.2/docs/man/xhtml/operators.html
 
-#define SYCL_ASSIGNMENT_OPERATOR(op)              \
-  template <class T>                              \
-  data_ref& operator op(const T& n) {             \
-    kernel_add(name + " " #op " " + get_name(n)); \
-    return *this;                                 \
+#define SYCL_ASSIGNMENT_OPERATOR(op)       \
+  template <class T>                       \
+  data_ref& operator op(const T& n) {      \
+    kernel_assign(name, #op, get_name(n)); \
+    return *this;                          \
   }
 
-#define SYCL_DATA_REF_OPERATOR(op)                                             \
-  template <class T>                                                           \
-  data_ref operator op(const T& n) const {                                     \
-    return data_ref(open_parenthesis + name + " " #op " " + get_name(n) +      \
-                    ')');                                                      \
-  }                                                                            \
-  template <typename T,                                                        \
-            typename std::enable_if<std::is_arithmetic<T>::value>::type* =     \
-                nullptr>                                                       \
-  friend data_ref operator op(const T& n, const data_ref& dref) {              \
-    return data_ref(open_parenthesis + get_name(n) + " " #op " " + dref.name + \
-                    ')');                                                      \
+#define SYCL_DATA_REF_OPERATOR(op)                                         \
+  template <class T>                                                       \
+  data_ref operator op(const T& n) const {                                 \
+    return data_ref(ir::binary(#op, name, get_name(n)));                   \
+  }                                                                        \
+  template <typename T,                                                    \
+            typename std::enable_if<std::is_arithmetic<T>::value>::type* = \
+                nullptr>                                                   \
+  friend data_ref operator op(const T& n, const data_ref& dref) {          \
+    return data_ref(ir::binary(#op, get_name(n), dref.name));              \
   }
 
   SYCL_ASSIGNMENT_OPERATOR(=);
@@ -156,20 +166,20 @@ class data_ref {
   // But there is no way to distinguish it
   // Here presume an expression
   data_ref operator++() const {
-    return data_ref(open_parenthesis + "++" + name + ')');
+    return data_ref(ir::prefix("++", name));
   }
   data_ref operator++(int) const {
-    return data_ref(open_parenthesis + name + "++" + ')');
+    return data_ref(ir::postfix(name, "++"));
   }
   data_ref operator--() const {
-    return data_ref(open_parenthesis + "--" + name + ')');
+    return data_ref(ir::prefix("--", name));
   }
   data_ref operator--(int) const {
-    return data_ref(open_parenthesis + name + "--" + ')');
+    return data_ref(ir::postfix(name, "--"));
   }
 
   data_ref operator!() const {
-    return data_ref(open_parenthesis + '!' + name + ')');
+    return data_ref(ir::prefix("!", name));
   }
 };
 
@@ -13,12 +13,11 @@ namespace detail {
 namespace control {
 
 static void if_detail(data_ref condition) {
-  kernel_ns::source::add<false>(string_class("if(") + condition.name + ")");
+  kernel_ns::source::add_control("if(", condition.name);
 }
 
 static void else_if(data_ref condition) {
-  kernel_ns::source::add<false>(string_class("else if(") + condition.name +
-                                ")");
+  kernel_ns::source::add_control("else if(", condition.name);
 }
 
 static void else_detail() {
@@ -26,13 +25,12 @@ static void else_detail() {
 }
 
 static void while_detail(data_ref condition) {
-  kernel_ns::source::add<false>(string_class("while( ") + condition.name + ")");
+  kernel_ns::source::add_control("while( ", condition.name);
 }
 
 /** Note: Increment can only be ++ or --, other assignments don't work */
 static void for_detail(data_ref condition, data_ref increment) {
-  kernel_ns::source::add<false>(string_class("for(; ") + condition.name + "; " +
-                                increment.name + ")");
+  kernel_ns::source::add_control("for(; ", condition.name, increment.name);
 }
 
 static void break_detail() {
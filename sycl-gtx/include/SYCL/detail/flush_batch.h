@@ -0,0 +1,66 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+#include <chrono>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/**
+ * When a queue submits its enqueued commands to the device with clFlush.
+ * The default flushes every command group,
+ * and a zero disables the corresponding limit.
+ * Results that are needed on the host are always flushed.
+ */
+struct flush_policy {
+  /** Command groups enqueued before flushing */
+  ::size_t max_groups = 1;
+  /** Bytes transferred by the pending command groups */
+  ::size_t max_bytes = 0;
+  /**
+   * How long the oldest pending command group may wait.
+   * Only checked when the queue is used,
+   * there is no thread flushing in the background.
+   */
+  std::chrono::microseconds max_delay = std::chrono::microseconds(0);
+};
+
+/** Command groups enqueued on the OpenCL queues but not yet flushed */
+class flush_batch {
+ public:
+  struct stats {
+    ::size_t command_groups;
+    ::size_t commands;
+    ::size_t flushes;
+    // Compared to flushing every command group
+    ::size_t flushes_avoided;
+  };
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  flush_policy policy;
+  vector_class<cl_command_queue> queues;
+  ::size_t groups = 0;
+  ::size_t bytes = 0;
+  clock::time_point oldest;
+  stats totals = {0, 0, 0, 0};
+
+ public:
+  void set_policy(const flush_policy& new_policy);
+  flush_policy get_policy() const;
+
+  void add(cl_command_queue q, ::size_t num_commands, ::size_t num_bytes);
+  bool empty() const;
+  /** Whether the policy asks for the pending command groups to be flushed */
+  bool is_due() const;
+  /** Flushes the OpenCL queues of the pending command groups */
+  void flush();
+
+  stats get_stats() const;
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/**
+ * Host storage of buffers allocated by the runtime.
+ *
+ * Allocations are aligned to a page by default,
+ * as OpenCL implementations only use CL_MEM_USE_HOST_PTR memory
+ * without a shadow copy when it is aligned.
+ * The SYCL_GTX_HOST_ALIGNMENT environment variable or set_alignment
+ * change the alignment in bytes, which must be a power of two.
+ *
+ * Allocations of at least SYCL_GTX_HUGE_PAGES_MB mebibytes
+ * are aligned to huge pages and, on Linux, advised to use them.
+ * Zero, the default, never uses huge pages.
+ *
+ * With SYCL_GTX_HOST_FIRST_TOUCH set to 1, pages are touched by the
+ * allocating thread, so that first-touch NUMA policies place them
+ * on the node of that thread rather than of a runtime thread.
+ * It is off by default, since storage only used on the device
+ * would otherwise be faulted in for nothing.
+ */
+class host_memory {
+ public:
+  static const ::size_t default_alignment = 4096;
+  static const ::size_t huge_page_size = 2 * 1024 * 1024;
+
+ private:
+  static bool is_configured;
+  static ::size_t alignment;
+  static ::size_t huge_page_threshold;
+  static bool first_touch;
+  static mutex_class mutex;
+
+  static void configure();
+
+ public:
+  /** Reports CL_OUT_OF_HOST_MEMORY on failure */
+  static void* allocate(::size_t bytes);
+  static void deallocate(void* ptr, ::size_t bytes);
+
+  /** Only affects later allocations */
+  static void set_alignment(::size_t bytes);
+  static ::size_t get_alignment();
+  /** Zero disables huge pages */
+  static void set_huge_page_threshold(::size_t bytes);
+  static void set_first_touch(bool enabled);
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
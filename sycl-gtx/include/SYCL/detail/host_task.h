@@ -0,0 +1,59 @@
+#pragma once
+
+#include "SYCL/access.h"
+#include "SYCL/detail/common.h"
+#include "SYCL/event.h"
+
+namespace cl {
+namespace sycl {
+
+// Forward declaration
+class queue;
+
+namespace detail {
+
+// Forward declaration
+struct async_errors;
+
+/**
+ * Host function run as a command of a command group.
+ *
+ * It waits for the commands before it like a kernel,
+ * and later commands wait for a user event completed after it returns,
+ * so the submitting thread is never blocked.
+ * The function runs on the compile_pool threads,
+ * or on the thread completing its dependencies if the pool is disabled.
+ *
+ * Buffers are accessed through host_buffer accessors requested from the
+ * handler before the task. Unless discarded, their data is read back
+ * without blocking before the task starts.
+ * An exception thrown by the function fails the command group,
+ * and is passed to the async_handler of the queue
+ * by the next wait_and_throw or throw_asynchronous.
+ */
+class host_task {
+ public:
+  using function_t = function_class<void()>;
+
+ private:
+  function_t function;
+  vector_class<buffer_access> buffers;
+  // Of the latest time the command group was enqueued
+  event completion;
+
+  host_task(function_t function, vector_class<buffer_access> buffers);
+
+  static cl_event enqueue(queue* q, const vector_class<cl_event>& wait_events,
+                          shared_ptr_class<host_task> task);
+  /** Calls the function and sets the status of the user event */
+  void run(event user_event, async_errors& errors) const;
+  static void complete(const event& user_event, ::cl_int status);
+
+ public:
+  /** Adds the task to the current command group */
+  static void add(function_t function);
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -0,0 +1,124 @@
+#pragma once
+
+// Intermediate representation of traced kernels
+
+#include "SYCL/detail/common.h"
+#include <initializer_list>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+namespace ir {
+
+enum class node_t : unsigned char {
+  leaf,       // Identifier or literal
+  binary,     // (first op second)
+  infix,      // first op second, without parentheses
+  prefix,     // (op first)
+  postfix,    // (first op)
+  call,       // op(arguments), with first pointing to the first argument
+  argument,   // Argument list cell: first is the value, second the next cell
+  member,     // first op, as in vector swizzles
+  subscript,  // first[second]
+};
+
+/** Expression node, immutable once created */
+struct node {
+  node_t type;
+  const char* text;
+  const node* first;
+  const node* second;
+};
+
+enum class statement_t : unsigned char {
+  text,        // Verbatim line
+  expression,  // first
+  assign,      // first op second
+  declare,     // type first, optionally = second
+  control,     // header first, optionally ; second, then closing parenthesis
+};
+
+struct statement {
+  statement_t type;
+  bool auto_end;
+  unsigned int depth;
+  const char* text;
+  const node* first;
+  const node* second;
+};
+
+/**
+ * Bump allocator for the nodes of a single kernel.
+ * Everything is released together with the arena.
+ */
+class arena {
+ public:
+  struct stats {
+    ::size_t nodes;
+    ::size_t bytes;
+  };
+
+  static const ::size_t block_size = 16 * 1024;
+
+  /** Arena of the kernel being traced, nullptr outside of kernels */
+  SYCL_THREAD_LOCAL static arena* current;
+
+  arena() = default;
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+
+  const node* make(node_t type, const char* text, const node* first = nullptr,
+                   const node* second = nullptr);
+  const char* copy(const string_class& text);
+
+  stats get_stats() const;
+
+ private:
+  vector_class<unique_ptr_class<char[]>> blocks;
+  ::size_t used = block_size;
+  ::size_t num_nodes = 0;
+  ::size_t num_bytes = 0;
+
+  void* allocate(::size_t size);
+};
+
+/**
+ * Handle to an expression.
+ * Names are kept by value, composite expressions are nodes in an arena.
+ */
+class expr {
+ public:
+  expr() = default;
+  expr(string_class text) : text(std::move(text)) {}
+  expr(const char* text) : text(text) {}
+  expr(const node* n) : n(n) {}
+
+  bool empty() const {
+    return n == nullptr && text.empty();
+  }
+
+  /** Names are only copied into the arena once they are used */
+  const node* get_node(arena& a) const;
+
+  string_class str() const;
+
+ private:
+  const node* n = nullptr;
+  string_class text;
+};
+
+expr binary(const char* op, const expr& first, const expr& second);
+expr infix(const char* op, const expr& first, const expr& second);
+expr prefix(const char* op, const expr& operand);
+expr postfix(const expr& operand, const char* op);
+expr call(const string_class& name, std::initializer_list<expr> arguments);
+expr member(const expr& operand, const string_class& name);
+expr subscript(const expr& operand, const expr& index);
+
+void append(string_class& code, const node* n);
+void append(string_class& code, const statement& s);
+
+}  // namespace ir
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 
 namespace cl {
@@ -9,32 +10,21 @@ namespace detail {
 
 class kernel_name {
  private:
-  static ::size_t current_count;
-
-  template <class T>
-  struct namer {
-    static ::size_t id;
-    static bool is_set;
-    static void set() {
-      if (!is_set) {
-        id = ++current_count;
-        is_set = true;
-      }
-    }
-  };
+  static std::atomic<::size_t> current_count;
 
  public:
   template <class T>
   static ::size_t get() {
-    namer<T>::set();
-    return namer<T>::id;
+    // Initialized once, even when first submitted from several threads
+    static const ::size_t id = ++current_count;
+    return id;
   }
-};
 
-template <class T>
-::size_t kernel_name::namer<T>::id = 0;
-template <class T>
-bool kernel_name::namer<T>::is_set = false;
+  /** For kernels generated by the runtime */
+  static ::size_t get_new() {
+    return ++current_count;
+  }
+};
 
 }  // namespace detail
 
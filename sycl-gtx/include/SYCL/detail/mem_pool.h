@@ -0,0 +1,94 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+#include "SYCL/refc.h"
+#include <map>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/**
+ * Keeps the device memory of destroyed buffers,
+ * so that new buffers of a similar size skip clCreateBuffer.
+ *
+ * Memory objects are binned by context, flags and size class,
+ * with four size classes per power of two.
+ * Only buffers with runtime-owned host storage use the pool,
+ * the others need CL_MEM_USE_HOST_PTR,
+ * as do all buffers mapped on devices with host unified memory.
+ *
+ * Keeps up to 256 MiB by default, oldest returned memory is released first.
+ * The SYCL_GTX_MEM_POOL_MB environment variable or set_max_bytes
+ * change the limit, with zero disabling the pool.
+ */
+class mem_pool {
+ public:
+  using mem_t = refc<cl_mem, clRetainMemObject, clReleaseMemObject>;
+
+  struct stats {
+    ::size_t allocations;
+    ::size_t reuses;
+    ::size_t releases;
+    // Memory objects and bytes currently kept
+    ::size_t cached;
+    ::size_t bytes_cached;
+  };
+
+  /** Smallest size class */
+  static const ::size_t min_size = 256;
+
+ private:
+  struct key {
+    cl_context ctx;
+    cl_mem_flags flags;
+    ::size_t size;
+
+    bool operator<(const key& other) const;
+  };
+  struct cached_mem {
+    key k;
+    cl_mem mem;
+    // When it was returned, to release the oldest first
+    ::size_t age;
+  };
+
+  static bool is_configured;
+  static ::size_t max_bytes;
+  static mutex_class mutex;
+  static std::multimap<key, cached_mem> bins;
+  static ::size_t returned;
+  static stats totals;
+
+  static void configure();
+  /** Releases the oldest memory until at most the given bytes are kept */
+  static void trim_locked(::size_t bytes);
+  /** Called once the last buffer using the memory is gone */
+  static void give_back(key k, cl_mem mem);
+
+ public:
+  /** Rounds up to the size class */
+  static ::size_t get_size_class(::size_t size);
+
+  /**
+   * Reuses kept memory of the same context, flags and size class,
+   * otherwise creates it.
+   * The memory goes back to the pool once the returned object is gone,
+   * all commands using it must have completed by then.
+   */
+  static mem_t acquire(cl_context ctx, cl_mem_flags flags, ::size_t size,
+                       ::cl_int& error_code);
+
+  /** Releases kept memory until at most the given bytes are left */
+  static void trim(::size_t bytes = 0);
+
+  /** Also trims the kept memory to the new limit */
+  static void set_max_bytes(::size_t bytes);
+  static bool is_enabled();
+
+  static stats get_stats();
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+#include "SYCL/event.h"
+#include "SYCL/refc.h"
+
+namespace cl {
+namespace sycl {
+
+// Forward declaration
+class queue;
+
+namespace detail {
+
+/**
+ * Completion of a submitted command group,
+ * which might only be enqueued later by its queue.
+ *
+ * Waiting on it without blocking enqueues and flushes the command group,
+ * otherwise a kernel still building or a batched flush could delay it
+ * until the queue is used again.
+ * Callbacks registered before the command group is enqueued
+ * are passed on to its completion event afterwards,
+ * which happens as soon as the kernels it waits for are built.
+ */
+class pending_event : public std::enable_shared_from_this<pending_event> {
+ private:
+  using cl_queue_t =
+      refc<cl_command_queue, clRetainCommandQueue, clReleaseCommandQueue>;
+  using callback_t = function_class<void(::cl_int)>;
+
+  mutex_class mutex;
+  // Cleared once the command group is enqueued
+  queue* master;
+  event completion;
+  cl_queue_t command_q;
+  bool is_enqueued = false;
+  bool is_flushed = false;
+  // Set once a compile thread enqueues the command group after the builds
+  bool is_watched = false;
+  vector_class<callback_t> callbacks;
+
+  /**
+   * Enqueues the command group and flushes it to the device,
+   * unless a host accessor or a kernel still building keeps it back
+   * @param watch_builds enqueue it later once the kernels are built
+   * @return whether completion is set
+   */
+  bool start(std::unique_lock<mutex_class>& lock, bool watch_builds = false);
+
+ public:
+  explicit pending_event(queue* master);
+
+  /** The queue was moved */
+  void set_master(queue* q);
+  /** Called by the queue once the command group is enqueued */
+  void set(event completed, cl_command_queue q);
+  /** Called by the queue if it never enqueued the command group */
+  void cancel();
+
+  bool is_complete();
+  void then(callback_t callback);
+  std::future<void> get_future();
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -19,7 +19,7 @@ struct get_value_point_t {
   static type constructor(data_basic_t&& value, data_ref::type_t type_param) {
     return type(std::move(value), type_param, true);
   }
-  static type constructor(string_class&& value, data_ref::type_t type_param) {
+  static type constructor(ir::expr&& value, data_ref::type_t type_param) {
     return type(std::move(value), type_param, true);
   }
 };
@@ -56,13 +56,14 @@ struct point_ref : data_ref {
       : data_ref(get_string<data_basic_t>::get(value)), data(value) {
     this->type = type;
   }
-  point_ref(string_class name, type_t type, bool) : data_ref(name), data(0) {
+  point_ref(ir::expr name, type_t type, bool)
+      : data_ref(std::move(name)), data(0) {
     this->type = type;
   }
 
  public:
-  point_ref(data_basic_t& data, string_class name, type_t type)
-      : data_ref(name), data(&data) {
+  point_ref(data_basic_t& data, ir::expr name, type_t type)
+      : data_ref(std::move(name)), data(&data) {
     this->type = type;
   }
 
@@ -78,11 +79,11 @@ struct point_ref : data_ref {
   // TODO(progtx): data_ref::operator&
   // template <class = typename std::enable_if<!is_const>::type>
   point_ref<is_const, data_basic_t*> operator&() {  // NOLINT
-    string_class name_tmp;
+    ir::expr name_tmp;
     if (this->type == type_t::numeric) {
       name_tmp = this->name;
     } else {
-      name_tmp = string_class("&(") + this->name + ")";
+      name_tmp = ir::call("&", {this->name});
     }
 
     return point_ref<is_const, data_basic_t*>(&this->data, name_tmp,
@@ -96,11 +97,11 @@ struct point_ref : data_ref {
   //  std::enable_if<std::is_pointer<data_basic_t>::value>::type>
   point_ref<is_const, typename std::remove_pointer<data_basic_t>::type>
   operator*() {
-    string_class name_tmp;
+    ir::expr name_tmp;
     if (this->type == type_t::numeric) {
       name_tmp = this->name;
     } else {
-      name_tmp = string_class("*(") + this->name + ")";
+      name_tmp = ir::call("*", {this->name});
     }
 
     return point_ref<is_const,
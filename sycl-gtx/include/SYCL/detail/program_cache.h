@@ -0,0 +1,93 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+#include "SYCL/detail/compile_pool.h"
+#include "SYCL/refc.h"
+#include <list>
+#include <map>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+/**
+ * Keeps compiled and linked kernels for the lifetime of the process,
+ * so that submitting the same kernel again only costs an enqueue.
+ * Entries are keyed by kernel name, generated source, devices and options.
+ */
+class program_cache {
+ public:
+  using program_t = refc<cl_program, clRetainProgram, clReleaseProgram>;
+  using kernel_t = refc<cl_kernel, clRetainKernel, clReleaseKernel>;
+
+  struct entry {
+    string_class code;
+    program_t compiled;
+    // Only set for programs containing this single kernel
+    string_class link_options;
+    program_t linked;
+    kernel_t kern;
+    // Build started on a compile thread, the fields above are set by it
+    compile_pool::future_t built;
+    // Guards the fields above, the same kernel can be built on many threads
+    mutable mutex_class mutex;
+
+    bool is_building() const;
+  };
+
+  struct stats {
+    ::size_t hits;
+    ::size_t misses;
+    ::size_t entries;
+  };
+
+  /** Maximum number of kept entries, oldest ones are evicted first */
+  static const ::size_t max_entries = 256;
+
+ private:
+  struct key {
+    cl_context ctx;
+    ::size_t kernel_name_id;
+    ::size_t code_hash;
+    vector_class<cl_device_id> devices;
+    string_class options;
+
+    bool operator<(const key& other) const;
+  };
+
+  // Guards the entries and statistics, not the contents of an entry
+  static mutex_class mutex;
+  static std::map<key, shared_ptr_class<entry>> entries;
+  static std::list<key> insertion_order;
+  static ::size_t hits;
+  static ::size_t misses;
+
+  static key make_key(cl_context ctx, ::size_t kernel_name_id,
+                      const string_class& code,
+                      const vector_class<cl_device_id>& devices,
+                      const string_class& options);
+
+ public:
+  /** FNV-1a hash of the generated kernel source */
+  static ::size_t hash(const string_class& code);
+
+  /** @return the cached entry or nullptr */
+  static shared_ptr_class<entry> find(cl_context ctx, ::size_t kernel_name_id,
+                                      const string_class& code,
+                                      const vector_class<cl_device_id>& devices,
+                                      const string_class& options);
+
+  /** Stores a freshly compiled program */
+  static shared_ptr_class<entry> add(cl_context ctx, ::size_t kernel_name_id,
+                                     const string_class& code,
+                                     const vector_class<cl_device_id>& devices,
+                                     const string_class& options,
+                                     cl_program compiled);
+
+  static stats get_stats();
+  static void clear();
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -42,19 +42,20 @@ struct identifier_code {
 
     for (int i = 0; i < dimensions; ++i) {
       auto id_s = get_string<int>::get(i);
-      source::add(string_class("const int ") + name + id_s + " = " +
-                  function_name + "(" + id_s + ")");
+      source::add_declaration("const int", name + id_s,
+                              ir::call(function_name, {id_s}));
     }
 
     if (is_id) {
       string_replace_one(function_name, "id", "size");
 
       if (dimensions == 1) {
-        source::add(string_class("const int ") + name + " = " + name + "0");
+        source::add_declaration("const int", name, name + "0");
       }
       if (dimensions == 2) {
-        source::add(string_class("const int ") + name + " = " + name + "1 * " +
-                    function_name + "(0) + " + name + "0");
+        auto row = ir::infix("*", name + "1", ir::call(function_name, {"0"}));
+        source::add_declaration("const int", name,
+                                ir::infix("+", row, name + "0"));
       }
 
       // TODO(progtx): 3d
@@ -96,8 +97,8 @@ struct constructor;
  */
 template <>
 struct constructor<void> {
-  static source get(function_class<void(void)> kern) {
-    source src;
+  static source get(function_class<void(void)> kern, ::size_t kernel_name_id) {
+    source src(kernel_name_id);
     source::enter(src);
 
     kern();
@@ -111,8 +112,9 @@ struct constructor<void> {
  */
 template <int dimensions>
 struct constructor<id<dimensions>> {
-  static source get(function_class<void(id<dimensions>)> kern) {
-    source src;
+  static source get(function_class<void(id<dimensions>)> kern,
+                    ::size_t kernel_name_id) {
+    source src(kernel_name_id);
     source::enter(src);
 
     // TODO(progtx): num_work_items, work_item_offset
@@ -128,8 +130,9 @@ struct constructor<id<dimensions>> {
  */
 template <int dimensions>
 struct constructor<item<dimensions>> {
-  static source get(function_class<void(item<dimensions>)> kern) {
-    source src;
+  static source get(function_class<void(item<dimensions>)> kern,
+                    ::size_t kernel_name_id) {
+    source src(kernel_name_id);
     source::enter(src);
 
     generate_id_refs<dimensions>::global();
@@ -148,8 +151,9 @@ struct constructor<item<dimensions>> {
  */
 template <int dimensions>
 struct constructor<nd_item<dimensions>> {
-  static source get(function_class<void(nd_item<dimensions>)> kern) {
-    source src;
+  static source get(function_class<void(nd_item<dimensions>)> kern,
+                    ::size_t kernel_name_id) {
+    source src(kernel_name_id);
     source::enter(src);
 
     generate_id_refs<dimensions>::global();
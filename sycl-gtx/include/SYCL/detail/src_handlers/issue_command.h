@@ -19,48 +19,71 @@ class issue_command {
                               const vector_class<cl_event>& wait_events,
                               kernel_ns::source src,
                               shared_ptr_class<kernel> kern);
-  static void prepare_kernel(shared_ptr_class<kernel> kern);
+  using kernel_lock = std::unique_lock<mutex_class>;
+  /**
+   * Sets the kernel arguments. The cl_kernel can be shared between threads,
+   * the lock keeps its arguments until it is enqueued.
+   */
+  static kernel_lock prepare_kernel(shared_ptr_class<kernel> kern);
+  /** Buffers used by the kernel, from its source and set arguments */
+  static vector_class<buffer_access> get_buffers(
+      shared_ptr_class<kernel> kern);
+  /**
+   * The host data of buffers written by the kernel is now out of date,
+   * and all buffers used by it wait for it before releasing device memory
+   */
+  static void finish_kernel(queue* q, shared_ptr_class<kernel> kern,
+                            shared_ptr_class<event> evnt);
 
-  static void enqueue_task_command(queue* q,
-                                   const vector_class<cl_event>& wait_events,
-                                   shared_ptr_class<kernel> kern, event* evnt);
+  static cl_event enqueue_task_command(
+      queue* q, const vector_class<cl_event>& wait_events,
+      shared_ptr_class<kernel> kern, shared_ptr_class<event> evnt);
 
   template <int dimensions>
-  static void enqueue_range_command(queue* q,
-                                    const vector_class<cl_event>& wait_events,
-                                    shared_ptr_class<kernel> kern, event* evnt,
-                                    range<dimensions> num_work_items,
-                                    id<dimensions> offset) {
-    prepare_kernel(kern);
-    kern->enqueue_range(q, wait_events, evnt, num_work_items, offset);
+  static cl_event enqueue_range_command(
+      queue* q, const vector_class<cl_event>& wait_events,
+      shared_ptr_class<kernel> kern, shared_ptr_class<event> evnt,
+      range<dimensions> num_work_items, id<dimensions> offset) {
+    auto lock = prepare_kernel(kern);
+    kern->enqueue_range(q, wait_events, evnt.get(), num_work_items, offset);
+    lock.unlock();
+    finish_kernel(q, kern, evnt);
+    return evnt->get();
   }
 
   template <int dimensions>
-  static void enqueue_nd_range_command(
+  static cl_event enqueue_nd_range_command(
       queue* q, const vector_class<cl_event>& wait_events,
-      shared_ptr_class<kernel> kern, event* evnt,
+      shared_ptr_class<kernel> kern, shared_ptr_class<event> evnt,
       nd_range<dimensions> execution_range) {
-    prepare_kernel(kern);
-    kern->enqueue_nd_range(q, wait_events, evnt, execution_range);
+    auto lock = prepare_kernel(kern);
+    kern->enqueue_nd_range(q, wait_events, evnt.get(), execution_range);
+    lock.unlock();
+    finish_kernel(q, kern, evnt);
+    return evnt->get();
   }
 
  public:
   static void write_buffers_to_device(shared_ptr_class<kernel> kern);
-  static void read_buffers_from_device(shared_ptr_class<kernel> kern);
 
-  static void enqueue_task(shared_ptr_class<kernel> kern, event* evnt);
+  static void enqueue_task(shared_ptr_class<kernel> kern,
+                           shared_ptr_class<event> evnt);
 
   template <int dimensions>
-  static void enqueue_range(shared_ptr_class<kernel> kern, event* evnt,
+  static void enqueue_range(shared_ptr_class<kernel> kern,
+                            shared_ptr_class<event> evnt,
                             range<dimensions> num_work_items,
                             id<dimensions> offset) {
+    command::group_detail::add_build(kern->built);
     command::group_detail::add_kernel_enqueue_range(
         enqueue_range_command, __func__, kern, evnt, num_work_items, offset);
   }
 
   template <int dimensions>
-  static void enqueue_nd_range(shared_ptr_class<kernel> kern, event* evnt,
+  static void enqueue_nd_range(shared_ptr_class<kernel> kern,
+                               shared_ptr_class<event> evnt,
                                nd_range<dimensions> execution_range) {
+    command::group_detail::add_build(kern->built);
     command::group_detail::add_kernel_enqueue_nd_range(
         enqueue_nd_range_command, __func__, kern, evnt, execution_range);
   }
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+#include "SYCL/detail/src_handlers/kernel_source.h"
+#include <map>
+#include <utility>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+namespace kernel_ns {
+
+/**
+ * Merges the kernels of consecutive command groups into one kernel.
+ * Only 1-D range kernels over the same range are fused,
+ * when the second one reads the output of the first one,
+ * and both only access the buffers they share at the work-item's own index.
+ * The last value the first kernel stores is then reused by the second one,
+ * instead of being loaded again from global memory.
+ *
+ * A queue holds back a command group with a fusible kernel
+ * until the next command group is submitted,
+ * or until the host needs the results.
+ * Disabled by default.
+ * Enabled with set_enabled or the SYCL_GTX_FUSE_KERNELS environment variable.
+ */
+class fusion {
+ public:
+  struct stats {
+    ::size_t fused;
+    // Buffer reads replaced by the value stored by the earlier kernel
+    ::size_t loads_forwarded;
+  };
+
+ private:
+  /** Keeps a long chain of kernels from being fused into one huge kernel */
+  static const ::size_t max_statements = 256;
+
+  // Guards the configuration, names and statistics
+  static mutex_class mutex;
+  static bool is_configured;
+  static bool enabled;
+  static std::map<std::pair<::size_t, ::size_t>, ::size_t> kernel_name_ids;
+  static stats totals;
+
+ public:
+  static void set_enabled(bool enable);
+  static bool is_enabled();
+
+  /** Whether the consumer can run in the same work-item after the producer */
+  static bool can_fuse(const source& producer, const source& consumer);
+
+  /** The same pair of kernels always gets the same name */
+  static ::size_t get_kernel_name_id(::size_t producer_id,
+                                     ::size_t consumer_id);
+
+  static source fuse(const source& producer, const source& consumer,
+                     ::size_t kernel_name_id);
+
+  static stats get_stats();
+};
+
+}  // namespace kernel_ns
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -5,7 +5,7 @@
 #include "SYCL/detail/common.h"
 #include "SYCL/detail/counter.h"
 #include "SYCL/detail/debug.h"
-#include <map>
+#include "SYCL/detail/ir.h"
 
 namespace cl {
 namespace sycl {
@@ -17,18 +17,23 @@ class queue;
 
 namespace detail {
 
-// Forward declaration
+// Forward declarations
+class command_graph;
 class issue_command;
 
 namespace kernel_ns {
 
-// Forward declaration
+// Forward declarations
 template <class Input>
 struct constructor;
+class fusion;
+class optimizer;
+class trace_cache;
 
-class source : protected counter<source> {
+class source {
  private:
   struct buf_info {
+    void* resource;
     buffer_access acc;
     string_class resource_name;
     string_class type_name;
@@ -36,19 +41,29 @@ class source : protected counter<source> {
   };
 
   static const string_class resource_name_root;
-  SYCL_THREAD_LOCAL static int num_resources;
+  static const string_class kernel_name_root;
 
-  string_class tab_offset;
+  unsigned int depth;
 
   string_class kernel_name;
-  vector_class<string_class> lines;
-  std::map<void*, buf_info> resources;
+  // Nodes of all statements, shared by copies of this source
+  shared_ptr_class<ir::arena> nodes;
+  vector_class<ir::statement> lines;
+  // Kernel parameters, in the order they were first used
+  vector_class<buf_info> resources;
+  // Scalar parameters, following the resources
+  vector_class<command::scalar> scalars;
+  counter_t num_variables = 0;
 
   // TODO(progtx): Multithreading support
   SYCL_THREAD_LOCAL static source* scope;
 
   template <class Input>
   friend struct constructor;
+  friend class fusion;
+  friend class optimizer;
+  friend class trace_cache;
+  friend class ::cl::sycl::detail::command_graph;
   friend class ::cl::sycl::detail::issue_command;
 
   string_class generate_accessor_list() const;
@@ -56,16 +71,33 @@ class source : protected counter<source> {
   static void enter(source& src);
   static source exit(source& src);
 
+  buf_info* find_resource(void* resource);
+  /** Takes the scalar parameters from the current command group */
+  void bind_scalars();
+
+  static void add_statement(ir::statement_t type, const string_class& text,
+                            const ir::expr* first = nullptr,
+                            const ir::expr* second = nullptr,
+                            bool auto_end = true);
+
  public:
-  source()
-      : tab_offset("\t"),
-        kernel_name(string_class("_sycl_kernel_") +
-                    get_string<counter_t>::get(get_count_id())) {}
+  source() : depth(1) {}
+
+  /**
+   * The kernel name only depends on the kernel type,
+   * so tracing the same kernel again produces the same code
+   */
+  explicit source(::size_t kernel_name_id)
+      : depth(1),
+        kernel_name(kernel_name_root +
+                    get_string<::size_t>::get(kernel_name_id)) {}
 
   static bool in_scope();
+  static counter_t next_variable_id();
 
   string_class get_code() const;
   string_class get_kernel_name() const;
+  ir::arena::stats get_ir_stats() const;
 
   void init_kernel(program& p, shared_ptr_class<kernel> kern);
 
@@ -78,35 +110,48 @@ class source : protected counter<source> {
       return "";
     }
 
-    string_class resource_name;
-    auto buf = static_cast<buffer<DataType, dimensions>*>(acc.resource());
-    auto it = scope->resources.find(buf);
-
-    if (it == scope->resources.end()) {
-      resource_name = resource_name_root +
-                      get_string<decltype(num_resources)>::get(++num_resources);
-      scope->resources[buf] = {{buf, mode, target},
-                               resource_name,
-                               type_string<DataType>::get() + '*',
-                               acc.argument_size()};
-    } else {
-      resource_name = it->second.resource_name;
+    auto resource = acc.resource();
+    auto info = scope->find_resource(resource);
+    if (info != nullptr) {
+      return info->resource_name;
     }
 
+    auto buf = static_cast<buffer_detail<DataType, dimensions>*>(resource);
+    string_class resource_name =
+        resource_name_root +
+        get_string<::size_t>::get(scope->resources.size() + 1);
+    scope->resources.push_back({resource,
+                                {buf, mode, target},
+                                resource_name,
+                                type_string<DataType>::get() + '*',
+                                acc.argument_size()});
+
     return resource_name;
   }
 
   template <bool auto_end = true>
-  static void add(string_class line) {
-    scope->lines.push_back(scope->tab_offset + line + (auto_end ? ';' : ' '));
+  static void add(const string_class& line) {
+    add_statement(ir::statement_t::text, line, nullptr, nullptr, auto_end);
   }
 
+  static void add_expression(const ir::expr& expression);
+  static void add_assignment(const ir::expr& lhs, const char* op,
+                             const ir::expr& rhs);
+  static void add_declaration(const string_class& type, const ir::expr& name);
+  static void add_declaration(const string_class& type, const ir::expr& name,
+                              const ir::expr& init);
+  static void add_control(const string_class& header,
+                          const ir::expr& condition);
+  static void add_control(const string_class& header,
+                          const ir::expr& condition,
+                          const ir::expr& increment);
+
   static void add_curlies() {
     add<false>("{");
-    scope->tab_offset.push_back('\t');
+    ++scope->depth;
   }
   static void remove_curlies() {
-    scope->tab_offset.pop_back();
+    --scope->depth;
     add<false>("}");
   }
 
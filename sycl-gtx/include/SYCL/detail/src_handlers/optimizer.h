@@ -0,0 +1,68 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+#include "SYCL/detail/kernel_name.h"
+#include "SYCL/detail/src_handlers/kernel_source.h"
+#include <map>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+namespace kernel_ns {
+
+/**
+ * Optimization passes over the traced kernel IR, run before it is emitted.
+ * Only straight-line code between braces and control statements is rewritten,
+ * only variables whose address is never taken are touched,
+ * and temporaries are only introduced when their type is known.
+ *
+ * Disabled by default, so that the generated code can be compared.
+ * Selected per kernel with set_passes, or for all kernels
+ * with set_default_passes or the SYCL_GTX_IR_PASSES environment variable:
+ * "all", "none" or a comma separated list of "fold", "copy", "cse" and "dce".
+ */
+class optimizer {
+ public:
+  enum pass : unsigned int {
+    none = 0,
+    /** Folds arithmetic on literals and multiplications by one */
+    constant_folding = 1 << 0,
+    /** Replaces variables by the variable or literal they were copied from */
+    copy_propagation = 1 << 1,
+    /** Computes repeated expressions once, reusing or declaring a variable */
+    common_subexpressions = 1 << 2,
+    /** Removes unused variables and stores overwritten before being read */
+    dead_code = 1 << 3,
+    all = constant_folding | copy_propagation | common_subexpressions |
+          dead_code,
+  };
+
+ private:
+  // Guards the selected passes
+  static mutex_class mutex;
+  static bool is_configured;
+  static unsigned int default_passes;
+  static std::map<::size_t, unsigned int> kernel_passes;
+
+  /** The mutex has to be locked */
+  static void configure();
+
+ public:
+  /** Passes for kernels without their own selection */
+  static void set_default_passes(unsigned int passes);
+  static void set_passes(::size_t kernel_name_id, unsigned int passes);
+  template <class KernelType>
+  static void set_passes(unsigned int passes) {
+    set_passes(kernel_name::get<KernelType>(), passes);
+  }
+  static unsigned int get_passes(::size_t kernel_name_id);
+
+  /** Runs the passes selected for the kernel */
+  static void run(source& src, ::size_t kernel_name_id);
+  static void run_passes(source& src, unsigned int passes);
+};
+
+}  // namespace kernel_ns
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "SYCL/access.h"
+#include "SYCL/detail/common.h"
+#include "SYCL/detail/src_handlers/kernel_source.h"
+#include <map>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+namespace kernel_ns {
+
+/**
+ * Keeps the traced source of each kernel name,
+ * so that the kernel functor is only traced on its first submission.
+ * Later submissions rebind the accessors of the current command group
+ * to the traced kernel parameters.
+ *
+ * Disabled by default, because values captured by the functor
+ * are baked into the traced source.
+ * Values passed with scalar_arg are kernel arguments instead,
+ * so they can change between submissions, unless specialized.
+ * Enabled with set_enabled or the SYCL_GTX_TRACE_ONCE environment variable.
+ * Debug builds still trace every submission and report a changed kernel.
+ */
+class trace_cache {
+ private:
+  struct accessor_info {
+    access::mode mode;
+    access::target target;
+    vector_class<::size_t> shape;
+
+    bool operator==(const accessor_info& other) const;
+  };
+
+  struct entry {
+    source src;
+    // Accessors of the traced command group
+    vector_class<accessor_info> accessors;
+    // Index into accessors for each kernel resource
+    vector_class<::size_t> resource_slots;
+    // Scalars of the traced command group, values only if specialized
+    vector_class<command::scalar> scalars;
+  };
+
+  // Guards the configuration and the entries
+  static mutex_class mutex;
+  static bool is_configured;
+  static bool enabled;
+  static std::map<::size_t, entry> entries;
+
+  static vector_class<accessor_info> describe(
+      const vector_class<buffer_access>& accessors);
+  static vector_class<command::scalar> describe(
+      const vector_class<command::scalar>& scalars);
+
+ public:
+  static void set_enabled(bool enable);
+  static bool is_enabled();
+
+  /**
+   * Copies the traced source with the current accessors bound to it
+   * @return false if the kernel needs to be traced
+   */
+  static bool find(::size_t kernel_name_id, source& src);
+
+  static void add(::size_t kernel_name_id, const source& src);
+
+  /** Reports an error if tracing again produced a different kernel */
+  static void verify(const source& cached, const source& traced);
+
+  static void clear();
+};
+
+}  // namespace kernel_ns
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "SYCL/access.h"
 #include "SYCL/detail/common.h"
+#include <condition_variable>
 #include <map>
 #include <set>
+#include <unordered_map>
 
 namespace cl {
 namespace sycl {
@@ -16,21 +19,57 @@ namespace detail {
 class accessor_base;
 class buffer_base;
 
+/**
+ * Keeps the host accessors and the command groups of all queues in order.
+ * Buffers are indexed with the queues whose command groups use them,
+ * so a host accessor only flushes and waits on those queues.
+ * The set of queues is guarded by a mutex that is never held while blocking,
+ * the queues in use are pinned instead and a destroyed queue waits for them.
+ * The host accessors and the index are guarded by mutexes locked after it.
+ */
 class synchronizer {
  private:
+  static mutex_class queues_mutex;
   static std::set<queue*> queues;
+  // Number of threads flushing or waiting on each queue
+  static std::map<queue*, ::size_t> pinned;
+  static std::condition_variable unpinned;
+  static mutex_class host_accessors_mutex;
   static std::map<accessor_base*, buffer_base*> host_accessors;
+  // Number of host accessors to each buffer
+  static std::unordered_map<buffer_base*, ::size_t> host_accessed;
+  static mutex_class users_mutex;
+  // Queues with command groups using the buffer that have not completed
+  static std::unordered_map<buffer_base*, std::set<queue*>> users;
 
+  static vector_class<queue*> get_users(buffer_base* buf);
+  static vector_class<queue*> pin_users(buffer_base* buf);
+  static void unpin(const vector_class<queue*>& queues_in_use);
+  /** Calls f with each queue using the buffer, locked */
+  template <class F>
+  static void for_each_user(buffer_base* buf, F f);
   static void wait_on_queues(buffer_base* buf);
   static void flush_queues(buffer_base* buf);
 
  public:
   static void add(queue* q);
   static void remove(queue* q);
-  static void add(accessor_base* acc, buffer_base* buf);
+  /** Waits for the buffer to be available on the host */
+  static void add(accessor_base* acc, buffer_base* buf, access::mode mode);
   static void remove(accessor_base* acc, buffer_base* buf);
 
+  /** Called when a command group using the buffers is submitted */
+  static void use(queue* q, const std::set<buffer_base*>& buffers);
+  /** Called when the command groups using the buffers have completed */
+  static void release(queue* q, const vector_class<buffer_base*>& buffers);
+
   static bool can_flush(const std::set<detail::buffer_base*>& buffers_in_use);
+
+  /**
+   * Flushes command groups using the buffer that were waiting
+   * for their kernels to build and the batched ones, before blocking on them
+   */
+  static void flush_deferred(buffer_base* buf);
 };
 
 }  // namespace detail
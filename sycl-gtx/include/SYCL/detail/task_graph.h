@@ -0,0 +1,113 @@
+#pragma once
+
+#include "SYCL/detail/common.h"
+#include "SYCL/event.h"
+#include <deque>
+#include <map>
+#include <ostream>
+#include <set>
+
+namespace cl {
+namespace sycl {
+namespace detail {
+
+// Forward declaration
+class buffer_base;
+
+/**
+ * Dependencies between the command groups submitted to a queue.
+ *
+ * Each command group is a node, with edges from earlier nodes
+ * it has a read-after-write, write-after-read or write-after-write hazard
+ * with on some buffer.
+ * A node only waits for its predecessors,
+ * so independent command groups run concurrently on the pooled queues.
+ */
+class task_graph {
+ public:
+  enum class hazard { raw, war, waw };
+
+  struct node;
+  using node_ptr = shared_ptr_class<node>;
+
+  struct edge {
+    ::size_t from_id;
+    hazard type;
+    // Released once the node is enqueued
+    node_ptr from;
+  };
+
+  struct node {
+    ::size_t id;
+    // Length of the longest path ending here
+    ::size_t depth;
+    ::size_t num_reads;
+    ::size_t num_writes;
+    vector_class<edge> predecessors;
+    bool is_flushed;
+    // Released once the node is retired, only the ids and edges stay
+    event completion;
+    // Commands enqueued for the node, in order
+    vector_class<event> commands;
+
+    bool is_complete() const;
+  };
+
+  struct stats {
+    ::size_t nodes;
+    ::size_t edges;
+    ::size_t critical_path;
+  };
+
+  /** Most recent nodes kept for dump */
+  static const ::size_t max_history = 1024;
+
+ private:
+  struct buffer_state {
+    node_ptr last_writer;
+    // Nodes reading the buffer since the last write
+    vector_class<node_ptr> readers;
+  };
+
+  std::map<buffer_base*, buffer_state> buffers;
+  std::deque<node_ptr> history;
+  // Nodes still holding their events
+  vector_class<node_ptr> active;
+  stats totals = {0, 0, 0};
+
+  static void add_edge(node& to, const node_ptr& from, hazard type);
+
+ public:
+  /** Reads exclude accesses that discard the previous contents */
+  node_ptr add(const std::set<buffer_base*>& reads,
+               const std::set<buffer_base*>& writes);
+
+  /**
+   * Completion events of the predecessors of the node
+   * @return false if a predecessor has not been enqueued yet
+   */
+  static bool get_wait_events(const node& n, vector_class<cl_event>& events);
+
+  static void set_flushed(node& n, event completion,
+                          vector_class<event> commands = {});
+
+  /**
+   * Releases the events of completed nodes
+   * and forgets buffers whose last nodes have completed, returning them
+   */
+  vector_class<buffer_base*> retire();
+
+  stats get_stats() const;
+
+  /** Most recent nodes, oldest first */
+  const std::deque<node_ptr>& get_nodes() const {
+    return history;
+  }
+
+  /** Writes the most recent nodes in the Graphviz DOT format */
+  void dump(std::ostream& os) const;
+};
+
+}  // namespace detail
+}  // namespace sycl
+}  // namespace cl
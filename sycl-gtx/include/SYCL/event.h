@@ -8,6 +8,7 @@
 #include "SYCL/info.h"
 #include "SYCL/param_traits.h"
 #include "SYCL/refc.h"
+#include <future>
 
 namespace cl {
 namespace sycl {
@@ -15,6 +16,12 @@ namespace sycl {
 // Forward declaration
 class kernel;
 
+namespace detail {
+/** Callback for event::then, fulfilling the promise with the status */
+function_class<void(::cl_int)> fulfil(
+    shared_ptr_class<std::promise<void>> promise);
+}  // namespace detail
+
 class event {
  private:
   friend class kernel;
@@ -28,7 +35,7 @@ class event {
   explicit event(cl_event clEvent);
 
   /** Return the underlying OpenCL event reference */
-  cl_event get();
+  cl_event get() const;
 
   /**
    * Return the list of events that this event waits for in the dependence
@@ -45,6 +52,19 @@ class event {
   void wait_and_throw();
   static void wait_and_throw(const vector_class<event>& event_list);
 
+  /** Non-blocking check whether the command has finished or failed */
+  bool is_complete() const;
+
+  /**
+   * Calls the callback with the execution status of the command
+   * once it has finished or failed, possibly on a thread of the driver.
+   * The callback must not block on OpenCL commands. Not in SYCL 1.2.
+   */
+  void then(function_class<void(::cl_int)> callback) const;
+
+  /** Ready once the command has finished, holds its error if it failed */
+  std::future<void> get_future() const;
+
   template <info::event param>
   typename param_traits<info::event, param>::type get_info() const {
     return detail::non_vector_traits<info::event, param, 1>().get(evnt.get());
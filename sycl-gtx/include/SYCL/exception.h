@@ -15,6 +15,7 @@ namespace detail {
 namespace error {
 struct thrower;
 }
+struct async_errors;
 }  // namespace detail
 
 struct exception : std::exception_ptr {
@@ -63,6 +64,16 @@ struct cl_exception : exception {
 
 struct async_exception : exception {
   // stored in an exception_list for asynchronous errors
+  async_exception() = default;
+
+ private:
+  friend struct detail::async_errors;
+
+  /** Wraps an exception thrown on another thread, such as by a host task */
+  async_exception(std::exception_ptr thrown, string_class description)
+      : exception(std::move(description)) {
+    std::exception_ptr::operator=(std::move(thrown));
+  }
 };
 
 using exception_ptr = std::exception_ptr;
@@ -70,6 +81,7 @@ using exception_ptr = std::exception_ptr;
 // TODO(progtx): Used as a container for a list of asynchronous exceptions
 class exception_list {
  private:
+  friend struct detail::async_errors;
   using list_t = vector_class<async_exception>;
   list_t list;
 
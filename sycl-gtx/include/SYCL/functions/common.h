@@ -8,12 +8,11 @@
 namespace cl {
 namespace sycl {
 
-#define SYCL_ONE_ARG(NAME)                                                \
-  template <class First>                                                  \
-  static detail::data_ref NAME(const First& first) {                      \
-    using detail::data_ref;                                               \
-    return data_ref(string_class(#NAME "(") + data_ref::get_name(first) + \
-                    ')');                                                 \
+#define SYCL_ONE_ARG(NAME)                                                 \
+  template <class First>                                                   \
+  static detail::data_ref NAME(const First& first) {                       \
+    using detail::data_ref;                                                \
+    return data_ref(detail::ir::call(#NAME, {data_ref::get_name(first)})); \
   }
 
 SYCL_ONE_ARG(cos);
@@ -27,8 +26,8 @@ SYCL_ONE_ARG(sqrt);
   template <class First, class Second>                                     \
   static detail::data_ref NAME(const First& first, const Second& second) { \
     using detail::data_ref;                                                \
-    return data_ref(string_class(#NAME "(") + data_ref::get_name(first) +  \
-                    ", " + data_ref::get_name(second) + ")");              \
+    return data_ref(detail::ir::call(                                      \
+        #NAME, {data_ref::get_name(first), data_ref::get_name(second)}));  \
   }
 
 SYCL_TWO_ARG(min);
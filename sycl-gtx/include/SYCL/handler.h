@@ -3,6 +3,7 @@
 // 3.5.3 SYCL functions for invoking kernels
 
 #include "SYCL/access.h"
+#include "SYCL/detail/buffer_command.h"
 #include "SYCL/detail/common.h"
 #include "SYCL/detail/function_traits.h"
 #include "SYCL/detail/src_handlers/issue_command.h"
@@ -30,6 +31,8 @@ class handler {
 
   queue* q;
   handler_event events;
+  // Arguments for kernel objects, from set_arg
+  vector_class<kernel::argument> kernel_args;
 
   // TODO(progtx): Implementation defined constructor
   handler(queue* q) : q(q) {}
@@ -40,7 +43,9 @@ class handler {
   shared_ptr_class<kernel> build(KernelType kernFunctor) {
     detail::command::group_detail::check_scope();
     program prog(get_context(q));
-    prog.build(kernFunctor, "");
+    prog.compile(kernFunctor, "");
+    // Waited for only when the kernel is enqueued
+    prog.link_async();
 
     // We know here the program only contains one kernel
     return prog.kernels.begin()->second;
@@ -48,14 +53,45 @@ class handler {
 
   using issue = detail::issue_command;
 
+  void add_kernel_arg(kernel::argument arg) {
+    for (auto& other : kernel_args) {
+      if (other.index == arg.index) {
+        other = std::move(arg);
+        return;
+      }
+    }
+    kernel_args.push_back(std::move(arg));
+  }
+
+  shared_ptr_class<kernel> with_args(kernel syclKernel) {
+    auto kern = shared_ptr_class<kernel>(new kernel(std::move(syclKernel)));
+    kern->arguments = kernel_args;
+    return kern;
+  }
+
   template <class... Args>
   void issue_enqueue(shared_ptr_class<kernel> kern,
-                     void (*issue_enqueue_f)(shared_ptr_class<kernel>, event*,
-                                             Args...),
+                     void (*issue_enqueue_f)(shared_ptr_class<kernel>,
+                                             shared_ptr_class<event>, Args...),
                      Args... params) {
     issue::write_buffers_to_device(kern);
-    issue_enqueue_f(kern, &events.kernelEvent, params...);
-    issue::read_buffers_from_device(kern);
+    // The handler is gone by the time the command runs
+    issue_enqueue_f(kern, shared_ptr_class<event>(new event()), params...);
+  }
+
+  /**
+   * Returns a kernel that also runs the kernel of the previous command group,
+   * if the two can be fused, see kernel_ns::fusion
+   */
+  shared_ptr_class<kernel> fuse(shared_ptr_class<kernel> kern,
+                                ::size_t kernel_name_id,
+                                range<1> num_work_items, id<1> offset);
+  template <int dimensions>
+  shared_ptr_class<kernel> fuse(shared_ptr_class<kernel> kern,
+                                ::size_t /*kernel_name_id*/,
+                                range<dimensions> /*num_work_items*/,
+                                id<dimensions> /*offset*/) {
+    return kern;
   }
 
   template <typename KernelName, class KernelType, int dimensions>
@@ -63,6 +99,8 @@ class handler {
                           id<dimensions> workItemOffset,
                           KernelType kernFunctor) {
     auto kern = build(kernFunctor);
+    kern = fuse(kern, detail::kernel_name::get<KernelType>(), numWorkItems,
+                workItemOffset);
     issue_enqueue(kern, &issue::enqueue_range, numWorkItems, workItemOffset);
   }
   // TODO(progtx): Why is the offset needed? It's already contained in the
@@ -75,15 +113,121 @@ class handler {
     issue_enqueue(kern, &issue::enqueue_nd_range, executionRange);
   }
 
+  template <typename DataType, int dimensions, access::mode mode,
+            access::target target>
+  static detail::buffer_access get_buffer_access(
+      const accessor<DataType, dimensions, mode, target>& acc_obj) {
+    static_assert(target == access::target::global_buffer ||
+                      target == access::target::constant_buffer,
+                  "Buffer commands require device buffer accessors");
+    const detail::accessor_core<DataType, dimensions, mode, target>& acc =
+        acc_obj;
+    return {static_cast<detail::buffer_detail<DataType, dimensions>*>(
+                acc.resource()),
+            mode, target};
+  }
+
+  template <access::mode mode>
+  static void check_readable() {
+    static_assert(mode == access::mode::read ||
+                      mode == access::mode::read_write ||
+                      mode == access::mode::discard_read_write,
+                  "The source accessor must be readable");
+  }
+
+  template <access::mode mode, access::target target>
+  static void check_writable() {
+    static_assert(mode != access::mode::read &&
+                      target == access::target::global_buffer,
+                  "The destination accessor must be writable");
+  }
+
  public:
-  // TODO(progtx):
+  /**
+   * Sets a kernel argument for the kernel objects invoked afterwards.
+   * Kernels from functors take their arguments from the traced source.
+   */
   template <typename DataType, int dimensions, access::mode mode,
             access::target target>
   void set_arg(int arg_index,
-               accessor<DataType, dimensions, mode, target>& acc_obj);
+               accessor<DataType, dimensions, mode, target>& acc_obj) {
+    const detail::accessor_core<DataType, dimensions, mode, target>& acc =
+        acc_obj;
+    auto buf = static_cast<detail::buffer_detail<DataType, dimensions>*>(
+        acc.resource());
+    add_kernel_arg({static_cast<::cl_uint>(arg_index),
+                    acc.argument_size(),
+                    {buf, mode, target},
+                    {}});
+  }
 
   template <typename T>
-  void set_arg(int arg_index, T scalar_value);
+  void set_arg(int arg_index, T scalar_value) {
+    auto bytes = reinterpret_cast<const char*>(&scalar_value);  // NOLINT
+    add_kernel_arg({static_cast<::cl_uint>(arg_index),
+                    sizeof(T),
+                    {nullptr, access::mode::read, access::target::host_buffer},
+                    vector_class<char>(bytes, bytes + sizeof(T))});
+  }
+
+  /**
+   * Runs a host function once the commands before it complete,
+   * without blocking the submitting thread. Not in SYCL 1.2.
+   * Buffers are accessed through host_buffer accessors requested with
+   * get_access(cgh) before it, see detail::host_task.
+   */
+  void host_task(function_class<void()> task);
+
+  // Explicit memory operations, see detail::buffer_command
+
+  /** Copies the whole source buffer to the start of the destination */
+  template <typename DataType, int dimSrc, access::mode modeSrc,
+            access::target targetSrc, int dimDst, access::mode modeDst,
+            access::target targetDst>
+  void copy(const accessor<DataType, dimSrc, modeSrc, targetSrc>& src,
+            const accessor<DataType, dimDst, modeDst, targetDst>& dst) {
+    check_readable<modeSrc>();
+    check_writable<modeDst, targetDst>();
+    detail::buffer_command::copy(get_buffer_access(src),
+                                 get_buffer_access(dst));
+  }
+
+  /** Reads the whole buffer into dst */
+  template <typename DataType, int dimensions, access::mode mode,
+            access::target target>
+  void copy(const accessor<DataType, dimensions, mode, target>& src,
+            DataType* dst) {
+    check_readable<mode>();
+    detail::buffer_command::copy(get_buffer_access(src), dst);
+  }
+
+  /** Overwrites the whole buffer from src */
+  template <typename DataType, int dimensions, access::mode mode,
+            access::target target>
+  void copy(const DataType* src,
+            const accessor<DataType, dimensions, mode, target>& dst) {
+    check_writable<mode, target>();
+    detail::buffer_command::copy(src, get_buffer_access(dst));
+  }
+
+  template <typename DataType, int dimensions, access::mode mode,
+            access::target target>
+  void fill(const accessor<DataType, dimensions, mode, target>& dst,
+            const DataType& value) {
+    check_writable<mode, target>();
+    auto bytes = reinterpret_cast<const char*>(&value);  // NOLINT
+    detail::buffer_command::fill(
+        get_buffer_access(dst),
+        vector_class<char>(bytes, bytes + sizeof(DataType)));
+  }
+
+  /** Brings the host data of the buffer up to date without blocking */
+  template <typename DataType, int dimensions, access::mode mode,
+            access::target target>
+  void update_host(const accessor<DataType, dimensions, mode, target>& acc) {
+    check_readable<mode>();
+    detail::buffer_command::update_host(get_buffer_access(acc));
+  }
 
   /** 3.5.3.1 Single Task invoke */
   template <typename KernelName, class KernelType>
@@ -192,19 +336,19 @@ class handler {
 
   template <bool = true>
   void single_task(kernel syclKernel) {
-    auto kern = shared_ptr_class<kernel>(new kernel(std::move(syclKernel)));
+    auto kern = with_args(std::move(syclKernel));
     issue_enqueue(kern, &issue::enqueue_task);
   }
 
   template <int dimensions>
   void parallel_for(range<dimensions> numWorkItems, kernel syclKernel) {
-    auto kern = shared_ptr_class<kernel>(new kernel(std::move(syclKernel)));
+    auto kern = with_args(std::move(syclKernel));
     issue_enqueue(kern, &issue::enqueue_range, numWorkItems, id<dimensions>());
   }
 
   template <int dimensions>
   void parallel_for(nd_range<dimensions> ndRange, kernel syclKernel) {
-    auto kern = shared_ptr_class<kernel>(new kernel(std::move(syclKernel)));
+    auto kern = with_args(std::move(syclKernel));
     issue_enqueue(kern, &issue::enqueue_nd_range, ndRange);
   }
 };
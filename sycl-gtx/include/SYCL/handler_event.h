@@ -1,21 +1,26 @@
 #pragma once
 
+#include "SYCL/detail/pending_event.h"
 #include "SYCL/event.h"
 
 namespace cl {
 namespace sycl {
 
-// Forward declaration
+// Forward declarations
 class handler;
+class queue;
 
 // TODO(progtx):
 class handler_event {
  private:
   friend class handler;
+  friend class queue;
 
   event kernelEvent;
   event completeEvent;
   event endEvent;
+  // Not set for command groups that were only recorded
+  shared_ptr_class<detail::pending_event> pending;
 
  public:
   event get_kernel() const {
@@ -27,6 +32,28 @@ class handler_event {
   event get_end() const {
     return endEvent;
   }
+
+  /**
+   * Non-blocking completion of the command group, not in SYCL 1.2.
+   * These enqueue the command group and flush it to the device first.
+   */
+  bool is_complete() const {
+    return pending == nullptr || pending->is_complete();
+  }
+  /**
+   * Calls the callback with the execution status once the command group
+   * has finished, possibly on another thread
+   */
+  void then(function_class<void(::cl_int)> callback) const {
+    if (pending == nullptr) {
+      callback(CL_COMPLETE);
+    } else {
+      pending->then(std::move(callback));
+    }
+  }
+  std::future<void> get_future() const {
+    return pending == nullptr ? event().get_future() : pending->get_future();
+  }
 };
 
 }  // namespace sycl
@@ -181,6 +181,12 @@ enum class device_execution_capabilities : cl_device_exec_capabilities {
 };
 
 using queue_profiling = bool;
+/**
+ * Commands of independent command groups may run concurrently,
+ * ordered only by the events they wait on.
+ * Not part of the SYCL specification.
+ */
+using queue_out_of_order = bool;
 /** C.4 Queue Information Descriptors */
 enum class queue : cl_command_queue_info {
   context = CL_QUEUE_CONTEXT,
@@ -4,7 +4,9 @@
 
 #include "SYCL/context.h"
 #include "SYCL/detail/common.h"
+#include "SYCL/detail/compile_pool.h"
 #include "SYCL/detail/debug.h"
+#include "SYCL/detail/program_cache.h"
 #include "SYCL/detail/src_handlers/kernel_source.h"
 #include "SYCL/error_handler.h"
 #include "SYCL/info.h"
@@ -24,7 +26,9 @@ class program;
 
 class kernel {
  private:
+  friend class handler;
   friend class program;
+  friend class detail::command_graph;
   friend class detail::issue_command;
   friend class detail::kernel_ns::source;
 
@@ -32,12 +36,29 @@ class kernel {
   context ctx;
   shared_ptr_class<program> prog;
   detail::kernel_ns::source src;
+  shared_ptr_class<detail::program_cache::entry> cache_entry;
+  // Set while the kernel is built on a compile thread
+  detail::compile_pool::future_t built;
+
+  /** Set with handler::set_arg, for kernels not traced from a functor */
+  struct argument {
+    ::cl_uint index;
+    ::size_t size;
+    // Only for accessors
+    detail::buffer_access acc;
+    // Only for scalars
+    vector_class<char> value;
+  };
+  vector_class<argument> arguments;
 
   // These are meant only for program class
   kernel(bool);
   void set(cl_kernel openclKernelObject);
   void set(const context& context, cl_program validProgram);
 
+  /** Rethrows any error from building the kernel */
+  void wait_for_build() const;
+
  public:
   /**
    * The default object is not valid
@@ -82,7 +103,7 @@ class kernel {
   }
 
  private:
-  static cl_event get_cl_event(event* evnt);
+  static void set_cl_event(event* evnt, cl_event ev);
   static cl_command_queue get_cl_queue(queue* q);
 
   static const cl_event* get_events_ptr(
@@ -99,13 +120,14 @@ class kernel {
                      id<dimensions> offset) const {
     ::size_t* global_work_size = &num_work_items[0];
     ::size_t* offst = &static_cast<::size_t&>(offset[0]);
-    auto ev = get_cl_event(evnt);
+    cl_event ev;
 
     auto error_code = clEnqueueNDRangeKernel(
         get_cl_queue(q), kern.get(), dimensions, offst, global_work_size,
         nullptr, static_cast<::cl_uint>(wait_events.size()),
         get_events_ptr(wait_events), &ev);
     detail::error::report(error_code);
+    set_cl_event(evnt, ev);
   }
 
   template <int dimensions>
@@ -127,13 +149,14 @@ class kernel {
       }
     }
 
-    auto ev = get_cl_event(evnt);
+    cl_event ev;
 
     auto error_code = clEnqueueNDRangeKernel(
         get_cl_queue(q), kern.get(), dimensions, offst, global_work_size,
         local_work_size, static_cast<::cl_uint>(wait_events.size()),
         get_events_ptr(wait_events), &ev);
     detail::error::report(error_code);
+    set_cl_event(evnt, ev);
   }
 };
 
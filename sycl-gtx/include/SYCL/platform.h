@@ -22,6 +22,7 @@ class platform {
 
   platform(cl_platform_id platform_id, device_selector& dev_selector);
 
+  static mutex_class platforms_mutex;
   static vector_class<platform> platforms;
 
  public:
@@ -4,10 +4,13 @@
 
 #include "SYCL/context.h"
 #include "SYCL/detail/common.h"
+#include "SYCL/detail/compile_pool.h"
 #include "SYCL/detail/function_traits.h"
 #include "SYCL/detail/kernel_name.h"
 #include "SYCL/detail/src_handlers/invoke_source.h"
 #include "SYCL/detail/src_handlers/kernel_source.h"
+#include "SYCL/detail/src_handlers/optimizer.h"
+#include "SYCL/detail/src_handlers/trace_cache.h"
 #include "SYCL/device.h"
 #include "SYCL/error_handler.h"
 #include "SYCL/info.h"
@@ -36,6 +39,14 @@ class program {
   vector_class<device> devices;
   std::map<::size_t, shared_ptr_class<kernel>> kernels;
 
+  struct pending_compile {
+    shared_ptr_class<kernel> kern;
+    string_class code;
+    string_class options;
+  };
+  /** Compiled on link, unless a built binary is found in the cache */
+  vector_class<pending_compile> pending;
+
   program(cl_program clProgram, const context& context,
           vector_class<device> deviceList);
 
@@ -44,15 +55,55 @@ class program {
 
   void compile(string_class compile_options, ::size_t kernel_name_id,
                shared_ptr_class<kernel> kern);
-  void report_compile_error(shared_ptr_class<kernel> kern, device& dev) const;
+  void compile(pending_compile& p);
+  /** True if all kernels are pending and share the compile options */
+  bool can_build_from_source() const;
+  string_class get_pending_code() const;
+  /** Builds all pending kernels as one source with clBuildProgram */
+  void build_batched(const string_class& linking_options);
+  bool build_from_binaries(const string_class& descriptor,
+                           const string_class& linking_options);
+  /** Sets up the kernels once the program is built from all of them */
+  void init_built_program(const string_class& linking_options);
+  void link_programs(const string_class& linking_options);
+  /**
+   * Links on a compile thread if a kernel still needs to be compiled.
+   * The kernels wait for the build when enqueued,
+   * this program object itself is left without the linked program.
+   */
+  void link_async(string_class linking_options = "");
+  void report_compile_error(cl_program failed, device& dev) const;
+
+  template <class KernelType>
+  static detail::kernel_ns::source trace(KernelType kernFunctor,
+                                         ::size_t kernel_name_id) {
+    using detail::kernel_ns::optimizer;
+    using detail::kernel_ns::trace_cache;
+    using constructor = detail::kernel_ns::constructor<
+        typename detail::first_arg<KernelType>::type>;
+
+    detail::kernel_ns::source src;
+    if (trace_cache::find(kernel_name_id, src)) {
+#if SYCL_ENABLE_DEBUG
+      auto traced = constructor::get(kernFunctor, kernel_name_id);
+      optimizer::run(traced, kernel_name_id);
+      trace_cache::verify(src, traced);
+#endif
+      return src;
+    }
+
+    src = constructor::get(kernFunctor, kernel_name_id);
+    optimizer::run(src, kernel_name_id);
+    trace_cache::add(kernel_name_id, src);
+    return src;
+  }
 
   template <class KernelType>
   void compile(KernelType kernFunctor, string_class compile_options = "") {
-    auto src = detail::kernel_ns::constructor<
-        typename detail::first_arg<KernelType>::type>::get(kernFunctor);
+    auto kernel_name_id = detail::kernel_name::get<KernelType>();
     auto kern = shared_ptr_class<kernel>(new kernel(true));
-    kern->src = std::move(src);
-    compile(compile_options, detail::kernel_name::get<KernelType>(), kern);
+    kern->src = trace(kernFunctor, kernel_name_id);
+    compile(compile_options, kernel_name_id, kern);
   }
 
   template <class KernelType>
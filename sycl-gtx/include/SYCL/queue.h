@@ -4,40 +4,112 @@
 
 #include "SYCL/command_group.h"
 #include "SYCL/context.h"
+#include "SYCL/detail/command_graph.h"
 #include "SYCL/detail/common.h"
 #include "SYCL/detail/debug.h"
+#include "SYCL/detail/flush_batch.h"
 #include "SYCL/detail/synchronizer.h"
+#include "SYCL/detail/task_graph.h"
 #include "SYCL/device.h"
 #include "SYCL/error_handler.h"
 #include "SYCL/handler_event.h"
 #include "SYCL/info.h"
 #include "SYCL/param_traits.h"
 #include "SYCL/refc.h"
+#include <atomic>
+#include <list>
 
 namespace cl {
 namespace sycl {
 
-/** Encapsulation of an OpenCL cl_command_queue */
+namespace detail {
+
+/**
+ * Asynchronous errors of a queue, shared with its sub-queues.
+ * Host tasks add to them from other threads,
+ * they are passed to the async_handler by the next wait_and_throw
+ * or throw_asynchronous.
+ */
+struct async_errors {
+  mutex_class mutex;
+  exception_list list;
+
+  void add(exception_ptr thrown, string_class description);
+  /** Removes and returns the errors added so far */
+  exception_list take();
+};
+
+}  // namespace detail
+
+/**
+ * Encapsulation of an OpenCL cl_command_queue.
+ * Command groups can be submitted to it from several host threads.
+ * Buffers are not locked, so command groups of different queues
+ * using the same buffer need to be ordered by the application.
+ */
 class queue {
  private:
+  friend class detail::host_task;
+  friend class detail::pending_event;
   friend class detail::synchronizer;
 
   using buffer_set = std::set<detail::buffer_base*>;
+  using cl_queue_t = detail::refc<cl_command_queue, clRetainCommandQueue,
+                                  clReleaseCommandQueue>;
+  // Recursive, because the synchronizer flushes a queue it already locked
+  using mutex_t = std::recursive_mutex;
+
+  /** Each copy of a queue is locked on its own */
+  struct queue_mutex {
+    mutex_t value;
+    // Pending events about to lock the queue, waited for by the destructor
+    std::atomic<::size_t> starting;
+
+    queue_mutex() : starting(0) {}
+    queue_mutex(const queue_mutex&) : starting(0) {}
+    queue_mutex& operator=(const queue_mutex&) {
+      return *this;
+    }
+  };
+
+  /** Number of OpenCL queues shared by the command groups of one queue */
+  static const ::size_t command_q_pool_size = 4;
+  /** Sub-queues kept alive before the oldest ones are retired */
+  static const ::size_t max_subqueues = 64;
 
   context ctx;
   device dev;
-  detail::refc<cl_command_queue, clRetainCommandQueue, clReleaseCommandQueue>
-      command_q;
-  exception_list ex_list;
+  cl_queue_t command_q;
+  shared_ptr_class<detail::async_errors> errors{new detail::async_errors()};
   detail::command_group command_group;
-  buffer_set buffers_in_use;
   bool is_flushed = true;
-  vector_class<queue> subqueues;
+  bool is_subqueue = false;
+  info::queue_profiling enable_profiling = false;
+  info::queue_out_of_order out_of_order = false;
+  event completion;
+  // Completion of a sub-queue as seen by the handler_event of its submit
+  shared_ptr_class<detail::pending_event> pending;
+  // Node of a sub-queue in the graph of its master queue
+  detail::task_graph::node_ptr node;
+  detail::task_graph graph;
+  detail::flush_batch batch;
+  // Set between begin_recording and end_recording
+  unique_ptr_class<detail::command_graph> recording;
+  std::list<queue> subqueues;
+  vector_class<cl_queue_t> command_q_pool;
+  ::size_t next_pooled_q = 0;
+  // Compile threads enqueuing command groups once their kernels are built
+  vector_class<detail::compile_pool::future_t> build_watchers;
+  // Guards the state above against submissions from other host threads
+  mutable queue_mutex mutex;
 
   void display_device_info() const;
   cl_command_queue create_queue(bool display_info = true,
                                 bool register_with_synchronizer = true,
-                                info::queue_profiling enable_profiling = false);
+                                info::queue_profiling enable_profiling = false,
+                                info::queue_out_of_order out_of_order = false);
+  bool supports_out_of_order() const;
+  cl_command_queue get_pooled_queue();
 
  public:
   /**
@@ -64,6 +136,16 @@ class queue {
         info::queue_profiling profilingFlag,
         const async_handler& asyncHandler = detail::default_async_handler);
 
+  /**
+   * Creates an out-of-order OpenCL queue when requested
+   * and supported by the device.
+   * Command groups are then ordered only by their buffer dependencies.
+   */
+  queue(const context& syclContext, const device& syclDevice,
+        info::queue_profiling profilingFlag,
+        info::queue_out_of_order outOfOrderFlag,
+        const async_handler& asyncHandler = detail::default_async_handler);
+
   /** Creates a queue for the provided device. */
   queue(const device& syclDevice,
         const async_handler& asyncHandler = detail::default_async_handler);
@@ -81,9 +163,12 @@ class queue {
   queue(queue* master, T cgf)
       : ctx(master->ctx),
         dev(master->dev),
-        command_q(create_queue(false, false)),
+        command_q(master->get_pooled_queue()),
+        errors(master->errors),
         command_group(*this, cgf),
-        is_flushed(false) {}
+        is_flushed(false),
+        is_subqueue(true),
+        out_of_order(master->out_of_order) {}
 
  public:
   ~queue();
@@ -100,16 +185,32 @@ class queue {
       : SYCL_MOVE_INIT(ctx),
         SYCL_MOVE_INIT(dev),
         SYCL_MOVE_INIT(command_q),
-        SYCL_MOVE_INIT(ex_list),
+        SYCL_MOVE_INIT(errors),
         SYCL_MOVE_INIT(command_group),
-        SYCL_MOVE_INIT(buffers_in_use),
         SYCL_MOVE_INIT(is_flushed),
-        SYCL_MOVE_INIT(subqueues) {
+        SYCL_MOVE_INIT(is_subqueue),
+        SYCL_MOVE_INIT(enable_profiling),
+        SYCL_MOVE_INIT(out_of_order),
+        SYCL_MOVE_INIT(completion),
+        SYCL_MOVE_INIT(pending),
+        SYCL_MOVE_INIT(node),
+        SYCL_MOVE_INIT(graph),
+        SYCL_MOVE_INIT(batch),
+        SYCL_MOVE_INIT(recording),
+        SYCL_MOVE_INIT(subqueues),
+        SYCL_MOVE_INIT(command_q_pool),
+        SYCL_MOVE_INIT(next_pooled_q),
+        SYCL_MOVE_INIT(build_watchers) {
     move.command_q = nullptr;
     command_group.q = this;
+    adopt_subqueues();
   }
   queue& operator=(queue&& move) noexcept {
-    std::swap(*this, move);
+    swap(*this, move);
+    command_group.q = this;
+    move.command_group.q = &move;
+    adopt_subqueues();
+    move.adopt_subqueues();
     return *this;
   }
   friend void swap(queue& first, queue& second) {
@@ -117,11 +218,22 @@ class queue {
     SYCL_SWAP(ctx);
     SYCL_SWAP(dev);
     SYCL_SWAP(command_q);
-    SYCL_SWAP(ex_list);
+    SYCL_SWAP(errors);
     SYCL_SWAP(command_group);
-    SYCL_SWAP(buffers_in_use);
     SYCL_SWAP(is_flushed);
+    SYCL_SWAP(is_subqueue);
+    SYCL_SWAP(enable_profiling);
+    SYCL_SWAP(out_of_order);
+    SYCL_SWAP(completion);
+    SYCL_SWAP(pending);
+    SYCL_SWAP(node);
+    SYCL_SWAP(graph);
+    SYCL_SWAP(batch);
+    SYCL_SWAP(recording);
     SYCL_SWAP(subqueues);
+    SYCL_SWAP(command_q_pool);
+    SYCL_SWAP(next_pooled_q);
+    SYCL_SWAP(build_watchers);
   }
 
   bool is_host();
@@ -166,21 +278,90 @@ class queue {
   // TODO(progtx):
   template <typename T>
   handler_event submit(T cgf) {
+    std::lock_guard<mutex_t> lock(mutex.value);
+    if (recording != nullptr) {
+      recording->add(*this, cgf);
+      return handler_event();
+    }
+    retire_subqueues();
+    auto producer = get_fusion_producer();
+    detail::command::group_detail::set_producer(producer);
     subqueues.push_back({this, cgf});
-    return subqueues.back().process(buffers_in_use);
+    detail::command::group_detail::set_producer(nullptr);
+    if (producer != nullptr) {
+      // Only the next command group can be fused with it
+      producer->fusible.kern = nullptr;
+    }
+    auto& subqueue = subqueues.back();
+    auto& group = subqueue.command_group;
+    subqueue.node = add_node(group.read_buffers, group.write_buffers);
+    subqueue.pending.reset(new detail::pending_event(this));
+    handler_event submitted;
+    submitted.pending = subqueue.pending;
+    // Kernels still building are enqueued later, unless too many are waiting
+    flush(subqueues.size() >= max_subqueues);
+    return submitted;
   }
 
   // TODO(progtx):
   template <typename T>
   handler_event submit(T cgf, queue& secondaryQueue);
 
+  /** Dependencies between the submitted command groups, not in SYCL 1.2 */
+  const detail::task_graph& get_task_graph() const {
+    return graph;
+  }
+
+  /**
+   * Command groups submitted from now on are recorded instead of enqueued,
+   * until end_recording. Not in SYCL 1.2.
+   */
+  void begin_recording();
+  /** @return the command groups submitted since begin_recording */
+  detail::command_graph end_recording();
+  /**
+   * Enqueues the recorded command groups again.
+   * The graph must have been recorded on a queue with the same context.
+   * The host must not hold accessors to the buffers the graph uses,
+   * and reports CL_INVALID_MEM_OBJECT if one of them was destroyed.
+   */
+  void replay(detail::command_graph& recorded);
+
+  /** When enqueued commands are flushed to the device, not in SYCL 1.2 */
+  void set_flush_policy(const detail::flush_policy& policy);
+  detail::flush_policy get_flush_policy() const;
+  detail::flush_batch::stats get_flush_stats() const;
+
  private:
-  void flush();
+  /**
+   * Command groups are flushed in order,
+   * up to one still building or held back for kernel fusion
+   */
+  void flush(bool wait_for_builds = true);
+  /** Kernels still building for the command groups not enqueued yet */
+  vector_class<detail::compile_pool::future_t> get_builds() const;
+  /** The queue waits for the watcher before it is destroyed */
+  void add_build_watcher(detail::compile_pool::future_t watcher);
+  /** Flushes the batched command groups, before blocking on them */
+  void flush_commands();
   void finish();
   void wait_subqueues(bool and_throw);
-  handler_event process(buffer_set& buffers_in_use_master);
-  static vector_class<cl_event> get_wait_events(const buffer_set& dependencies,
-                                                buffer_set& buffers_in_use);
+  void retire_subqueues();
+  bool is_complete() const;
+  /** The last command group, if it was held back to fuse its kernel */
+  detail::command_group* get_fusion_producer();
+  /** Event completing after the commands issued for a task graph node */
+  event enqueue_completion(const vector_class<event>& issued,
+                           const vector_class<cl_event>& wait_events);
+  /** Points the pending events of the sub-queues to this queue */
+  void adopt_subqueues();
+  /** Adds a task graph node, indexing its buffers in the synchronizer */
+  detail::task_graph::node_ptr add_node(const buffer_set& read_buffers,
+                                        const buffer_set& write_buffers);
+  /** Removes completed command groups from the task graph */
+  void retire_buffers();
+  /** Enqueues the command group once its predecessors are enqueued */
+  handler_event process(detail::flush_batch& batch_master);
 };
 
 }  // namespace sycl
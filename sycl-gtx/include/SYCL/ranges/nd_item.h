@@ -111,7 +111,7 @@ struct nd_item {
         break;
     }
 
-    detail::kernel_add(string_class("barrier(") + flag_string + ")");
+    detail::kernel_add(detail::ir::call("barrier", {flag_string}));
   }
 };
 
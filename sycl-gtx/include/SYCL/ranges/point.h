@@ -171,7 +171,7 @@ struct point : data_ref {
     auto name_tmp = this->name;
 
     if (is_identifier()) {
-      name_tmp += get_string<::size_t>::get(dim);
+      name_tmp = name_tmp.str() + get_string<::size_t>::get(dim);
     } else if (this->type == type_t::numeric && name_tmp.empty()) {
       name_tmp = get_string<::size_t>::get(values[dim]);
     }
@@ -49,6 +49,10 @@ class refc : public refc_ptr<CL_Type> {
     call_retain(data);
   }
 
+  /** Takes over a reference, calling the deleter instead of release */
+  template <class Deleter>
+  refc(CL_Type data, Deleter deleter) : Base(data, deleter) {}
+
   refc(const refc&) = default;
   refc(refc&& move) noexcept : Base(std::move(move)) {}
   refc& operator=(const refc&) = default;
@@ -0,0 +1,83 @@
+#pragma once
+
+// Scalar kernel arguments, an extension to SYCL 1.2
+
+#include "SYCL/command_group.h"
+#include "SYCL/detail/common.h"
+#include "SYCL/detail/data_ref.h"
+#include "SYCL/detail/src_handlers/kernel_source.h"
+#include <type_traits>
+
+namespace cl {
+namespace sycl {
+
+namespace detail {
+
+/**
+ * OpenCL C type with the same size as the host type,
+ * because the sizes of size_t and long depend on the host
+ */
+template <typename T, bool = std::is_floating_point<T>::value>
+struct scalar_type_name {
+  static string_class get() {
+    return sizeof(T) == sizeof(double) ? "double" : "float";
+  }
+};
+
+template <typename T>
+struct scalar_type_name<T, false> {
+  static string_class get() {
+    string_class name(std::is_unsigned<T>::value ? "u" : "");
+    switch (sizeof(T)) {
+      case 1:
+        return name + "char";
+      case 2:
+        return name + "short";
+      case 4:
+        return name + "int";
+      default:
+        return name + "long";
+    }
+  }
+};
+
+}  // namespace detail
+
+/**
+ * Host value passed to kernels as a kernel argument,
+ * so that submitting the kernel again with another value
+ * reuses the built program.
+ * Created in command group scope and captured by the kernel functor.
+ * A specialized value is written into the kernel source as a constant,
+ * which lets the OpenCL compiler optimize for it.
+ */
+template <typename T>
+class scalar_arg : public detail::data_ref {
+  static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+                "scalar_arg only supports arithmetic types other than bool");
+
+  static string_class register_scalar(T value, bool specialize) {
+    using detail::command::group_detail;
+    group_detail::check_scope();
+    auto literal = detail::get_string<T>::get(value);
+    if (detail::kernel_ns::source::in_scope()) {
+      // Already tracing the kernel
+      return literal;
+    }
+
+    auto bytes = reinterpret_cast<const char*>(&value);  // NOLINT
+    auto name = group_detail::add_scalar(
+        {detail::scalar_type_name<T>::get(),
+         "",
+         vector_class<char>(bytes, bytes + sizeof(T)),
+         specialize});
+    return specialize ? literal : name;
+  }
+
+ public:
+  scalar_arg(T value, bool specialize = false)
+      : data_ref(register_scalar(value, specialize)) {}
+};
+
+}  // namespace sycl
+}  // namespace cl
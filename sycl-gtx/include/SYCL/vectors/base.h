@@ -4,7 +4,6 @@
 // B.5 vec class base
 
 #include "SYCL/detail/common.h"
-#include "SYCL/detail/counter.h"
 #include "SYCL/detail/data_ref.h"
 #include "SYCL/vectors/cl_vec.h"
 #include "SYCL/vectors/helpers.h"
@@ -35,7 +34,7 @@ struct swizzled;
  * B.5 vec class base
  */
 template <typename dataT, int numElements>
-class base : protected counter<base<dataT, numElements>>, public data_ref {
+class base : public data_ref {
  private:
   template <typename>
   friend struct ::cl::sycl::detail::type_string;
@@ -48,20 +47,21 @@ class base : protected counter<base<dataT, numElements>>, public data_ref {
     return cl_base<dataT, numElements, 0>::type_name();
   }
 
-  string_class generate_name() const {
+  /** Numbered per kernel, so that the generated code is reproducible */
+  static string_class generate_name() {
     return '_' + type_name() + '_' +
-           get_string<counter_t>::get(this->get_count_id());
+           get_string<counter_t>::get(kernel_variable_id());
   }
 
-  string_class this_name() const {
-    return type_name() + ' ' + this->name;
+  static ir::expr construct(std::initializer_list<ir::expr> elements) {
+    return ir::call('(' + type_name() + ')', elements);
   }
 
  protected:
-  base(string_class assign, bool generate_new = false)
-      : data_ref(generate_new ? generate_name() : assign) {
+  base(ir::expr assign, bool generate_new = false)
+      : data_ref(generate_new ? ir::expr(generate_name()) : assign) {
     if (generate_new) {
-      kernel_add(this_name() + " = " + assign);
+      kernel_declare(type_name(), this->name, assign);
     }
   }
 
@@ -71,7 +71,7 @@ class base : protected counter<base<dataT, numElements>>, public data_ref {
   using vector_t = detail::cl_type<dataT, numElements>;
 
   base() : data_ref(generate_name()) {
-    kernel_add(this_name());
+    kernel_declare(type_name(), this->name);
   }
 
   base(const base& copy) : data_ref(copy.name) {}
@@ -96,28 +96,21 @@ class base : protected counter<base<dataT, numElements>>, public data_ref {
 
   template <int num = numElements>
   base(const data_ref& x, const data_ref& y, SYCL_ENABLE_IF_DIM(2))
-      : base(open_parenthesis + type_name() + ")(" + x.name + ", " + y.name +
-                 ')',
-             true) {}
+      : base(construct({x.name, y.name}), true) {}
   template <int num = numElements>
   base(const data_ref& x, const data_ref& y, const data_ref& z,
        SYCL_ENABLE_IF_DIM(3))
-      : base(open_parenthesis + type_name() + ")(" + x.name + ", " + y.name +
-                 ", " + z.name + ')',
-             true) {}
+      : base(construct({x.name, y.name, z.name}), true) {}
   template <int num = numElements>
   base(const data_ref& x, const data_ref& y, const data_ref& z,
        const data_ref& w, SYCL_ENABLE_IF_DIM(4))
-      : base(open_parenthesis + type_name() + ")(" + x.name + ", " + y.name +
-                 ", " + z.name + ", " + w.name + ')',
-             true) {}
+      : base(construct({x.name, y.name, z.name, w.name}), true) {}
   template <int num = numElements>
   base(const data_ref& s0, const data_ref& s1, const data_ref& s2,
        const data_ref& s3, const data_ref& s4, const data_ref& s5,
        const data_ref& s6, const data_ref& s7, SYCL_ENABLE_IF_DIM(8))
-      : base(open_parenthesis + type_name() + ")(" + s0.name + ", " + s1.name +
-                 ", " + s2.name + ", " + s3.name + ", " + s4.name + ", " +
-                 s5.name + ", " + s6.name + ", " + s7.name + ')',
+      : base(construct({s0.name, s1.name, s2.name, s3.name, s4.name, s5.name,
+                        s6.name, s7.name}),
              true) {}
   template <int num = numElements>
   base(const data_ref& s0, const data_ref& s1, const data_ref& s2,
@@ -127,12 +120,9 @@ class base : protected counter<base<dataT, numElements>>, public data_ref {
        const data_ref& sC, const data_ref& sD, const data_ref& sE,
        const data_ref& sF, const data_ref& sG, const data_ref& sH,
        SYCL_ENABLE_IF_DIM(16))
-      : base(open_parenthesis + type_name() + ")(" + s0.name + ", " + s1.name +
-                 ", " + s2.name + ", " + s3.name + ", " + s4.name + ", " +
-                 s5.name + ", " + s6.name + ", " + s7.name + ", " + s8.name +
-                 ", " + s9.name + ", " + sA.name + ", " + sB.name + ", " +
-                 sC.name + ", " + sD.name + ", " + sE.name + ", " + sF.name +
-                 ')',
+      : base(construct({s0.name, s1.name, s2.name, s3.name, s4.name, s5.name,
+                        s6.name, s7.name, s8.name, s9.name, sA.name, sB.name,
+                        sC.name, sD.name, sE.name, sF.name}),
              true) {}
 
   operator vec<dataT, numElements>&() {
@@ -156,14 +146,15 @@ class base : protected counter<base<dataT, numElements>>, public data_ref {
     swizzled<0, indices...>::get(access_name);
     access_name[size] = 0;
 
-    return swizzled_vec<dataT, size>(this->name + ".s" + access_name);
+    return swizzled_vec<dataT, size>(
+        ir::member(this->name, string_class(".s") + access_name));
   }
 
   swizzled_vec<dataT, half_size> lo() const {
-    return swizzled_vec<dataT, half_size>(this->name + ".lo");
+    return swizzled_vec<dataT, half_size>(ir::member(this->name, ".lo"));
   }
   swizzled_vec<dataT, half_size> hi() const {
-    return swizzled_vec<dataT, half_size>(this->name + ".hi");
+    return swizzled_vec<dataT, half_size>(ir::member(this->name, ".hi"));
   }
 
 // TODO(progtx): Swizzle methods
@@ -1,21 +1,299 @@
 #include "SYCL/buffer_base.h"
 
 #include "SYCL/queue.h"
+#include <algorithm>
 
 using namespace cl::sycl;
 using namespace detail;
 
+buffer_base::shared_transfer_stats buffer_base::stats;
+SYCL_THREAD_LOCAL ::size_t buffer_base::thread_bytes_transferred = 0;
+mutex_class buffer_base::zero_copy_mutex;
+bool buffer_base::zero_copy_configured = false;
+bool buffer_base::zero_copy_enabled = true;
+
+static vector_class<cl_event> get_wait_events(const vector_class<event>& list) {
+  vector_class<cl_event> wait_events;
+  for (auto& e : list) {
+    wait_events.push_back(e.get());
+  }
+  return wait_events;
+}
+
+buffer_base::transfer_stats buffer_base::get_transfer_stats() {
+  return {stats.uploads,           stats.downloads,
+          stats.bytes_transferred, stats.uploads_avoided,
+          stats.downloads_avoided, stats.bytes_avoided,
+          stats.maps};
+}
+
+::size_t buffer_base::get_thread_bytes_transferred() {
+  return thread_bytes_transferred;
+}
+
+void buffer_base::add_bytes_transferred(::size_t bytes) {
+  stats.bytes_transferred += bytes;
+  thread_bytes_transferred += bytes;
+}
+
+void buffer_base::set_zero_copy(bool enabled) {
+  std::lock_guard<mutex_class> lock(zero_copy_mutex);
+  zero_copy_configured = true;
+  zero_copy_enabled = enabled;
+}
+
+bool buffer_base::is_zero_copy_enabled() {
+  std::lock_guard<mutex_class> lock(zero_copy_mutex);
+  if (!zero_copy_configured) {
+    zero_copy_configured = true;
+    auto value = std::getenv("SYCL_GTX_ZERO_COPY");
+    zero_copy_enabled = (value == nullptr || string_class(value) != "0");
+  }
+  return zero_copy_enabled;
+}
+
+bool buffer_base::enable_zero_copy(queue* q) {
+  if (!is_zero_copy_enabled() ||
+      !q->get_device().get_info<info::device::host_unified_memory>()) {
+    return false;
+  }
+  is_zero_copy = true;
+  if (device_queue.get() == nullptr) {
+    // Host accessors can map it before any kernel writes it
+    device_queue = q->get();
+  }
+  return true;
+}
+
+void buffer_base::map(cl_command_queue q,
+                      const vector_class<cl_event>& wait_events,
+                      bool blocking, cl_map_flags flags) {
+  cl_event evnt;
+  ::cl_int error_code;
+  mapped = clEnqueueMapBuffer(
+      q, device_data.get(), blocking, flags, 0, get_size(),
+      static_cast<::cl_uint>(wait_events.size()),
+      (wait_events.empty() ? nullptr : wait_events.data()), &evnt,
+      &error_code);
+  detail::error::report(error_code);
+  ++stats.maps;
+  add_event(evnt);
+}
+
+cl_event buffer_base::unmap(cl_command_queue q,
+                            const vector_class<cl_event>& wait_events) {
+  if (mapped == nullptr) {
+    return nullptr;
+  }
+  cl_event evnt;
+  auto error_code = clEnqueueUnmapMemObject(
+      q, device_data.get(), mapped,
+      static_cast<::cl_uint>(wait_events.size()),
+      (wait_events.empty() ? nullptr : wait_events.data()), &evnt);
+  detail::error::report(error_code);
+  mapped = nullptr;
+  // Still referenced by events
+  add_event(evnt);
+  return evnt;
+}
+
+cl_event buffer_base::enqueue_command(
+    queue* q, const vector_class<cl_event>& wait_events, buffer_base* buffer,
+    clEnqueueBuffer_f clEnqueueBuffer) {
+  auto to_device = (clEnqueueBuffer == &clEnqueueWriteBuffer);
+  auto& valid = (to_device ? buffer->device_valid : buffer->host_valid);
+  auto size = buffer->get_size();
+  if (buffer->is_zero_copy) {
+    if (!valid) {
+      ++(to_device ? stats.uploads_avoided : stats.downloads_avoided);
+      stats.bytes_avoided += size;
+    }
+    valid = true;
+    return enqueue_map_command(q, wait_events, buffer, clEnqueueBuffer);
+  }
+  if (buffer->is_parent_newer() && !(to_device && buffer->aliases_parent)) {
+    return buffer->enqueue_from_parent(q, wait_events, to_device);
+  }
+  if (valid) {
+    ++(to_device ? stats.uploads_avoided : stats.downloads_avoided);
+    stats.bytes_avoided += size;
+    return nullptr;
+  }
+
+  buffer->enqueue(q, wait_events, clEnqueueBuffer);
+  valid = true;
+  if (to_device && buffer->device_queue.get() == nullptr) {
+    // Sub-buffers write their region of it
+    buffer->device_queue = q->get();
+  }
+  ++(to_device ? stats.uploads : stats.downloads);
+  add_bytes_transferred(size);
+  return buffer->events.back().get();
+}
+
+cl_event buffer_base::enqueue_map_command(
+    queue* q, const vector_class<cl_event>& wait_events, buffer_base* buffer,
+    clEnqueueBuffer_f clEnqueueBuffer) {
+  if (!buffer->is_zero_copy) {
+    return nullptr;
+  }
+  if (clEnqueueBuffer == &clEnqueueWriteBuffer) {
+    return buffer->unmap(q->get(), wait_events);
+  }
+  if (buffer->mapped != nullptr) {
+    return nullptr;
+  }
+  buffer->map(q->get(), wait_events, false, CL_MAP_READ | CL_MAP_WRITE);
+  return buffer->events.back().get();
+}
+
+::cl_int CL_API_CALL buffer_base::enqueue_read_buffer(
+    cl_command_queue q, cl_mem buffer, cl_bool blocking, ::size_t offset,
+    ::size_t size, const void* ptr, ::cl_uint num_events,
+    const cl_event* wait_list, cl_event* evnt) {
+  // The host data it reads into is never const
+  return clEnqueueReadBuffer(q, buffer, blocking, offset, size,
+                             const_cast<void*>(ptr), num_events, wait_list,
+                             evnt);
+}
+
 ::cl_int buffer_base::cl_enqueue_buffer(
-    queue* q, ::size_t size, void* host_ptr,
-    const vector_class<cl_event>& wait_events, cl_event& evnt,
+    cl_command_queue q, bool blocking, void* host_ptr,
+    const vector_class<cl_event>& wait_events, cl_event* evnt,
     clEnqueueBuffer_f clEnqueueBuffer) {
-  auto num_events_to_wait = wait_events.size();
+  auto num_events_to_wait = static_cast<::cl_uint>(wait_events.size());
+  auto wait_list = (wait_events.empty() ? nullptr : wait_events.data());
+  auto size = get_size();
+
+  if (host_row_pitch == 0) {
+    return clEnqueueBuffer(q, device_data.get(), blocking, 0, size, host_ptr,
+                           num_events_to_wait, wait_list, evnt);
+  }
+
+  // Device rows are packed, the host ones are the rows of the parent
+  ::size_t region[3];
+  ::size_t parent_origin[3];
+  get_rect(region, parent_origin);
+  const ::size_t zero[3] = {0, 0, 0};
+  if (clEnqueueBuffer == &clEnqueueWriteBuffer) {
+    return clEnqueueWriteBufferRect(q, device_data.get(), blocking, zero, zero,
+                                    region, 0, 0, host_row_pitch,
+                                    host_slice_pitch, host_ptr,
+                                    num_events_to_wait, wait_list, evnt);
+  }
+  return clEnqueueReadBufferRect(q, device_data.get(), blocking, zero, zero,
+                                 region, 0, 0, host_row_pitch, host_slice_pitch,
+                                 host_ptr, num_events_to_wait, wait_list, evnt);
+}
+
+::cl_int buffer_base::cl_enqueue_buffer(
+    queue* q, bool blocking, void* host_ptr,
+    const vector_class<cl_event>& wait_events, cl_event* evnt,
+    clEnqueueBuffer_f clEnqueueBuffer) {
+  return cl_enqueue_buffer(q->get(), blocking, host_ptr, wait_events, evnt,
+                           clEnqueueBuffer);
+}
+
+::cl_int buffer_base::cl_enqueue_parent(
+    cl_command_queue q, bool blocking,
+    const vector_class<cl_event>& wait_events, cl_event* evnt,
+    clEnqueueBuffer_f clEnqueueBuffer) {
+  auto num_events_to_wait = static_cast<::cl_uint>(wait_events.size());
+  auto wait_list = (wait_events.empty() ? nullptr : wait_events.data());
+  auto mem = parent->device_data.get();
+  auto host_ptr = get_host_pointer();
+
+  if (host_row_pitch == 0) {
+    return clEnqueueBuffer(q, mem, blocking, origin, get_size(), host_ptr,
+                           num_events_to_wait, wait_list, evnt);
+  }
+
+  // The parent device data has the same rows as the host data
+  ::size_t region[3];
+  ::size_t parent_origin[3];
+  get_rect(region, parent_origin);
+  const ::size_t zero[3] = {0, 0, 0};
+  if (clEnqueueBuffer == &clEnqueueWriteBuffer) {
+    return clEnqueueWriteBufferRect(
+        q, mem, blocking, parent_origin, zero, region, host_row_pitch,
+        host_slice_pitch, host_row_pitch, host_slice_pitch, host_ptr,
+        num_events_to_wait, wait_list, evnt);
+  }
+  return clEnqueueReadBufferRect(q, mem, blocking, parent_origin, zero, region,
+                                 host_row_pitch, host_slice_pitch,
+                                 host_row_pitch, host_slice_pitch, host_ptr,
+                                 num_events_to_wait, wait_list, evnt);
+}
+
+::cl_int buffer_base::cl_copy_parent(cl_command_queue q, bool to_parent,
+                                     const vector_class<cl_event>& wait_events,
+                                     cl_event* evnt) {
+  auto num_events_to_wait = static_cast<::cl_uint>(wait_events.size());
+  auto wait_list = (wait_events.empty() ? nullptr : wait_events.data());
+  auto src = device_data.get();
+  auto dst = parent->device_data.get();
+  if (!to_parent) {
+    std::swap(src, dst);
+  }
+
+  if (host_row_pitch == 0) {
+    return clEnqueueCopyBuffer(q, src, dst, (to_parent ? 0 : origin),
+                               (to_parent ? origin : 0), get_size(),
+                               num_events_to_wait, wait_list, evnt);
+  }
+
+  ::size_t region[3];
+  ::size_t parent_origin[3];
+  get_rect(region, parent_origin);
+  const ::size_t zero[3] = {0, 0, 0};
+  if (to_parent) {
+    return clEnqueueCopyBufferRect(q, src, dst, zero, parent_origin, region, 0,
+                                   0, host_row_pitch, host_slice_pitch,
+                                   num_events_to_wait, wait_list, evnt);
+  }
+  return clEnqueueCopyBufferRect(q, src, dst, parent_origin, zero, region,
+                                 host_row_pitch, host_slice_pitch, 0, 0,
+                                 num_events_to_wait, wait_list, evnt);
+}
+
+void buffer_base::get_rect(::size_t region[3],
+                           ::size_t parent_origin[3]) const {
+  auto shape = get_shape();
+  region[0] = get_size();
+  region[1] = region[2] = 1;
+  for (::size_t i = 1; i < shape.size(); ++i) {
+    region[i] = shape[i];
+    region[0] /= shape[i];
+  }
+
+  ::size_t slice = (host_slice_pitch == 0 ? 0 : origin / host_slice_pitch);
+  auto in_slice = origin - slice * host_slice_pitch;
+  parent_origin[0] = in_slice % host_row_pitch;
+  parent_origin[1] = in_slice / host_row_pitch;
+  parent_origin[2] = slice;
+}
+
+vector_class<cl_event> buffer_base::get_parent_wait_events(
+    const vector_class<cl_event>& wait_events) const {
+  auto all = get_wait_events(events);
+  auto parent_events = get_wait_events(parent->events);
+  all.insert(all.end(), parent_events.begin(), parent_events.end());
+  all.insert(all.end(), wait_events.begin(), wait_events.end());
+  return all;
+}
 
-  return clEnqueueBuffer(
-      q->get(), device_data.get(), false,
-      // TODO(progtx): Sub-buffer access
-      0, size, host_ptr, static_cast<::cl_uint>(num_events_to_wait),
-      (num_events_to_wait == 0 ? nullptr : wait_events.data()), &evnt);
+/**
+ * Takes over the reference returned by an enqueue function
+ * and drops events that have already completed
+ */
+void buffer_base::add_event(cl_event evnt) {
+  events.erase(
+      std::remove_if(events.begin(), events.end(),
+                     [](const event& e) { return e.is_complete(); }),
+      events.end());
+  events.emplace_back(evnt);
+  auto error_code = clReleaseEvent(evnt);
+  detail::error::report(error_code);
 }
 
 cl_mem buffer_base::cl_create_buffer(queue* q, const cl_mem_flags& flags,
@@ -24,3 +302,316 @@ cl_mem buffer_base::cl_create_buffer(queue* q, const cl_mem_flags& flags,
   return clCreateBuffer(q->get_context().get(), flags, size, host_ptr,
                         &error_code);
 }
+
+cl_event buffer_base::create_sub_buffer(
+    queue* q, const vector_class<cl_event>& wait_events, cl_mem_flags flags) {
+  if (parent->mapped != nullptr) {
+    parent->unmap(q->get(), wait_events);
+  }
+
+  ::cl_int error_code;
+  ::size_t align =
+      q->get_device().get_info<info::device::mem_base_addr_align>() / 8;
+  // The device data of the parent is overwritten by its next upload
+  if (host_row_pitch == 0 && (align == 0 || origin % align == 0) &&
+      (parent->device_valid || parent->is_zero_copy)) {
+    cl_buffer_region region = {origin, get_size()};
+    auto mem = clCreateSubBuffer(parent->device_data.get(), flags,
+                                 CL_BUFFER_CREATE_TYPE_REGION, &region,
+                                 &error_code);
+    detail::error::report(error_code);
+    device_data = mem;
+    device_data.release_one();
+    aliases_parent = true;
+
+    // Same memory, so the same data is valid
+    host_valid = parent->host_valid;
+    device_valid = parent->device_valid;
+    device_queue = parent->device_queue;
+    parent_writes = parent->device_writes;
+    if (parent->events.empty()) {
+      return nullptr;
+    }
+    // Commands of other queues might still use the parent
+    auto parent_events = get_wait_events(parent->events);
+    parent_events.insert(parent_events.end(), wait_events.begin(),
+                         wait_events.end());
+    cl_event marker;
+    error_code = clEnqueueMarkerWithWaitList(
+        q->get(), static_cast<::cl_uint>(parent_events.size()),
+        parent_events.data(), &marker);
+    detail::error::report(error_code);
+    add_event(marker);
+    return events.back().get();
+  }
+
+  device_data = cl_create_buffer(q, flags, get_size(), nullptr, error_code);
+  detail::error::report(error_code);
+  device_data.release_one();
+  if (is_parent_on_device()) {
+    // Copied from the region of the parent on the device
+    cl_event evnt;
+    error_code = cl_copy_parent(q->get(), false,
+                                get_parent_wait_events(wait_events), &evnt);
+    detail::error::report(error_code);
+    host_valid = parent->host_valid;
+    device_valid = true;
+    device_queue = q->get();
+    parent_writes = parent->device_writes;
+    add_event(evnt);
+    return events.back().get();
+  }
+
+  // Copied from the host like any other buffer
+  parent->update_host();
+  host_valid = true;
+  device_valid = false;
+  return nullptr;
+}
+
+mem_pool::mem_t buffer_base::cl_create_pooled_buffer(queue* q,
+                                                     const cl_mem_flags& flags,
+                                                     ::size_t size,
+                                                     ::cl_int& error_code) {
+  return mem_pool::acquire(q->get_context().get(), flags, size, error_code);
+}
+
+void buffer_base::set_device_written(cl_command_queue q,
+                                     cl_event kernel_event) {
+  if (!host_valid) {
+    // Would have been read back after the previous kernel
+    ++stats.downloads_avoided;
+    stats.bytes_avoided += get_size();
+  }
+  host_valid = false;
+  device_valid = true;
+  ++device_writes;
+  if (device_queue.get() != q) {
+    device_queue = q;
+  }
+
+  auto error_code = clRetainEvent(kernel_event);
+  detail::error::report(error_code);
+  add_event(kernel_event);
+
+  if (aliases_parent && parent->device_valid) {
+    // Written in the device memory of the parent
+    parent->set_device_written(q, kernel_event);
+  }
+}
+
+void buffer_base::set_device_read(cl_event kernel_event) {
+  auto error_code = clRetainEvent(kernel_event);
+  detail::error::report(error_code);
+  add_event(kernel_event);
+}
+
+void buffer_base::use_on_host(access::mode mode) {
+  auto on_parent = is_parent_on_device();
+  if (parent != nullptr && !on_parent && mode != access::mode::read) {
+    // The host writes the data of the parent
+    parent->update_host();
+    parent->device_valid = false;
+  }
+  if (is_zero_copy) {
+    if (mapped == nullptr) {
+      map(device_queue.get(), get_wait_events(events), true,
+          CL_MAP_READ | CL_MAP_WRITE);
+    }
+    if (!host_valid) {
+      ++stats.downloads_avoided;
+      stats.bytes_avoided += get_size();
+    }
+    host_valid = true;
+  } else if (mode == access::mode::discard_write ||
+             mode == access::mode::discard_read_write) {
+    if (!host_valid || is_parent_newer()) {
+      ++stats.downloads_avoided;
+      stats.bytes_avoided += get_size();
+    }
+    host_valid = true;
+    if (parent != nullptr) {
+      parent_writes = parent->device_writes;
+    }
+  } else {
+    update_host();
+  }
+  if (mode != access::mode::read) {
+    device_valid = false;
+    // Written to the parent device data once the host is done
+    host_written = on_parent;
+  }
+}
+
+void buffer_base::release_device_data(bool write_back) {
+  if (parent != nullptr && !host_valid && is_parent_on_device()) {
+    // Left on the device, the parent reads it back if needed
+    if (!aliases_parent) {
+      copy_to_parent();
+      parent->host_valid = false;
+    }
+    ++stats.downloads_avoided;
+    stats.bytes_avoided += get_size();
+  } else if (write_back && (parent == nullptr || !host_valid)) {
+    update_host();
+  } else if (!host_valid) {
+    ++stats.downloads_avoided;
+    stats.bytes_avoided += get_size();
+  }
+  if (mapped != nullptr) {
+    // The host data might be freed right after
+    unmap(device_queue.get(), get_wait_events(events));
+    events.back().wait();
+  }
+}
+
+void buffer_base::update_host() {
+  if (is_parent_newer()) {
+    // Only the region, the parent device data stays up to date
+    if (!parent->host_valid) {
+      auto error_code =
+          cl_enqueue_parent(parent->device_queue.get(), true,
+                            get_parent_wait_events({}), nullptr,
+                            &enqueue_read_buffer);
+      detail::error::report(error_code);
+      ++stats.downloads;
+      add_bytes_transferred(get_size());
+    }
+    host_valid = true;
+    if (!aliases_parent) {
+      device_valid = false;
+    }
+    parent_writes = parent->device_writes;
+    return;
+  }
+  if (host_valid) {
+    return;
+  }
+  if (parent != nullptr && parent->is_zero_copy) {
+    // Mapping the parent moves no data
+    parent->update_host();
+    if (aliases_parent && parent->device_valid) {
+      host_valid = true;
+      return;
+    }
+  }
+
+  auto wait_events = get_wait_events(events);
+  auto size = get_size();
+  if (is_zero_copy) {
+    if (mapped == nullptr) {
+      map(device_queue.get(), wait_events, true, CL_MAP_READ | CL_MAP_WRITE);
+    }
+    host_valid = true;
+    ++stats.downloads_avoided;
+    stats.bytes_avoided += size;
+    return;
+  }
+
+  auto error_code =
+      cl_enqueue_buffer(device_queue.get(), true, get_host_pointer(),
+                        wait_events, nullptr, &enqueue_read_buffer);
+  detail::error::report(error_code);
+
+  host_valid = true;
+  ++stats.downloads;
+  add_bytes_transferred(size);
+  if (parent != nullptr && !aliases_parent) {
+    if (is_parent_on_device()) {
+      copy_to_parent();
+    } else {
+      parent->device_valid = false;
+    }
+  }
+}
+
+bool buffer_base::is_parent_newer() const {
+  return is_parent_on_device() && parent->device_writes != parent_writes;
+}
+
+bool buffer_base::is_parent_on_device() const {
+  // Mapping a zero-copy parent moves no data anyway
+  return parent != nullptr && parent->device_valid && !parent->is_zero_copy &&
+         parent->device_queue.get() != nullptr;
+}
+
+cl_event buffer_base::enqueue_from_parent(
+    queue* q, const vector_class<cl_event>& wait_events, bool to_device) {
+  parent_writes = parent->device_writes;
+  if (!to_device && parent->host_valid) {
+    // Already read back with the rest of the parent
+    host_valid = true;
+    if (!aliases_parent) {
+      device_valid = false;
+    }
+    return nullptr;
+  }
+
+  cl_event evnt;
+  ::cl_int error_code;
+  auto wait = get_parent_wait_events(wait_events);
+  if (to_device) {
+    error_code = cl_copy_parent(q->get(), false, wait, &evnt);
+    host_valid = parent->host_valid;
+    device_valid = true;
+    device_queue = q->get();
+  } else {
+    error_code = cl_enqueue_parent(q->get(), false, wait, &evnt,
+                                   &enqueue_read_buffer);
+    ++stats.downloads;
+    add_bytes_transferred(get_size());
+    host_valid = true;
+    if (!aliases_parent) {
+      device_valid = false;
+    }
+  }
+  detail::error::report(error_code);
+  add_event(evnt);
+  return events.back().get();
+}
+
+cl_event buffer_base::write_to_parent(
+    cl_command_queue q, bool blocking,
+    const vector_class<cl_event>& wait_events) {
+  if (!host_written) {
+    return nullptr;
+  }
+  host_written = false;
+  if (!is_parent_on_device()) {
+    // The parent uses the host data again
+    return nullptr;
+  }
+
+  cl_event evnt;
+  auto error_code =
+      cl_enqueue_parent(q, blocking, get_parent_wait_events(wait_events),
+                        &evnt, &clEnqueueWriteBuffer);
+  detail::error::report(error_code);
+  ++stats.uploads;
+  add_bytes_transferred(get_size());
+  if (aliases_parent) {
+    device_valid = true;
+  }
+
+  error_code = clRetainEvent(evnt);
+  detail::error::report(error_code);
+  parent->add_event(evnt);
+  add_event(evnt);
+  return evnt;
+}
+
+void buffer_base::copy_to_parent() {
+  cl_event evnt;
+  auto error_code = cl_copy_parent(device_queue.get(), true,
+                                   get_parent_wait_events({}), &evnt);
+  detail::error::report(error_code);
+
+  error_code = clRetainEvent(evnt);
+  detail::error::report(error_code);
+  parent->add_event(evnt);
+  add_event(evnt);
+  // Other sub-buffers of the region are out of date
+  parent_writes = ++parent->device_writes;
+  // Not part of a command group that others would wait for
+  events.back().wait();
+}
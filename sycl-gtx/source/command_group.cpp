@@ -3,8 +3,6 @@
 #include "SYCL/accessor.h"
 #include "SYCL/buffer.h"
 #include "SYCL/queue.h"
-#include <map>
-#include <unordered_set>
 
 using namespace cl::sycl;
 using namespace detail;
@@ -16,82 +14,22 @@ void command_group::exit() {
   detail::command::group_detail::last = nullptr;
 }
 
-// TODO(progtx): Reschedules commands to achieve better performance
-void command_group::optimize() {
-  DSELF();
-
-  auto size_to_keep = commands.size();
-  std::map<command_t*, bool> keep;
-  // keep.reserve(size_to_keep);
-  std::map<detail::buffer_base*, command_t*> last_read;
-  std::unordered_set<detail::buffer_base*> was_written;
-
-  using detail::command::type_t;
-
-  for (auto& command : commands) {
-    keep[&command] = true;
-
-    if (command.type == type_t::get_accessor) {
-      // User accesses the buffer
-
-      auto ptr = command.data.buf_acc.data;
-
-      {  // Reset reads
-        auto it = last_read.find(ptr);
-        if (it != last_read.end()) {
-          last_read.erase(it);
-        }
-      }
-
-      {  // Reset writes
-        auto it = was_written.find(ptr);
-        if (it != was_written.end()) {
-          was_written.erase(it);
-        }
-      }
-    } else if (command.type == type_t::copy_data) {
-      auto ptr = command.data.buf_copy.buf.data;
-
-      if (command.data.buf_copy.mode == access::mode::read) {
-        auto it = last_read.find(ptr);
-
-        // Keep only the last read
-        if (it != last_read.end()) {
-          keep[it->second] = false;
-          --size_to_keep;
-        }
-
-        last_read[ptr] = &command;
-      } else if (command.data.buf_copy.mode == access::mode::write) {
-        auto it = was_written.find(ptr);
-
-        // Keep only the first write
-        if (it == was_written.end()) {
-          was_written.insert(ptr);
-        } else {
-          keep[&command] = false;
-          --size_to_keep;
-        }
-      }
-    }
-  }
-
-  decltype(commands) saveResults;
-  saveResults.reserve(saveResults.size() + size_to_keep);
-
-  for (auto& command : commands) {
-    if (keep[&command]) {
-      saveResults.push_back(std::move(command));
-    }
-  }
-  commands = std::move(saveResults);
-}
-
 /** Executes all commands in queue and removes them */
-void command_group::flush(vector_class<cl_event> wait_events) {
+vector_class<event> command_group::flush(vector_class<cl_event> wait_events,
+                                         bool in_order) {
   DSELF() << q << q->get();
+  auto issued = run(std::move(wait_events), in_order);
+  commands.clear();
+  return issued;
+}
+
+vector_class<event> command_group::run(vector_class<cl_event> wait_events,
+                                       bool in_order) {
 
   using detail::command::type_t;
+  vector_class<event> issued;
+  // Other threads flushing at the same time don't count
+  auto before = buffer_base::get_thread_bytes_transferred();
 
   for (auto& command : commands) {
     if (command.type == type_t::get_accessor) {
@@ -106,17 +44,32 @@ void command_group::flush(vector_class<cl_event> wait_events) {
     } else {
       debug() << "command:" << command.name;
     }
-    command.function(q, wait_events);
+    auto evnt = command.function(q, wait_events);
+    if (evnt != nullptr) {
+      // Kept alive until the command group completes
+      issued.emplace_back(evnt);
+      if (!in_order) {
+        wait_events.push_back(evnt);
+      }
+    }
   }
-  commands.clear();
+  bytes_transferred = buffer_base::get_thread_bytes_transferred() - before;
+  return issued;
+}
 
-  auto error = clFlush(q->get());
-  detail::error::report(error);
+bool command_group::is_building() const {
+  for (auto& build : builds) {
+    if (!compile_pool::is_done(build)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 using namespace detail;
 
 SYCL_THREAD_LOCAL command_group* command::group_detail::last = nullptr;
+SYCL_THREAD_LOCAL command_group* command::group_detail::producer = nullptr;
 
 bool command::group_detail::in_scope() {
   return last != nullptr;
@@ -128,21 +81,111 @@ void command::group_detail::check_scope() {
   }
 }
 
+vector_class<buffer_access> command::group_detail::get_accessors() {
+  vector_class<buffer_access> accessors;
+  for (auto& command : last->commands) {
+    if (command.type == type_t::get_accessor) {
+      accessors.push_back(command.data.buf_acc);
+    }
+  }
+  return accessors;
+}
+
+string_class command::group_detail::add_scalar(scalar s) {
+  if (!s.specialized) {
+    ::size_t parameters = 0;
+    for (auto& other : last->scalars) {
+      if (!other.specialized) {
+        ++parameters;
+      }
+    }
+    s.name = "_sycl_arg" + get_string<::size_t>::get(parameters + 1);
+  }
+  last->scalars.push_back(s);
+  return s.name;
+}
+
+const vector_class<command::scalar>& command::group_detail::get_scalars() {
+  return last->scalars;
+}
+
+void command::group_detail::set_producer(command_group* group) {
+  producer = group;
+}
+
+command::fusible_kernel command::group_detail::get_fusible_producer() {
+  if (producer == nullptr || producer->fusible.kern == nullptr ||
+      producer->commands.empty() ||
+      producer->commands.back().type != type_t::kernel) {
+    return {nullptr, 0, 0};
+  }
+  ::size_t kernels = 0;
+  for (auto& command : producer->commands) {
+    if (command.type == type_t::kernel) {
+      ++kernels;
+    }
+  }
+  if (kernels != 1) {
+    return {nullptr, 0, 0};
+  }
+  return producer->fusible;
+}
+
+void command::group_detail::take_over_kernel() {
+  producer->commands.pop_back();
+  producer->builds.clear();
+  producer->fusible = {nullptr, 0, 0};
+  // The buffers of both kernels are now used by this command group
+  last->read_buffers.insert(producer->read_buffers.begin(),
+                            producer->read_buffers.end());
+  last->write_buffers.insert(producer->write_buffers.begin(),
+                             producer->write_buffers.end());
+}
+
+bool command::group_detail::has_kernel() {
+  for (auto& command : last->commands) {
+    if (command.type == type_t::kernel) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void command::group_detail::set_fusible(fusible_kernel fusible) {
+  last->fusible = std::move(fusible);
+}
+
+void command::group_detail::add_build(compile_pool::future_t build) {
+  if (build.valid()) {
+    last->builds.push_back(std::move(build));
+  }
+}
+
 void command::group_detail::add_buffer_access(buffer_access buf_acc,
                                               string_class name) {
   last->commands.push_back({name,
                             std::bind(info::do_nothing, std::placeholders::_1,
                                       std::placeholders::_2),
-                            type_t::get_accessor, metadata(buf_acc)});
+                            type_t::get_accessor, metadata(buf_acc), nullptr});
 
   // TODO(progtx): Maybe other targets
-  if (buf_acc.target == access::target::global_buffer) {
+  if (buf_acc.target == access::target::global_buffer ||
+      buf_acc.target == access::target::constant_buffer ||
+      buf_acc.target == access::target::host_buffer) {
+    // A sub-buffer uses the data of its parent
+    auto parent = buf_acc.data->parent;
     if (buf_acc.mode != access::mode::discard_write &&
         buf_acc.mode != access::mode::discard_read_write) {
       last->read_buffers.insert(buf_acc.data);
+      if (parent != nullptr) {
+        last->read_buffers.insert(parent);
+      }
     }
     if (buf_acc.mode != access::mode::read) {
       last->write_buffers.insert(buf_acc.data);
+      if (parent != nullptr) {
+        last->write_buffers.insert(parent);
+      }
     }
   }
 }
@@ -156,5 +199,6 @@ void command::group_detail::add_buffer_copy(
       {name,
        std::bind(function, std::placeholders::_1, std::placeholders::_2, buffer,
                  enqueue_function),
-       type_t::copy_data, metadata(buffer_copy{buf_acc, copy_mode})});
+       type_t::copy_data, metadata(buffer_copy{buf_acc, copy_mode}),
+       nullptr});
 }
@@ -0,0 +1,299 @@
+#include "SYCL/detail/binary_cache.h"
+
+#include "SYCL/detail/debug.h"
+#include "SYCL/detail/program_cache.h"
+#include "SYCL/device.h"
+#include "SYCL/error_handler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <process.h>
+#include <sys/utime.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+using namespace cl::sycl;
+using namespace detail;
+
+namespace {
+
+const string_class magic = "sycl-gtx binary 1\n";
+const string_class extension = ".clbin";
+
+struct file_info {
+  string_class path;
+  std::time_t modified;
+  ::size_t size;
+};
+
+bool ends_with(const string_class& str, const string_class& end) {
+  return str.size() >= end.size() &&
+         str.compare(str.size() - end.size(), end.size(), end) == 0;
+}
+
+vector_class<file_info> list_entries(const string_class& dir) {
+  vector_class<string_class> names;
+
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  auto handle = FindFirstFileA((dir + "\\*" + extension).c_str(), &data);
+  if (handle != INVALID_HANDLE_VALUE) {
+    do {
+      names.push_back(data.cFileName);
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+  }
+#else
+  auto d = opendir(dir.c_str());
+  if (d != nullptr) {
+    while (auto entry = readdir(d)) {
+      names.push_back(entry->d_name);
+    }
+    closedir(d);
+  }
+#endif
+
+  vector_class<file_info> files;
+  for (auto& name : names) {
+    if (!ends_with(name, extension)) {
+      continue;
+    }
+    auto path = dir + '/' + name;
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0) {
+      files.push_back(
+          {path, info.st_mtime, static_cast<::size_t>(info.st_size)});
+    }
+  }
+  return files;
+}
+
+string_class unique_suffix() {
+  // Compile threads can store concurrently
+  static std::atomic<unsigned int> count(0);
+#ifdef _WIN32
+  auto pid = _getpid();
+#else
+  auto pid = getpid();
+#endif
+  return '.' + get_string<long>::get(static_cast<long>(pid)) + '.' +
+         get_string<unsigned int>::get(++count) + ".tmp";
+}
+
+void write_size(std::ofstream& file, unsigned long long size) {
+  file.write(reinterpret_cast<const char*>(&size), sizeof(size));  // NOLINT
+}
+
+bool read_size(std::ifstream& file, unsigned long long& size) {
+  file.read(reinterpret_cast<char*>(&size), sizeof(size));  // NOLINT
+  return file.good();
+}
+
+}  // namespace
+
+mutex_class binary_cache::mutex;
+bool binary_cache::is_configured = false;
+string_class binary_cache::directory;
+::size_t binary_cache::max_size = binary_cache::default_max_size;
+
+void binary_cache::configure() {
+  if (is_configured) {
+    return;
+  }
+  is_configured = true;
+
+  auto dir = std::getenv("SYCL_GTX_CACHE_DIR");
+  if (dir != nullptr) {
+    directory = dir;
+  }
+  auto size = std::getenv("SYCL_GTX_CACHE_MAX_SIZE");
+  if (size != nullptr) {
+    max_size = static_cast<::size_t>(std::strtoull(size, nullptr, 10));
+  }
+}
+
+void binary_cache::set_directory(string_class path, ::size_t max_size_bytes) {
+  std::lock_guard<mutex_class> lock(mutex);
+  is_configured = true;
+  directory = path;
+  max_size = max_size_bytes;
+}
+
+bool binary_cache::is_enabled() {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  return !directory.empty();
+}
+
+string_class binary_cache::get_path(const string_class& descriptor) {
+  static const char digits[] = "0123456789abcdef";
+  unsigned long long h = program_cache::hash(descriptor);
+  string_class name(16, '0');
+  for (int i = 15; i >= 0; --i) {
+    name[i] = digits[h & 0xf];
+    h >>= 4;
+  }
+  std::lock_guard<mutex_class> lock(mutex);
+  return directory + '/' + name + extension;
+}
+
+string_class binary_cache::describe(const string_class& code,
+                                    const vector_class<device>& devices,
+                                    const string_class& options) {
+  string_class descriptor = options + '\n';
+  for (auto& dev : devices) {
+    descriptor += dev.get_info<info::device::name>() + '\n';
+    descriptor += dev.get_info<info::device::driver_version>() + '\n';
+  }
+  return descriptor + code;
+}
+
+bool binary_cache::load(const string_class& descriptor, binaries_t& binaries) {
+  if (!is_enabled()) {
+    return false;
+  }
+
+  auto path = get_path(descriptor);
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+
+  string_class header(magic.size(), '\0');
+  file.read(&header[0], header.size());
+  unsigned long long size;
+  if (!file.good() || header != magic || !read_size(file, size) ||
+      size != descriptor.size()) {
+    return false;
+  }
+
+  // The file name is only a hash, the descriptor must match exactly
+  string_class stored(descriptor.size(), '\0');
+  file.read(&stored[0], stored.size());
+  unsigned long long count;
+  if (!file.good() || stored != descriptor || !read_size(file, count)) {
+    return false;
+  }
+
+  binaries_t loaded;
+  for (unsigned long long i = 0; i < count; ++i) {
+    if (!read_size(file, size)) {
+      return false;
+    }
+    loaded.emplace_back(static_cast<::size_t>(size));
+    file.read(reinterpret_cast<char*>(loaded.back().data()),  // NOLINT
+              static_cast<std::streamsize>(size));
+    if (!file.good()) {
+      return false;
+    }
+  }
+  file.close();
+
+  // Mark as recently used
+  utime(path.c_str(), nullptr);
+
+  binaries = std::move(loaded);
+  return true;
+}
+
+void binary_cache::store(const string_class& descriptor,
+                         const binaries_t& binaries) {
+  if (!is_enabled()) {
+    return;
+  }
+
+  auto path = get_path(descriptor);
+  auto tmp_path = path + unique_suffix();
+
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(magic.data(), magic.size());
+    write_size(file, descriptor.size());
+    file.write(descriptor.data(), descriptor.size());
+    write_size(file, binaries.size());
+    for (auto& binary : binaries) {
+      write_size(file, binary.size());
+      file.write(reinterpret_cast<const char*>(binary.data()),  // NOLINT
+                 static_cast<std::streamsize>(binary.size()));
+    }
+    if (!file.good()) {
+      debug() << "Could not write kernel binary to" << tmp_path;
+      file.close();
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+
+#ifdef _WIN32
+  // Windows cannot rename over an existing file
+  std::remove(path.c_str());
+#endif
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    return;
+  }
+
+  evict();
+}
+
+/** Removes the least recently used entries until the cache fits */
+void binary_cache::evict() {
+  // Also keeps stores on other threads from evicting at the same time
+  std::lock_guard<mutex_class> lock(mutex);
+  auto files = list_entries(directory);
+
+  ::size_t total = 0;
+  for (auto& f : files) {
+    total += f.size;
+  }
+  if (total <= max_size) {
+    return;
+  }
+
+  std::sort(files.begin(), files.end(),
+            [](const file_info& first, const file_info& second) {
+              return first.modified < second.modified;
+            });
+  for (auto& f : files) {
+    if (total <= max_size) {
+      break;
+    }
+    if (std::remove(f.path.c_str()) == 0) {
+      total -= f.size;
+    }
+  }
+}
+
+binary_cache::binaries_t binary_cache::get_binaries(cl_program prog,
+                                                     ::size_t num_devices) {
+  vector_class<::size_t> sizes(num_devices);
+  auto error_code =
+      clGetProgramInfo(prog, CL_PROGRAM_BINARY_SIZES,
+                       sizes.size() * sizeof(::size_t), sizes.data(), nullptr);
+  detail::error::report(error_code);
+
+  binaries_t binaries;
+  vector_class<unsigned char*> pointers;
+  binaries.reserve(num_devices);
+  for (auto size : sizes) {
+    binaries.emplace_back(size);
+    pointers.push_back(binaries.back().data());
+  }
+
+  error_code = clGetProgramInfo(prog, CL_PROGRAM_BINARIES,
+                                pointers.size() * sizeof(unsigned char*),
+                                pointers.data(), nullptr);
+  detail::error::report(error_code);
+  return binaries;
+}
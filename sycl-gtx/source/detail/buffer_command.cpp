@@ -0,0 +1,217 @@
+#include "SYCL/detail/buffer_command.h"
+
+#include "SYCL/buffer_base.h"
+#include "SYCL/command_group.h"
+#include "SYCL/queue.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace cl::sycl;
+using namespace detail;
+
+static const cl_event* get_wait_list(
+    const vector_class<cl_event>& wait_events) {
+  return (wait_events.empty() ? nullptr : wait_events.data());
+}
+
+/** Only host tasks are still running when a source is not on the device */
+static bool is_complete(const vector_class<cl_event>& wait_events) {
+  for (auto evnt : wait_events) {
+    ::cl_int status;
+    auto error_code =
+        clGetEventInfo(evnt, CL_EVENT_COMMAND_EXECUTION_STATUS,
+                       sizeof(status), &status, nullptr);
+    error::report(error_code);
+    if (status != CL_COMPLETE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Commands of the same group are not waited for on in-order queues */
+static bool is_complete(const vector_class<event>& events) {
+  return std::all_of(events.begin(), events.end(),
+                     [](const event& e) { return e.is_complete(); });
+}
+
+void buffer_command::use_on_device(queue* q,
+                                   vector_class<cl_event>& wait_events,
+                                   buffer_base* buffer, bool needs_data) {
+  auto evnt = (needs_data ? buffer_base::enqueue_command
+                          : buffer_base::enqueue_map_command)(
+      q, wait_events, buffer, &clEnqueueWriteBuffer);
+  if (evnt != nullptr) {
+    wait_events.push_back(evnt);
+  }
+}
+
+cl_event buffer_command::finish(queue* q, cl_event evnt, buffer_base* dst,
+                                buffer_base* src) {
+  if (dst != nullptr) {
+    dst->set_device_written(q->get(), evnt);
+  }
+  if (src != nullptr) {
+    src->set_device_read(evnt);
+  }
+  // Still referenced by the buffers
+  auto error_code = clReleaseEvent(evnt);
+  error::report(error_code);
+  return evnt;
+}
+
+bool buffer_command::overlaps(buffer_base* first, buffer_base* second) {
+  auto root = [](buffer_base* b) {
+    return (b->parent == nullptr ? b : b->parent);
+  };
+  if (root(first) != root(second)) {
+    return false;
+  }
+  // Bytes of the parent from the first row to the end of the last one
+  auto get_end = [](buffer_base* b) {
+    auto size = b->get_size();
+    if (b->host_row_pitch == 0) {
+      return b->origin + size;
+    }
+    auto shape = b->get_shape();
+    ::size_t row_size = size;
+    for (::size_t i = 1; i < shape.size(); ++i) {
+      row_size /= shape[i];
+    }
+    ::size_t end = b->origin + row_size;
+    end += (shape.size() > 1 ? (shape[1] - 1) * b->host_row_pitch : 0);
+    end += (shape.size() > 2 ? (shape[2] - 1) * b->host_slice_pitch : 0);
+    return end;
+  };
+  return first->origin < get_end(second) && second->origin < get_end(first);
+}
+
+cl_event buffer_command::enqueue_copy(queue* q,
+                                      const vector_class<cl_event>& wait_events,
+                                      buffer_base* src, buffer_base* dst) {
+  auto size = src->get_size();
+  auto wait = wait_events;
+  // The rest of a larger destination is kept
+  use_on_device(q, wait, dst, size < dst->get_size());
+
+  cl_event evnt;
+  ::cl_int error_code;
+  if (!src->device_valid && !src->is_zero_copy && src->host_row_pitch == 0 &&
+      !src->is_parent_newer()) {
+    // Saves uploading the source first
+    error_code = clEnqueueWriteBuffer(
+        q->get(), dst->device_data.get(), false, 0, size,
+        src->get_host_pointer(), static_cast<::cl_uint>(wait.size()),
+        get_wait_list(wait), &evnt);
+    ++buffer_base::stats.uploads;
+    buffer_base::add_bytes_transferred(size);
+  } else {
+    use_on_device(q, wait, src, true);
+    error_code = clEnqueueCopyBuffer(
+        q->get(), src->device_data.get(), dst->device_data.get(), 0, 0, size,
+        static_cast<::cl_uint>(wait.size()), get_wait_list(wait), &evnt);
+  }
+  error::report(error_code);
+  return finish(q, evnt, dst, src);
+}
+
+cl_event buffer_command::enqueue_read(queue* q,
+                                      const vector_class<cl_event>& wait_events,
+                                      buffer_base* src, void* dst) {
+  auto size = src->get_size();
+  if (!src->device_valid && !src->is_zero_copy && src->host_row_pitch == 0 &&
+      !src->is_parent_newer() && is_complete(wait_events) &&
+      is_complete(src->events)) {
+    // Saves uploading the source only to read it back
+    std::memcpy(dst, src->get_host_pointer(), size);
+    ++buffer_base::stats.uploads_avoided;
+    buffer_base::stats.bytes_avoided += size;
+    return nullptr;
+  }
+
+  auto wait = wait_events;
+  use_on_device(q, wait, src, true);
+
+  cl_event evnt;
+  auto error_code = clEnqueueReadBuffer(
+      q->get(), src->device_data.get(), false, 0, size, dst,
+      static_cast<::cl_uint>(wait.size()), get_wait_list(wait), &evnt);
+  error::report(error_code);
+  ++buffer_base::stats.downloads;
+  buffer_base::add_bytes_transferred(size);
+  return finish(q, evnt, nullptr, src);
+}
+
+cl_event buffer_command::enqueue_write(
+    queue* q, const vector_class<cl_event>& wait_events, const void* src,
+    buffer_base* dst) {
+  auto size = dst->get_size();
+  auto wait = wait_events;
+  use_on_device(q, wait, dst, false);
+
+  cl_event evnt;
+  auto error_code = clEnqueueWriteBuffer(
+      q->get(), dst->device_data.get(), false, 0, size, src,
+      static_cast<::cl_uint>(wait.size()), get_wait_list(wait), &evnt);
+  error::report(error_code);
+  ++buffer_base::stats.uploads;
+  buffer_base::add_bytes_transferred(size);
+  return finish(q, evnt, dst, nullptr);
+}
+
+cl_event buffer_command::enqueue_fill(queue* q,
+                                      const vector_class<cl_event>& wait_events,
+                                      buffer_base* dst,
+                                      vector_class<char> pattern) {
+  auto wait = wait_events;
+  use_on_device(q, wait, dst, false);
+
+  cl_event evnt;
+  auto error_code = clEnqueueFillBuffer(
+      q->get(), dst->device_data.get(), pattern.data(), pattern.size(), 0,
+      dst->get_size(), static_cast<::cl_uint>(wait.size()),
+      get_wait_list(wait), &evnt);
+  error::report(error_code);
+  return finish(q, evnt, dst, nullptr);
+}
+
+void buffer_command::copy(buffer_access src, buffer_access dst) {
+  command::group_detail::check_scope();
+  if (src.data->get_size() > dst.data->get_size()) {
+    error::report(CL_INVALID_VALUE);
+  }
+  if (overlaps(src.data, dst.data)) {
+    error::report(CL_MEM_COPY_OVERLAP);
+  }
+  command::group_detail::add_buffer_command(dst, enqueue_copy, __func__,
+                                            src.data, dst.data);
+}
+
+void buffer_command::copy(buffer_access src, void* dst) {
+  command::group_detail::check_scope();
+  command::group_detail::add_buffer_command(src, enqueue_read, __func__,
+                                            src.data, dst);
+}
+
+void buffer_command::copy(const void* src, buffer_access dst) {
+  command::group_detail::check_scope();
+  command::group_detail::add_buffer_command(dst, enqueue_write, __func__, src,
+                                            dst.data);
+}
+
+void buffer_command::fill(buffer_access dst, vector_class<char> pattern) {
+  command::group_detail::check_scope();
+  auto size = pattern.size();
+  if (size == 0 || size > 128 || (size & (size - 1)) != 0) {
+    error::report(CL_INVALID_VALUE);
+  }
+  command::group_detail::add_buffer_command(dst, enqueue_fill, __func__,
+                                            dst.data, std::move(pattern));
+}
+
+void buffer_command::update_host(buffer_access acc) {
+  command::group_detail::check_scope();
+  command::group_detail::add_buffer_copy(
+      acc, access::mode::read, buffer_base::enqueue_command, __func__,
+      acc.data, &buffer_base::enqueue_read_buffer);
+}
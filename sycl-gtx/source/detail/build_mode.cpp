@@ -0,0 +1,34 @@
+#include "SYCL/detail/build_mode.h"
+
+#include <cstdlib>
+
+using namespace cl::sycl;
+using namespace detail;
+
+mutex_class build_mode::mutex;
+bool build_mode::is_configured = false;
+build_mode::value_t build_mode::mode = build_mode::separate;
+
+void build_mode::configure() {
+  if (is_configured) {
+    return;
+  }
+  is_configured = true;
+
+  auto value = std::getenv("SYCL_GTX_BUILD_MODE");
+  if (value != nullptr && string_class(value) == "batched") {
+    mode = batched;
+  }
+}
+
+void build_mode::set(value_t value) {
+  std::lock_guard<mutex_class> lock(mutex);
+  is_configured = true;
+  mode = value;
+}
+
+build_mode::value_t build_mode::get() {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  return mode;
+}
@@ -0,0 +1,103 @@
+#include "SYCL/detail/command_graph.h"
+
+#include "SYCL/kernel.h"
+#include "SYCL/queue.h"
+
+using namespace cl::sycl;
+using namespace detail;
+
+void command_graph::add_dependencies(recorded_group& recorded) {
+  auto& group = recorded.group;
+  // Nodes are numbered from zero, in the order the groups were recorded
+  auto n = dependencies.add(group.read_buffers, group.write_buffers);
+  for (auto& e : n->predecessors) {
+    recorded.predecessors.push_back(e.from_id);
+  }
+  read_buffers.insert(group.read_buffers.begin(), group.read_buffers.end());
+  write_buffers.insert(group.write_buffers.begin(), group.write_buffers.end());
+  ++totals.command_groups;
+}
+
+void command_graph::finish_recording() {
+  dependencies = task_graph();
+  for (auto buffers : {&read_buffers, &write_buffers}) {
+    for (auto buf : *buffers) {
+      buffer_lifetimes.push_back(buf->get_lifetime());
+    }
+  }
+}
+
+void command_graph::check_buffers() const {
+  for (auto& buf : buffer_lifetimes) {
+    if (buf.expired()) {
+      detail::error::report(CL_INVALID_MEM_OBJECT);
+    }
+  }
+}
+
+vector_class<event> command_graph::replay(
+    queue* q, const vector_class<cl_event>& wait_events, bool in_order) {
+  vector_class<event> issued;
+  // What a later command group has to wait on for each one to complete
+  vector_class<vector_class<cl_event>> completions(groups.size());
+
+  for (::size_t i = 0; i < groups.size(); ++i) {
+    auto& recorded = groups[i];
+    auto events = wait_events;
+    for (auto from : recorded.predecessors) {
+      auto& completion = completions[from];
+      events.insert(events.end(), completion.begin(), completion.end());
+    }
+
+    recorded.group.q = q;
+    auto group_events = recorded.group.run(events, in_order);
+    if (group_events.empty()) {
+      completions[i] = std::move(events);
+    } else {
+      // Commands of one group complete in order
+      completions[i].push_back(group_events.back().get());
+    }
+    issued.insert(issued.end(), group_events.begin(), group_events.end());
+  }
+
+  ++totals.replays;
+  totals.commands += issued.size();
+  return issued;
+}
+
+::size_t command_graph::get_bytes_transferred() const {
+  ::size_t bytes = 0;
+  for (auto& recorded : groups) {
+    bytes += recorded.group.bytes_transferred;
+  }
+  return bytes;
+}
+
+void command_graph::set_scalar_value(::size_t group_index,
+                                     ::size_t scalar_index,
+                                     vector_class<char> value) {
+  auto name = "_sycl_arg" + get_string<::size_t>::get(scalar_index + 1);
+  bool found = false;
+  for (auto& command : groups.at(group_index).group.commands) {
+    if (command.kern == nullptr) {
+      continue;
+    }
+    for (auto& s : command.kern->src.scalars) {
+      if (s.name != name) {
+        continue;
+      }
+      if (s.value.size() != value.size()) {
+        detail::error::report(CL_INVALID_ARG_SIZE);
+      }
+      s.value = value;
+      found = true;
+    }
+  }
+  if (!found) {
+    detail::error::report(CL_INVALID_ARG_INDEX);
+  }
+}
+
+command_graph::stats command_graph::get_stats() const {
+  return totals;
+}
@@ -0,0 +1,112 @@
+#include "SYCL/detail/compile_pool.h"
+
+#include <chrono>
+#include <cstdlib>
+
+using namespace cl::sycl;
+using namespace detail;
+
+bool compile_pool::is_configured = false;
+unsigned int compile_pool::num_threads = 0;
+bool compile_pool::stopping = false;
+::size_t compile_pool::idle = 0;
+mutex_class compile_pool::mutex;
+std::condition_variable compile_pool::wake;
+std::deque<std::packaged_task<void()>> compile_pool::tasks;
+vector_class<std::thread> compile_pool::workers;
+
+void compile_pool::configure() {
+  if (is_configured) {
+    return;
+  }
+  is_configured = true;
+
+  auto value = std::getenv("SYCL_GTX_COMPILE_THREADS");
+  if (value != nullptr) {
+    num_threads = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+  } else {
+    // Zero when unknown
+    num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) {
+      num_threads = 1;
+    }
+  }
+}
+
+void compile_pool::set_num_threads(unsigned int num) {
+  std::lock_guard<mutex_class> lock(mutex);
+  is_configured = true;
+  num_threads = num;
+}
+
+bool compile_pool::is_enabled() {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  return num_threads > 0;
+}
+
+void compile_pool::work() {
+  std::unique_lock<mutex_class> lock(mutex);
+  while (true) {
+    ++idle;
+    wake.wait(lock, [] { return stopping || !tasks.empty(); });
+    --idle;
+    if (tasks.empty()) {
+      return;
+    }
+    auto task = std::move(tasks.front());
+    tasks.pop_front();
+
+    lock.unlock();
+    task();
+    // Whatever the task captured is released without holding the lock
+    task = std::packaged_task<void()>();
+    lock.lock();
+  }
+}
+
+void compile_pool::stop() {
+  {
+    std::lock_guard<mutex_class> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+}
+
+compile_pool::future_t compile_pool::submit(task_t task, bool on_worker) {
+  std::packaged_task<void()> packaged(std::move(task));
+  future_t result = packaged.get_future().share();
+
+  {
+    std::lock_guard<mutex_class> lock(mutex);
+    configure();
+    auto max_workers = (on_worker && num_threads == 0 ? 1 : num_threads);
+    if (max_workers > 0 && !stopping) {
+      tasks.push_back(std::move(packaged));
+
+      // Threads are only started once there is something to build
+      if (idle < tasks.size() && workers.size() < max_workers) {
+        if (workers.empty()) {
+          std::atexit(stop);
+        }
+        workers.emplace_back(work);
+      }
+    }
+  }
+
+  if (packaged.valid()) {
+    packaged();
+  } else {
+    wake.notify_one();
+  }
+  return result;
+}
+
+bool compile_pool::is_done(const future_t& task) {
+  return !task.valid() || task.wait_for(std::chrono::seconds(0)) ==
+                              std::future_status::ready;
+}
@@ -5,8 +5,24 @@
 using namespace cl::sycl;
 using namespace detail;
 
-void detail::kernel_add(string_class line) {
-  kernel_ns::source::add(line);
+void detail::kernel_add(const ir::expr& expression) {
+  kernel_ns::source::add_expression(expression);
 }
 
-const string_class data_ref::open_parenthesis = "(";
+void detail::kernel_assign(const ir::expr& lhs, const char* op,
+                           const ir::expr& rhs) {
+  kernel_ns::source::add_assignment(lhs, op, rhs);
+}
+
+void detail::kernel_declare(const string_class& type, const ir::expr& name) {
+  kernel_ns::source::add_declaration(type, name);
+}
+
+void detail::kernel_declare(const string_class& type, const ir::expr& name,
+                            const ir::expr& init) {
+  kernel_ns::source::add_declaration(type, name, init);
+}
+
+counter_t detail::kernel_variable_id() {
+  return kernel_ns::source::next_variable_id();
+}
@@ -0,0 +1,64 @@
+#include "SYCL/detail/flush_batch.h"
+
+#include "SYCL/detail/debug.h"
+#include "SYCL/error_handler.h"
+#include <algorithm>
+
+using namespace cl::sycl;
+using namespace detail;
+
+void flush_batch::set_policy(const flush_policy& new_policy) {
+  policy = new_policy;
+}
+
+flush_policy flush_batch::get_policy() const {
+  return policy;
+}
+
+void flush_batch::add(cl_command_queue q, ::size_t num_commands,
+                      ::size_t num_bytes) {
+  if (groups == 0) {
+    oldest = clock::now();
+  }
+  if (std::find(queues.begin(), queues.end(), q) == queues.end()) {
+    queues.push_back(q);
+  }
+  ++groups;
+  bytes += num_bytes;
+  ++totals.command_groups;
+  totals.commands += num_commands;
+}
+
+bool flush_batch::empty() const {
+  return groups == 0;
+}
+
+bool flush_batch::is_due() const {
+  if (groups == 0) {
+    return false;
+  }
+  return (policy.max_groups != 0 && groups >= policy.max_groups) ||
+         (policy.max_bytes != 0 && bytes >= policy.max_bytes) ||
+         (policy.max_delay.count() != 0 &&
+          clock::now() - oldest >= policy.max_delay);
+}
+
+void flush_batch::flush() {
+  if (groups == 0) {
+    return;
+  }
+  debug() << "flushing" << groups << "command groups," << bytes << "bytes";
+  for (auto q : queues) {
+    auto error_code = clFlush(q);
+    error::report(error_code);
+  }
+  ++totals.flushes;
+  totals.flushes_avoided += groups - 1;
+  queues.clear();
+  groups = 0;
+  bytes = 0;
+}
+
+flush_batch::stats flush_batch::get_stats() const {
+  return totals;
+}
@@ -0,0 +1,127 @@
+#include "SYCL/detail/host_memory.h"
+
+#include "SYCL/error_handler.h"
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace cl::sycl;
+using namespace detail;
+
+const ::size_t host_memory::default_alignment;
+const ::size_t host_memory::huge_page_size;
+bool host_memory::is_configured = false;
+::size_t host_memory::alignment = default_alignment;
+::size_t host_memory::huge_page_threshold = 0;
+bool host_memory::first_touch = false;
+mutex_class host_memory::mutex;
+
+static bool is_power_of_two(::size_t value) {
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+void host_memory::configure() {
+  if (is_configured) {
+    return;
+  }
+  is_configured = true;
+
+  auto value = std::getenv("SYCL_GTX_HOST_ALIGNMENT");
+  if (value != nullptr) {
+    auto bytes = static_cast<::size_t>(std::strtoull(value, nullptr, 10));
+    if (is_power_of_two(bytes)) {
+      alignment = bytes;
+    }
+  }
+  value = std::getenv("SYCL_GTX_HUGE_PAGES_MB");
+  if (value != nullptr) {
+    huge_page_threshold =
+        static_cast<::size_t>(std::strtoull(value, nullptr, 10)) * 1024 * 1024;
+  }
+  value = std::getenv("SYCL_GTX_HOST_FIRST_TOUCH");
+  if (value != nullptr) {
+    first_touch = (string_class(value) == "1");
+  }
+}
+
+void* host_memory::allocate(::size_t bytes) {
+  ::size_t align;
+  bool huge;
+  bool touch;
+  {
+    std::lock_guard<mutex_class> lock(mutex);
+    configure();
+    huge = (huge_page_threshold > 0 && bytes >= huge_page_threshold);
+    align = (huge ? std::max(alignment, huge_page_size) : alignment);
+    touch = first_touch;
+  }
+  align = std::max(align, sizeof(void*));
+  // Keeps zero-sized buffers distinct, like new[] did
+  bytes = std::max(bytes, static_cast<::size_t>(1));
+
+#ifdef _WIN32
+  void* ptr = _aligned_malloc(bytes, align);
+#else
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, align, bytes) != 0) {
+    ptr = nullptr;
+  }
+#endif
+  if (ptr == nullptr) {
+    detail::error::report(CL_OUT_OF_HOST_MEMORY);
+  }
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (huge) {
+    // Only advice, the kernel might still use small pages
+    madvise(ptr, bytes, MADV_HUGEPAGE);
+  }
+#endif
+  if (touch) {
+    auto data = static_cast<char*>(ptr);
+    for (::size_t i = 0; i < bytes; i += default_alignment) {
+      data[i] = 0;
+    }
+  }
+  return ptr;
+}
+
+void host_memory::deallocate(void* ptr, ::size_t /*bytes*/) {
+#ifdef _WIN32
+  _aligned_free(ptr);
+#else
+  std::free(ptr);
+#endif
+}
+
+void host_memory::set_alignment(::size_t bytes) {
+  if (!is_power_of_two(bytes)) {
+    detail::error::report(CL_INVALID_VALUE);
+  }
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  alignment = bytes;
+}
+
+::size_t host_memory::get_alignment() {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  return alignment;
+}
+
+void host_memory::set_huge_page_threshold(::size_t bytes) {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  huge_page_threshold = bytes;
+}
+
+void host_memory::set_first_touch(bool enabled) {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  first_touch = enabled;
+}
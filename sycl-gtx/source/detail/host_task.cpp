@@ -0,0 +1,123 @@
+#include "SYCL/detail/host_task.h"
+
+#include "SYCL/buffer_base.h"
+#include "SYCL/command_group.h"
+#include "SYCL/detail/compile_pool.h"
+#include "SYCL/queue.h"
+#include <exception>
+
+using namespace cl::sycl;
+using namespace detail;
+
+host_task::host_task(function_t function, vector_class<buffer_access> buffers)
+    : function(std::move(function)), buffers(std::move(buffers)) {}
+
+void host_task::add(function_t function) {
+  using group = command::group_detail;
+  group::check_scope();
+
+  vector_class<buffer_access> buffers;
+  for (auto& acc : group::get_accessors()) {
+    if (acc.target != access::target::host_buffer) {
+      continue;
+    }
+    buffers.push_back(acc);
+    auto discard = (acc.mode == access::mode::discard_write ||
+                    acc.mode == access::mode::discard_read_write);
+    // Don't need to copy data that won't be used, only to map it
+    group::add_buffer_copy(
+        acc, access::mode::read,
+        (discard ? buffer_base::enqueue_map_command
+                 : buffer_base::enqueue_command),
+        __func__, acc.data, &buffer_base::enqueue_read_buffer);
+  }
+
+  shared_ptr_class<host_task> task(
+      new host_task(std::move(function), std::move(buffers)));
+  group::add_host_task(enqueue, __func__, std::move(task));
+}
+
+cl_event host_task::enqueue(queue* q, const vector_class<cl_event>& wait_events,
+                            shared_ptr_class<host_task> task) {
+  ::cl_int error_code;
+  auto user = clCreateUserEvent(q->get_context().get(), &error_code);
+  error::report(error_code);
+  event user_event(user);
+  error_code = clReleaseEvent(user);
+  error::report(error_code);
+
+  cl_event marker;
+  error_code = clEnqueueMarkerWithWaitList(
+      q->get(), static_cast<::cl_uint>(wait_events.size()),
+      (wait_events.empty() ? nullptr : wait_events.data()), &marker);
+  error::report(error_code);
+  event ready(marker);
+  error_code = clReleaseEvent(marker);
+  error::report(error_code);
+
+  vector_class<cl_event> finished = {user};
+  for (auto& acc : task->buffers) {
+    // Any data needed has been read back by the earlier commands
+    acc.data->use_on_host(acc.mode);
+    // Writes through sub-buffers go to the parent device data after the task
+    auto written = acc.data->write_to_parent(q->get(), false, {user});
+    if (written != nullptr) {
+      finished.push_back(written);
+    }
+  }
+
+  // In-order queues only wait for the user event through a command
+  cl_event done;
+  error_code = clEnqueueMarkerWithWaitList(
+      q->get(), static_cast<::cl_uint>(finished.size()), finished.data(),
+      &done);
+  error::report(error_code);
+  task->completion = event(done);
+  error_code = clReleaseEvent(done);
+  error::report(error_code);
+
+  for (auto& acc : task->buffers) {
+    error_code = clRetainEvent(done);
+    error::report(error_code);
+    acc.data->add_event(done);
+  }
+
+  auto errors = q->errors;
+  ready.then([task, user_event, errors](::cl_int status) {
+    if (status < 0) {
+      complete(user_event, status);
+      return;
+    }
+    // Not on the thread of the OpenCL callback, which the task could block
+    compile_pool::submit(
+        [task, user_event, errors] { task->run(user_event, *errors); }, true);
+  });
+
+  // Otherwise the task would only start once the queue is flushed again
+  error_code = clFlush(q->get());
+  error::report(error_code);
+  return done;
+}
+
+void host_task::run(event user_event, async_errors& errors) const {
+  ::cl_int status = CL_COMPLETE;
+  // Added before the command group completes, so that waiting reports it
+  try {
+    function();
+  } catch (exception& e) {
+    errors.add(std::current_exception(), e.what());
+    status = CL_OUT_OF_RESOURCES;
+  } catch (std::exception& e) {
+    errors.add(std::current_exception(), e.what());
+    status = CL_OUT_OF_RESOURCES;
+  } catch (...) {
+    errors.add(std::current_exception(), "host task failed");
+    status = CL_OUT_OF_RESOURCES;
+  }
+  complete(user_event, status);
+}
+
+void host_task::complete(const event& user_event, ::cl_int status) {
+  auto error_code = clSetUserEventStatus(user_event.get(), status);
+  error::report(error_code);
+}
@@ -0,0 +1,224 @@
+#include "SYCL/detail/ir.h"
+
+#include <cstring>
+#include <new>
+
+using namespace cl::sycl;
+using namespace detail;
+using namespace ir;
+
+SYCL_THREAD_LOCAL arena* arena::current = nullptr;
+
+void* arena::allocate(::size_t size) {
+  static const ::size_t alignment = alignof(node);
+  size = (size + alignment - 1) & ~(alignment - 1);
+  num_bytes += size;
+
+  if (size > block_size) {
+    // Kept in front, the last block is the one being filled
+    blocks.emplace(blocks.begin(), new char[size]);
+    return blocks.front().get();
+  }
+
+  if (used + size > block_size) {
+    blocks.emplace_back(new char[block_size]);
+    used = 0;
+  }
+  auto ptr = blocks.back().get() + used;
+  used += size;
+  return ptr;
+}
+
+const node* arena::make(node_t type, const char* text, const node* first,
+                        const node* second) {
+  ++num_nodes;
+  return new (allocate(sizeof(node))) node{type, text, first, second};
+}
+
+const char* arena::copy(const string_class& text) {
+  auto ptr = static_cast<char*>(allocate(text.size() + 1));
+  std::memcpy(ptr, text.c_str(), text.size() + 1);
+  return ptr;
+}
+
+arena::stats arena::get_stats() const {
+  return {num_nodes, num_bytes};
+}
+
+const node* expr::get_node(arena& a) const {
+  if (n != nullptr) {
+    return n;
+  }
+  return a.make(node_t::leaf, a.copy(text));
+}
+
+string_class expr::str() const {
+  if (n == nullptr) {
+    return text;
+  }
+  string_class code;
+  append(code, n);
+  return code;
+}
+
+namespace {
+
+/** Outside of kernels there is no arena, so the expression is rendered */
+expr result(arena* a, const node* n) {
+  if (a != nullptr) {
+    return n;
+  }
+  string_class code;
+  append(code, n);
+  return code;
+}
+
+expr make(node_t type, const char* text, const expr& first,
+          const expr* second = nullptr) {
+  auto a = arena::current;
+  arena tmp;
+  auto& target = (a != nullptr) ? *a : tmp;
+  return result(a, target.make(type, text, first.get_node(target),
+                               second ? second->get_node(target) : nullptr));
+}
+
+}  // namespace
+
+expr ir::binary(const char* op, const expr& first, const expr& second) {
+  return make(node_t::binary, op, first, &second);
+}
+
+expr ir::infix(const char* op, const expr& first, const expr& second) {
+  return make(node_t::infix, op, first, &second);
+}
+
+expr ir::prefix(const char* op, const expr& operand) {
+  return make(node_t::prefix, op, operand);
+}
+
+expr ir::postfix(const expr& operand, const char* op) {
+  return make(node_t::postfix, op, operand);
+}
+
+expr ir::subscript(const expr& operand, const expr& index) {
+  return make(node_t::subscript, nullptr, operand, &index);
+}
+
+expr ir::member(const expr& operand, const string_class& name) {
+  auto a = arena::current;
+  arena tmp;
+  auto& target = (a != nullptr) ? *a : tmp;
+  return result(a, target.make(node_t::member, target.copy(name),
+                               operand.get_node(target)));
+}
+
+expr ir::call(const string_class& name, std::initializer_list<expr> arguments) {
+  auto a = arena::current;
+  arena tmp;
+  auto& target = (a != nullptr) ? *a : tmp;
+
+  const node* list = nullptr;
+  for (auto it = arguments.end(); it != arguments.begin();) {
+    --it;
+    list = target.make(node_t::argument, nullptr, it->get_node(target), list);
+  }
+  return result(a, target.make(node_t::call, target.copy(name), list));
+}
+
+void ir::append(string_class& code, const node* n) {
+  switch (n->type) {
+    case node_t::leaf:
+      code += n->text;
+      break;
+    case node_t::binary:
+      code += '(';
+      append(code, n->first);
+      code += ' ';
+      code += n->text;
+      code += ' ';
+      append(code, n->second);
+      code += ')';
+      break;
+    case node_t::infix:
+      append(code, n->first);
+      code += ' ';
+      code += n->text;
+      code += ' ';
+      append(code, n->second);
+      break;
+    case node_t::prefix:
+      code += '(';
+      code += n->text;
+      append(code, n->first);
+      code += ')';
+      break;
+    case node_t::postfix:
+      code += '(';
+      append(code, n->first);
+      code += n->text;
+      code += ')';
+      break;
+    case node_t::call:
+      code += n->text;
+      code += '(';
+      for (auto arg = n->first; arg != nullptr; arg = arg->second) {
+        if (arg != n->first) {
+          code += ", ";
+        }
+        append(code, arg->first);
+      }
+      code += ')';
+      break;
+    case node_t::member:
+      append(code, n->first);
+      code += n->text;
+      break;
+    case node_t::subscript:
+      append(code, n->first);
+      code += '[';
+      append(code, n->second);
+      code += ']';
+      break;
+    case node_t::argument:
+    default:
+      break;
+  }
+}
+
+void ir::append(string_class& code, const statement& s) {
+  code.append(s.depth, '\t');
+  switch (s.type) {
+    case statement_t::text:
+      code += s.text;
+      break;
+    case statement_t::expression:
+      append(code, s.first);
+      break;
+    case statement_t::assign:
+      append(code, s.first);
+      code += ' ';
+      code += s.text;
+      code += ' ';
+      append(code, s.second);
+      break;
+    case statement_t::declare:
+      code += s.text;
+      code += ' ';
+      append(code, s.first);
+      if (s.second != nullptr) {
+        code += " = ";
+        append(code, s.second);
+      }
+      break;
+    case statement_t::control:
+      code += s.text;
+      append(code, s.first);
+      if (s.second != nullptr) {
+        code += "; ";
+        append(code, s.second);
+      }
+      code += ')';
+      break;
+  }
+  code += s.auto_end ? ';' : ' ';
+}
@@ -3,4 +3,4 @@
 using namespace cl::sycl;
 using namespace detail;
 
-::size_t kernel_name::current_count = 0;
+std::atomic<::size_t> kernel_name::current_count(0);
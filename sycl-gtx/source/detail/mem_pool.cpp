@@ -0,0 +1,130 @@
+#include "SYCL/detail/mem_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <tuple>
+
+using namespace cl::sycl;
+using namespace detail;
+
+bool mem_pool::is_configured = false;
+::size_t mem_pool::max_bytes = 256 * 1024 * 1024;
+mutex_class mem_pool::mutex;
+std::multimap<mem_pool::key, mem_pool::cached_mem> mem_pool::bins;
+::size_t mem_pool::returned = 0;
+mem_pool::stats mem_pool::totals = {0, 0, 0, 0, 0};
+
+bool mem_pool::key::operator<(const key& other) const {
+  return std::tie(ctx, flags, size) <
+         std::tie(other.ctx, other.flags, other.size);
+}
+
+void mem_pool::configure() {
+  if (is_configured) {
+    return;
+  }
+  is_configured = true;
+
+  auto value = std::getenv("SYCL_GTX_MEM_POOL_MB");
+  if (value != nullptr) {
+    max_bytes =
+        static_cast<::size_t>(std::strtoull(value, nullptr, 10)) * 1024 * 1024;
+  }
+}
+
+::size_t mem_pool::get_size_class(::size_t size) {
+  if (size <= min_size) {
+    return min_size;
+  }
+  ::size_t power = min_size;
+  while (power <= size / 2) {
+    power *= 2;
+  }
+  auto step = power / 4;
+  return (size + step - 1) / step * step;
+}
+
+mem_pool::mem_t mem_pool::acquire(cl_context ctx, cl_mem_flags flags,
+                                  ::size_t size, ::cl_int& error_code) {
+  if (size == 0) {
+    // Same as clCreateBuffer, rounding up would hide it
+    error_code = CL_INVALID_BUFFER_SIZE;
+    return mem_t();
+  }
+  key k = {ctx, flags, get_size_class(size)};
+  {
+    std::lock_guard<mutex_class> lock(mutex);
+    configure();
+    auto it = bins.find(k);
+    if (it != bins.end()) {
+      auto mem = it->second.mem;
+      bins.erase(it);
+      ++totals.reuses;
+      --totals.cached;
+      totals.bytes_cached -= k.size;
+      error_code = CL_SUCCESS;
+      return mem_t(mem, [k](cl_mem m) { give_back(k, m); });
+    }
+    ++totals.allocations;
+  }
+
+  auto mem = clCreateBuffer(ctx, flags, k.size, nullptr, &error_code);
+  if (mem == nullptr) {
+    return mem_t();
+  }
+  return mem_t(mem, [k](cl_mem m) { give_back(k, m); });
+}
+
+void mem_pool::give_back(key k, cl_mem mem) {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  if (k.size > max_bytes) {
+    ++totals.releases;
+    clReleaseMemObject(mem);
+    return;
+  }
+  trim_locked(max_bytes - k.size);
+  bins.insert({k, {k, mem, returned++}});
+  ++totals.cached;
+  totals.bytes_cached += k.size;
+}
+
+void mem_pool::trim_locked(::size_t bytes) {
+  while (totals.bytes_cached > bytes) {
+    auto oldest = std::min_element(
+        bins.begin(), bins.end(),
+        [](const std::pair<const key, cached_mem>& a,
+           const std::pair<const key, cached_mem>& b) {
+          return a.second.age < b.second.age;
+        });
+    // Not reported, this also runs when buffers are destroyed
+    clReleaseMemObject(oldest->second.mem);
+    ++totals.releases;
+    --totals.cached;
+    totals.bytes_cached -= oldest->first.size;
+    bins.erase(oldest);
+  }
+}
+
+void mem_pool::trim(::size_t bytes) {
+  std::lock_guard<mutex_class> lock(mutex);
+  trim_locked(bytes);
+}
+
+void mem_pool::set_max_bytes(::size_t bytes) {
+  std::lock_guard<mutex_class> lock(mutex);
+  is_configured = true;
+  max_bytes = bytes;
+  trim_locked(max_bytes);
+}
+
+bool mem_pool::is_enabled() {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  return max_bytes > 0;
+}
+
+mem_pool::stats mem_pool::get_stats() {
+  std::lock_guard<mutex_class> lock(mutex);
+  return totals;
+}
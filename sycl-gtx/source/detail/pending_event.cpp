@@ -0,0 +1,123 @@
+#include "SYCL/detail/pending_event.h"
+
+#include "SYCL/queue.h"
+
+using namespace cl::sycl;
+using namespace detail;
+
+pending_event::pending_event(queue* master) : master(master) {}
+
+bool pending_event::start(std::unique_lock<mutex_class>& lock,
+                          bool watch_builds) {
+  if (!is_enqueued && master != nullptr) {
+    auto q = master;
+    // The queue detaches its events before waiting for this,
+    // so it stays alive after this event is unlocked
+    struct starting_guard {
+      std::atomic<::size_t>& starting;
+      ~starting_guard() {
+        --starting;
+      }
+    } guard = {q->mutex.starting};
+    ++guard.starting;
+
+    watch_builds = watch_builds && !is_watched;
+    is_watched = is_watched || watch_builds;
+    // The queue sets the completion while enqueuing
+    lock.unlock();
+    {
+      std::lock_guard<queue::mutex_t> queue_lock(q->mutex.value);
+      q->flush(false);
+      q->flush_commands();
+      auto builds = (watch_builds ? q->get_builds()
+                                  : vector_class<compile_pool::future_t>());
+      if (!builds.empty()) {
+        auto self = shared_from_this();
+        q->add_build_watcher(compile_pool::submit([self, builds] {
+          for (auto& build : builds) {
+            build.wait();
+          }
+          std::unique_lock<mutex_class> lock(self->mutex);
+          self->start(lock);
+        }));
+      }
+    }
+    lock.lock();
+  }
+  if (!is_enqueued) {
+    return false;
+  }
+  if (!is_flushed) {
+    // Might still be in a batch of the queue
+    is_flushed = true;
+    auto error_code = clFlush(command_q.get());
+    error::report(error_code);
+  }
+  return true;
+}
+
+void pending_event::set_master(queue* q) {
+  std::lock_guard<mutex_class> lock(mutex);
+  if (!is_enqueued) {
+    master = q;
+  }
+}
+
+void pending_event::set(event completed, cl_command_queue q) {
+  vector_class<callback_t> waiting;
+  {
+    std::lock_guard<mutex_class> lock(mutex);
+    master = nullptr;
+    completion = completed;
+    command_q = q;
+    is_enqueued = true;
+    if (!callbacks.empty()) {
+      is_flushed = true;
+      waiting = std::move(callbacks);
+      callbacks.clear();
+    }
+  }
+
+  if (!waiting.empty()) {
+    auto error_code = clFlush(q);
+    error::report(error_code);
+  }
+  for (auto& callback : waiting) {
+    completed.then(std::move(callback));
+  }
+}
+
+void pending_event::cancel() {
+  std::lock_guard<mutex_class> lock(mutex);
+  master = nullptr;
+  // Futures waiting on them report a broken promise
+  callbacks.clear();
+}
+
+bool pending_event::is_complete() {
+  std::unique_lock<mutex_class> lock(mutex);
+  if (!start(lock)) {
+    return false;
+  }
+  auto completed = completion;
+  lock.unlock();
+  return completed.is_complete();
+}
+
+void pending_event::then(callback_t callback) {
+  std::unique_lock<mutex_class> lock(mutex);
+  if (!start(lock, true)) {
+    callbacks.push_back(std::move(callback));
+    return;
+  }
+  auto completed = completion;
+  lock.unlock();
+  completed.then(std::move(callback));
+}
+
+std::future<void> pending_event::get_future() {
+  auto promise = std::make_shared<std::promise<void>>();
+  auto result = promise->get_future();
+  then(fulfil(promise));
+  return result;
+}
@@ -0,0 +1,94 @@
+#include "SYCL/detail/program_cache.h"
+
+#include <tuple>
+
+using namespace cl::sycl;
+using namespace detail;
+
+mutex_class program_cache::mutex;
+std::map<program_cache::key, shared_ptr_class<program_cache::entry>>
+    program_cache::entries;
+std::list<program_cache::key> program_cache::insertion_order;
+::size_t program_cache::hits = 0;
+::size_t program_cache::misses = 0;
+
+bool program_cache::entry::is_building() const {
+  return !compile_pool::is_done(built);
+}
+
+bool program_cache::key::operator<(const key& other) const {
+  return std::tie(ctx, kernel_name_id, code_hash, devices, options) <
+         std::tie(other.ctx, other.kernel_name_id, other.code_hash,
+                  other.devices, other.options);
+}
+
+program_cache::key program_cache::make_key(
+    cl_context ctx, ::size_t kernel_name_id, const string_class& code,
+    const vector_class<cl_device_id>& devices, const string_class& options) {
+  return {ctx, kernel_name_id, hash(code), devices, options};
+}
+
+::size_t program_cache::hash(const string_class& code) {
+  // 64-bit FNV-1a, truncated on 32-bit platforms
+  unsigned long long h = 14695981039346656037ull;
+  for (auto c : code) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 1099511628211ull;
+  }
+  return static_cast<::size_t>(h);
+}
+
+shared_ptr_class<program_cache::entry> program_cache::find(
+    cl_context ctx, ::size_t kernel_name_id, const string_class& code,
+    const vector_class<cl_device_id>& devices, const string_class& options) {
+  auto k = make_key(ctx, kernel_name_id, code, devices, options);
+  std::lock_guard<mutex_class> lock(mutex);
+  auto it = entries.find(k);
+
+  // Compare the code as well, a hash collision must not return another kernel
+  if (it == entries.end() || it->second->code != code) {
+    ++misses;
+    return nullptr;
+  }
+
+  ++hits;
+  return it->second;
+}
+
+shared_ptr_class<program_cache::entry> program_cache::add(
+    cl_context ctx, ::size_t kernel_name_id, const string_class& code,
+    const vector_class<cl_device_id>& devices, const string_class& options,
+    cl_program compiled) {
+  auto k = make_key(ctx, kernel_name_id, code, devices, options);
+
+  auto e = shared_ptr_class<entry>(new entry());
+  e->code = code;
+  e->compiled = compiled;
+
+  std::lock_guard<mutex_class> lock(mutex);
+  auto it = entries.find(k);
+  if (it == entries.end()) {
+    insertion_order.push_back(k);
+  }
+  entries[k] = e;
+
+  if (entries.size() > max_entries) {
+    entries.erase(insertion_order.front());
+    insertion_order.pop_front();
+  }
+
+  return e;
+}
+
+program_cache::stats program_cache::get_stats() {
+  std::lock_guard<mutex_class> lock(mutex);
+  return {hits, misses, entries.size()};
+}
+
+void program_cache::clear() {
+  std::lock_guard<mutex_class> lock(mutex);
+  entries.clear();
+  insertion_order.clear();
+  hits = 0;
+  misses = 0;
+}
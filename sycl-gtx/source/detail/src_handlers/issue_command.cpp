@@ -3,6 +3,7 @@
 #include "SYCL/accessors/buffer.h"
 #include "SYCL/buffer.h"
 #include "SYCL/kernel.h"
+#include "SYCL/queue.h"
 
 using namespace cl::sycl;
 using detail::issue_command;
@@ -14,61 +15,116 @@ void issue_command::compile_command(queue* q,
                                     source src, shared_ptr_class<kernel> kern) {
 }
 
-void issue_command::prepare_kernel(shared_ptr_class<kernel> kern) {
+/**
+ * Cached and interoperability kernels share their cl_kernel between
+ * kernel objects, the mutex is picked by the cl_kernel
+ */
+static mutex_class& get_kernel_mutex(cl_kernel k) {
+  static const ::size_t num_mutexes = 64;
+  static mutex_class mutexes[num_mutexes];
+  return mutexes[std::hash<cl_kernel>()(k) % num_mutexes];
+}
+
+issue_command::kernel_lock issue_command::prepare_kernel(
+    shared_ptr_class<kernel> kern) {
   DSELF() << kern->src.kernel_name;
+  kern->wait_for_build();
   auto k = kern->get();
+  kernel_lock lock(get_kernel_mutex(k));
   ::cl_int error_code;
   int i = 0;
   for (auto& acc : kern->src.resources) {
-    if (acc.second.acc.target == access::target::local) {
-      error_code = clSetKernelArg(k, i, acc.second.size, nullptr);
+    if (acc.acc.target == access::target::local) {
+      error_code = clSetKernelArg(k, i, acc.size, nullptr);
     } else {
-      auto mem = acc.second.acc.data->device_data.get();
-      error_code = clSetKernelArg(k, i, acc.second.size, &mem);
+      auto mem = acc.acc.data->device_data.get();
+      error_code = clSetKernelArg(k, i, acc.size, &mem);
     }
     detail::error::report(error_code);
     ++i;
   }
+  for (auto& s : kern->src.scalars) {
+    error_code = clSetKernelArg(k, i, s.value.size(), s.value.data());
+    detail::error::report(error_code);
+    ++i;
+  }
+  for (auto& arg : kern->arguments) {
+    if (!arg.value.empty()) {
+      error_code =
+          clSetKernelArg(k, arg.index, arg.value.size(), arg.value.data());
+    } else if (arg.acc.target == access::target::local) {
+      error_code = clSetKernelArg(k, arg.index, arg.size, nullptr);
+    } else {
+      auto mem = arg.acc.data->device_data.get();
+      error_code = clSetKernelArg(k, arg.index, arg.size, &mem);
+    }
+    detail::error::report(error_code);
+  }
+  return lock;
 }
 
-void issue_command::write_buffers_to_device(shared_ptr_class<kernel> kern) {
+vector_class<detail::buffer_access> issue_command::get_buffers(
+    shared_ptr_class<kernel> kern) {
+  vector_class<buffer_access> buffers;
   for (auto& acc : kern->src.resources) {
-    auto mode = acc.second.acc.mode;
+    buffers.push_back(acc.acc);
+  }
+  for (auto& arg : kern->arguments) {
+    if (arg.value.empty()) {
+      buffers.push_back(arg.acc);
+    }
+  }
+  return buffers;
+}
+
+void issue_command::finish_kernel(queue* q, shared_ptr_class<kernel> kern,
+                                  shared_ptr_class<event> evnt) {
+  for (auto& acc : get_buffers(kern)) {
+    if (acc.target == access::target::local) {
+      continue;
+    }
+    if (acc.mode != access::mode::read) {
+      acc.data->set_device_written(q->get(), evnt->get());
+    } else {
+      acc.data->set_device_read(evnt->get());
+    }
+  }
+}
+
+void issue_command::write_buffers_to_device(shared_ptr_class<kernel> kern) {
+  for (auto& acc : get_buffers(kern)) {
+    auto mode = acc.mode;
+    if (acc.target == access::target::local) {
+      continue;
+    }
     if (mode == access::mode::write || mode == access::mode::discard_write ||
-        mode == access::mode::discard_read_write ||
-        acc.second.acc.target == access::target::local) {
-      // Don't need to copy data that won't be used
+        mode == access::mode::discard_read_write) {
+      // Don't need to copy data that won't be used, only to unmap it
+      command::group_detail::add_buffer_copy(
+          acc, access::mode::write, buffer_base::enqueue_map_command, __func__,
+          acc.data, &clEnqueueWriteBuffer);
       continue;
     }
-    command::group_detail::add_buffer_copy(
-        acc.second.acc, access::mode::write, buffer_base::enqueue_command,
-        __func__, acc.second.acc.data, &clEnqueueWriteBuffer);
+    command::group_detail::add_buffer_copy(acc, access::mode::write,
+                                           buffer_base::enqueue_command,
+                                           __func__, acc.data,
+                                           &clEnqueueWriteBuffer);
   }
 }
 
-void issue_command::enqueue_task_command(
+cl_event issue_command::enqueue_task_command(
     queue* q, const vector_class<cl_event>& wait_events,
-    shared_ptr_class<kernel> kern, event* evnt) {
-  prepare_kernel(kern);
-  kern->enqueue_task(q, wait_events, evnt);
+    shared_ptr_class<kernel> kern, shared_ptr_class<event> evnt) {
+  auto lock = prepare_kernel(kern);
+  kern->enqueue_task(q, wait_events, evnt.get());
+  lock.unlock();
+  finish_kernel(q, kern, evnt);
+  return evnt->get();
 }
 
-void issue_command::enqueue_task(shared_ptr_class<kernel> kern, event* evnt) {
+void issue_command::enqueue_task(shared_ptr_class<kernel> kern,
+                                 shared_ptr_class<event> evnt) {
+  command::group_detail::add_build(kern->built);
   command::group_detail::add_kernel_enqueue_task(enqueue_task_command, __func__,
                                                  kern, evnt);
 }
-
-void issue_command::read_buffers_from_device(shared_ptr_class<kernel> kern) {
-  for (auto& acc : kern->src.resources) {
-    if (acc.second.acc.mode == access::mode::read ||
-        acc.second.acc.target == access::target::local) {
-      // Don't need to read back read-only buffers
-      continue;
-    }
-    command::group_detail::add_buffer_copy(
-        acc.second.acc, access::mode::read, buffer_base::enqueue_command,
-        __func__, acc.second.acc.data,
-        reinterpret_cast<buffer_base::clEnqueueBuffer_f>(  // NOLINT
-            &clEnqueueReadBuffer));
-  }
-}
@@ -0,0 +1,485 @@
+#include "SYCL/detail/src_handlers/kernel_fusion.h"
+
+#include "SYCL/detail/debug.h"
+#include "SYCL/detail/kernel_name.h"
+#include "SYCL/detail/src_handlers/optimizer.h"
+#include <cctype>
+#include <cstdlib>
+#include <set>
+
+using namespace cl::sycl;
+using namespace detail::kernel_ns;
+
+mutex_class fusion::mutex;
+bool fusion::is_configured = false;
+bool fusion::enabled = false;
+std::map<std::pair<::size_t, ::size_t>, ::size_t> fusion::kernel_name_ids;
+fusion::stats fusion::totals = {0, 0};
+
+namespace {
+
+using detail::counter_t;
+using detail::ir::arena;
+using detail::ir::node;
+using detail::ir::node_t;
+using detail::ir::statement;
+using detail::ir::statement_t;
+using name_f = function_class<string_class(const string_class&)>;
+
+bool is_name_start(char c) {
+  return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool is_name_char(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool is_name(const string_class& text) {
+  if (text.empty() || !is_name_start(text[0])) {
+    return false;
+  }
+  for (auto c : text) {
+    if (!is_name_char(c)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Renames identifiers in generated code, skipping literals and member names */
+string_class rename(const char* text, const name_f& name_of) {
+  string_class result;
+  if (text == nullptr) {
+    return result;
+  }
+  string_class code(text);
+  ::size_t i = 0;
+  while (i < code.size()) {
+    auto start = i;
+    if (is_name_start(code[i])) {
+      while (i < code.size() && is_name_char(code[i])) {
+        ++i;
+      }
+      auto name = code.substr(start, i - start);
+      if (start == 0 || code[start - 1] != '.') {
+        name = name_of(name);
+      }
+      result += name;
+    } else if (std::isdigit(static_cast<unsigned char>(code[i]))) {
+      while (i < code.size() && (is_name_char(code[i]) || code[i] == '.')) {
+        ++i;
+      }
+      result += code.substr(start, i - start);
+    } else {
+      result += code[i];
+      ++i;
+    }
+  }
+  return result;
+}
+
+bool mentions(const char* text, const std::set<string_class>& names) {
+  bool found = false;
+  rename(text, [&](const string_class& name) {
+    found = found || (names.count(name) > 0);
+    return name;
+  });
+  return found;
+}
+
+bool mentions(const node* n, const std::set<string_class>& names) {
+  return n != nullptr &&
+         (mentions(n->text, names) || mentions(n->first, names) ||
+          mentions(n->second, names));
+}
+
+bool mentions(const statement& s, const std::set<string_class>& names) {
+  return mentions(s.text, names) || mentions(s.first, names) ||
+         mentions(s.second, names);
+}
+
+/** Statements that stop a work-item or wait for the others */
+bool has_synchronization(const vector_class<statement>& lines) {
+  static const std::set<string_class> names = {
+      "barrier", "mem_fence", "read_mem_fence", "write_mem_fence", "return"};
+  for (auto& s : lines) {
+    if (mentions(s, names)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool is_global_id(const node* n) {
+  if (n == nullptr || n->type != node_t::leaf || n->text == nullptr) {
+    return false;
+  }
+  string_class name(n->text);
+  return name == "_sycl_gid" || name == "_sycl_gid0";
+}
+
+bool is_element(const node* n, const string_class& buffer) {
+  return n != nullptr && n->type == node_t::subscript &&
+         n->first != nullptr && n->first->type == node_t::leaf &&
+         n->first->text != nullptr && buffer == n->first->text;
+}
+
+/** Whether the buffer is only accessed at the index of the work-item */
+bool only_at_global_id(const node* n, const string_class& buffer) {
+  if (n == nullptr) {
+    return true;
+  }
+  if (is_element(n, buffer)) {
+    return is_global_id(n->second);
+  }
+  return !mentions(n->text, {buffer}) &&
+         only_at_global_id(n->first, buffer) &&
+         only_at_global_id(n->second, buffer);
+}
+
+bool only_at_global_id(const vector_class<statement>& lines,
+                       const string_class& buffer) {
+  for (auto& s : lines) {
+    if (mentions(s.text, {buffer}) || !only_at_global_id(s.first, buffer) ||
+        !only_at_global_id(s.second, buffer)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Declarations of the global id, at the start of each range kernel */
+bool is_id_declaration(const statement& s) {
+  return s.type == statement_t::declare && s.depth == 1 &&
+         s.first != nullptr && s.first->type == node_t::leaf &&
+         s.first->text != nullptr &&
+         string_class(s.first->text).compare(0, 9, "_sycl_gid") == 0;
+}
+
+string_class render(const statement& s) {
+  string_class code;
+  detail::ir::append(code, s);
+  return code;
+}
+
+bool writes(access::mode mode) {
+  return mode != access::mode::read;
+}
+
+/** Access mode of a buffer used by both kernels, the first one going first */
+access::mode combine(access::mode first, access::mode second) {
+  if (!writes(first) && !writes(second)) {
+    return access::mode::read;
+  }
+  if (first == access::mode::read || first == access::mode::read_write) {
+    return access::mode::read_write;
+  }
+  return first;
+}
+
+/** Numbers the generated variables of the second kernel after the first */
+string_class shift_variable(const string_class& name, counter_t offset) {
+  if (name.size() < 3 || name[0] != '_' || name.compare(0, 5, "_sycl") == 0) {
+    return name;
+  }
+  auto pos = name.rfind('_');
+  if (pos == 0 || pos + 1 == name.size()) {
+    return name;
+  }
+  for (auto i = pos + 1; i < name.size(); ++i) {
+    if (!std::isdigit(static_cast<unsigned char>(name[i]))) {
+      return name;
+    }
+  }
+  auto id = std::strtoull(name.c_str() + pos + 1, nullptr, 10);
+  return name.substr(0, pos + 1) +
+         detail::get_string<counter_t>::get(static_cast<counter_t>(id) +
+                                            offset);
+}
+
+/** Copies statements of a kernel into the arena of the fused one */
+class copier {
+ public:
+  // Elements of buffers replaced by a variable, by buffer name
+  std::map<string_class, const node*> forwarded;
+  ::size_t num_forwarded = 0;
+
+  copier(arena& a, name_f name_of) : a(a), name_of(std::move(name_of)) {}
+
+  const node* copy(const node* n, bool forward = true) {
+    if (n == nullptr) {
+      return nullptr;
+    }
+    if (forward && n->type == node_t::subscript && n->first != nullptr &&
+        n->first->type == node_t::leaf && n->first->text != nullptr) {
+      auto it = forwarded.find(n->first->text);
+      if (it != forwarded.end()) {
+        ++num_forwarded;
+        return it->second;
+      }
+    }
+    // The address of a buffer element is not the address of a variable
+    bool address = (n->type == node_t::prefix && n->text != nullptr &&
+                    string_class(n->text) == "&");
+    auto text = (n->text == nullptr ? nullptr : this->text(n->text));
+    return a.make(n->type, text, copy(n->first, forward && !address),
+                  copy(n->second, forward && !address));
+  }
+
+  statement copy(const statement& s) {
+    return {s.type,       s.auto_end,    s.depth,
+            text(s.text), copy(s.first), copy(s.second)};
+  }
+
+  const char* text(const char* original) {
+    return a.copy(rename(original, name_of));
+  }
+
+ private:
+  arena& a;
+  name_f name_of;
+};
+
+template <class Resources>
+auto find_buffer(Resources& resources, detail::buffer_base* data)
+    -> decltype(resources.data()) {
+  for (auto& info : resources) {
+    if (info.acc.data == data) {
+      return &info;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+void fusion::set_enabled(bool enable) {
+  std::lock_guard<mutex_class> lock(mutex);
+  is_configured = true;
+  enabled = enable;
+}
+
+bool fusion::is_enabled() {
+  std::lock_guard<mutex_class> lock(mutex);
+  if (!is_configured) {
+    is_configured = true;
+    auto value = std::getenv("SYCL_GTX_FUSE_KERNELS");
+    enabled = (value != nullptr && string_class(value) != "0");
+  }
+  return enabled;
+}
+
+bool fusion::can_fuse(const source& producer, const source& consumer) {
+  if (producer.nodes == nullptr || consumer.nodes == nullptr ||
+      producer.lines.size() + consumer.lines.size() > max_statements ||
+      has_synchronization(producer.lines) ||
+      has_synchronization(consumer.lines)) {
+    return false;
+  }
+  for (auto src : {&producer, &consumer}) {
+    for (auto& info : src->resources) {
+      if (info.acc.target == access::target::local) {
+        return false;
+      }
+    }
+  }
+
+  // Both kernels have to agree on the global id they share
+  std::map<string_class, string_class> declarations;
+  for (auto& s : producer.lines) {
+    if (!is_id_declaration(s)) {
+      break;
+    }
+    declarations[s.first->text] = render(s);
+  }
+  for (auto& s : consumer.lines) {
+    if (!is_id_declaration(s)) {
+      break;
+    }
+    auto it = declarations.find(s.first->text);
+    if (it != declarations.end() && it->second != render(s)) {
+      return false;
+    }
+  }
+
+  bool chained = false;
+  for (auto& first : producer.resources) {
+    auto second = find_buffer(consumer.resources, first.acc.data);
+    if (second == nullptr) {
+      continue;
+    }
+    if (first.acc.target != second->acc.target) {
+      return false;
+    }
+    if (!writes(first.acc.mode) && !writes(second->acc.mode)) {
+      continue;
+    }
+    // Another work-item could be reading or writing the same element
+    if (!only_at_global_id(producer.lines, first.resource_name) ||
+        !only_at_global_id(consumer.lines, second->resource_name)) {
+      return false;
+    }
+    chained = chained || (writes(first.acc.mode) &&
+                          (second->acc.mode == access::mode::read ||
+                           second->acc.mode == access::mode::read_write));
+  }
+  return chained;
+}
+
+::size_t fusion::get_kernel_name_id(::size_t producer_id,
+                                    ::size_t consumer_id) {
+  auto key = std::make_pair(producer_id, consumer_id);
+  std::lock_guard<mutex_class> lock(mutex);
+  auto it = kernel_name_ids.find(key);
+  if (it != kernel_name_ids.end()) {
+    return it->second;
+  }
+  auto id = kernel_name::get_new();
+  kernel_name_ids[key] = id;
+  return id;
+}
+
+source fusion::fuse(const source& producer, const source& consumer,
+                    ::size_t kernel_name_id) {
+  source fused(kernel_name_id);
+  fused.nodes.reset(new ir::arena());
+  auto& a = *fused.nodes;
+  fused.resources = producer.resources;
+  fused.scalars = producer.scalars;
+  fused.num_variables = producer.num_variables + consumer.num_variables;
+
+  // Consumer parameter names in the fused kernel
+  std::map<string_class, string_class> names;
+  // Consumer names of the buffers it only reads after the producer writes them
+  std::map<string_class, string_class> forwardable;
+  for (auto& info : consumer.resources) {
+    auto shared = find_buffer(fused.resources, info.acc.data);
+    if (shared == nullptr) {
+      auto copy = info;
+      copy.resource_name =
+          source::resource_name_root +
+          get_string<::size_t>::get(fused.resources.size() + 1);
+      names[info.resource_name] = copy.resource_name;
+      fused.resources.push_back(std::move(copy));
+      continue;
+    }
+    auto& target = *shared;
+    names[info.resource_name] = target.resource_name;
+    if (writes(target.acc.mode) && info.acc.mode == access::mode::read) {
+      forwardable[target.resource_name] = info.resource_name;
+    }
+    target.acc.mode = combine(target.acc.mode, info.acc.mode);
+  }
+  for (auto& s : consumer.scalars) {
+    auto copy = s;
+    copy.name =
+        "_sycl_arg" + get_string<::size_t>::get(fused.scalars.size() + 1);
+    names[s.name] = copy.name;
+    fused.scalars.push_back(std::move(copy));
+  }
+
+  copier from_producer(a, [](const string_class& name) { return name; });
+  auto offset = producer.num_variables;
+  copier from_consumer(a, [&names, offset](const string_class& name) {
+    auto it = names.find(name);
+    if (it != names.end()) {
+      return it->second;
+    }
+    return shift_variable(name, offset);
+  });
+
+  // The last store of the producer to each forwarded buffer,
+  // if it is always executed
+  struct store {
+    string_class type;
+    const node* variable;
+  };
+  std::map<::size_t, store> last_stores;
+  for (auto& buffer : forwardable) {
+    ::size_t last = 0;
+    for (::size_t i = 0; i < producer.lines.size(); ++i) {
+      if (mentions(producer.lines[i], {buffer.first})) {
+        last = i;
+      }
+    }
+    auto& s = producer.lines[last];
+    if (s.type != statement_t::assign || s.depth != 1 ||
+        string_class(s.text) != "=" || !is_element(s.first, buffer.first) ||
+        last_stores.count(last) > 0) {
+      continue;
+    }
+    string_class element;
+    for (auto& info : producer.resources) {
+      if (info.resource_name == buffer.first) {
+        element = info.type_name;
+      }
+    }
+    if (!element.empty() && element.back() == '*') {
+      element.pop_back();
+    }
+    if (!is_name(element)) {
+      continue;
+    }
+    auto name = '_' + element + '_' +
+                get_string<counter_t>::get(fused.num_variables++);
+    auto variable = a.make(node_t::leaf, a.copy(name));
+    last_stores[last] = {element, variable};
+    from_consumer.forwarded[buffer.second] = variable;
+  }
+
+  // Global id declarations of both kernels come first
+  std::set<string_class> declared;
+  ::size_t producer_start = 0;
+  for (; producer_start < producer.lines.size(); ++producer_start) {
+    auto& s = producer.lines[producer_start];
+    if (!is_id_declaration(s)) {
+      break;
+    }
+    declared.insert(s.first->text);
+    fused.lines.push_back(from_producer.copy(s));
+  }
+  ::size_t consumer_start = 0;
+  for (; consumer_start < consumer.lines.size(); ++consumer_start) {
+    auto& s = consumer.lines[consumer_start];
+    if (!is_id_declaration(s)) {
+      break;
+    }
+    if (declared.insert(s.first->text).second) {
+      fused.lines.push_back(from_consumer.copy(s));
+    }
+  }
+
+  for (auto i = producer_start; i < producer.lines.size(); ++i) {
+    auto& s = producer.lines[i];
+    auto it = last_stores.find(i);
+    if (it == last_stores.end()) {
+      fused.lines.push_back(from_producer.copy(s));
+      continue;
+    }
+    auto& st = it->second;
+    fused.lines.push_back({statement_t::declare, true, s.depth,
+                           a.copy(st.type), st.variable,
+                           from_producer.copy(s.second)});
+    fused.lines.push_back({statement_t::assign, true, s.depth, a.copy("="),
+                           from_producer.copy(s.first), st.variable});
+  }
+  for (auto i = consumer_start; i < consumer.lines.size(); ++i) {
+    fused.lines.push_back(from_consumer.copy(consumer.lines[i]));
+  }
+
+  debug() << "fused kernels" << producer.kernel_name << consumer.kernel_name
+          << "into" << fused.kernel_name;
+  {
+    std::lock_guard<mutex_class> lock(mutex);
+    ++totals.fused;
+    totals.loads_forwarded += from_consumer.num_forwarded;
+  }
+
+  optimizer::run(fused, kernel_name_id);
+  return fused;
+}
+
+fusion::stats fusion::get_stats() {
+  std::lock_guard<mutex_class> lock(mutex);
+  return totals;
+}
@@ -10,37 +10,88 @@ using namespace cl::sycl;
 using namespace detail::kernel_ns;
 
 const string_class source::resource_name_root = "_sycl_buf";
-SYCL_THREAD_LOCAL int source::num_resources = 0;
+const string_class source::kernel_name_root = "_sycl_kernel_";
 SYCL_THREAD_LOCAL source* source::scope = nullptr;
 
 bool source::in_scope() {
   return scope != nullptr;
 }
 
+detail::counter_t source::next_variable_id() {
+  if (scope == nullptr) {
+    return 0;
+  }
+  return scope->num_variables++;
+}
+
 void source::enter(source& src) {
+  if (src.nodes == nullptr) {
+    src.nodes.reset(new ir::arena());
+  }
   scope = &src;
-  num_resources = 0;
+  ir::arena::current = src.nodes.get();
 }
 
 source source::exit(source& src) {
   scope = nullptr;
+  ir::arena::current = nullptr;
+  src.bind_scalars();
   return src;
 }
 
-/** Creates kernel source */
-string_class source::get_code() const {
-  // TODO(progtx): Caching?
+void source::add_statement(ir::statement_t type, const string_class& text,
+                           const ir::expr* first, const ir::expr* second,
+                           bool auto_end) {
+  auto& a = *scope->nodes;
+  scope->lines.push_back({type, auto_end, scope->depth, a.copy(text),
+                          first ? first->get_node(a) : nullptr,
+                          second ? second->get_node(a) : nullptr});
+}
+
+void source::add_expression(const ir::expr& expression) {
+  add_statement(ir::statement_t::expression, "", &expression);
+}
+
+void source::add_assignment(const ir::expr& lhs, const char* op,
+                            const ir::expr& rhs) {
+  add_statement(ir::statement_t::assign, op, &lhs, &rhs);
+}
 
+void source::add_declaration(const string_class& type, const ir::expr& name) {
+  add_statement(ir::statement_t::declare, type, &name);
+}
+
+void source::add_declaration(const string_class& type, const ir::expr& name,
+                             const ir::expr& init) {
+  add_statement(ir::statement_t::declare, type, &name, &init);
+}
+
+void source::add_control(const string_class& header,
+                         const ir::expr& condition) {
+  add_statement(ir::statement_t::control, header, &condition, nullptr, false);
+}
+
+void source::add_control(const string_class& header,
+                         const ir::expr& condition,
+                         const ir::expr& increment) {
+  add_statement(ir::statement_t::control, header, &condition, &increment,
+                false);
+}
+
+/** Creates kernel source, the statements are only rendered here */
+string_class source::get_code() const {
   static const char newline = '\n';
 
   string_class final_code = string_class("__kernel void ") + kernel_name + "(" +
                             generate_accessor_list() + ") {" + newline;
 
   for (auto& line : lines) {
-    final_code += line + newline;
+    ir::append(final_code, line);
+    final_code += newline;
   }
 
-  final_code = final_code + "}" + newline;
+  final_code += '}';
+  final_code += newline;
 
   return final_code;
 }
@@ -49,19 +100,49 @@ string_class source::get_kernel_name() const {
   return kernel_name;
 }
 
-string_class source::generate_accessor_list() const {
-  string_class list;
-  if (resources.empty()) {
-    return list;
+detail::ir::arena::stats source::get_ir_stats() const {
+  if (nodes == nullptr) {
+    return {0, 0};
+  }
+  return nodes->get_stats();
+}
+
+source::buf_info* source::find_resource(void* resource) {
+  for (auto& info : resources) {
+    if (info.resource == resource) {
+      return &info;
+    }
+  }
+  return nullptr;
+}
+
+void source::bind_scalars() {
+  scalars.clear();
+  if (!command::group_detail::in_scope()) {
+    return;
+  }
+  for (auto& s : command::group_detail::get_scalars()) {
+    if (!s.specialized) {
+      scalars.push_back(s);
+    }
   }
+}
 
+string_class source::generate_accessor_list() const {
+  string_class list;
   for (auto& acc : resources) {
-    list += get_name(acc.second.acc.target) + " ";
-    if (acc.second.acc.mode == access::mode::read) {
+    list += get_name(acc.acc.target) + " ";
+    if (acc.acc.mode == access::mode::read) {
       list += "const ";
     }
-    list += acc.second.type_name + " ";
-    list += acc.second.resource_name + ", ";
+    list += acc.type_name + " ";
+    list += acc.resource_name + ", ";
+  }
+  for (auto& s : scalars) {
+    list += s.type_name + " " + s.name + ", ";
+  }
+  if (list.empty()) {
+    return list;
   }
 
   // 2 to get rid of the last comma and space
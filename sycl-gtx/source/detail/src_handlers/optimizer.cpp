@@ -0,0 +1,1266 @@
+#include "SYCL/detail/src_handlers/optimizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+using namespace cl::sycl;
+using namespace detail::kernel_ns;
+
+mutex_class optimizer::mutex;
+bool optimizer::is_configured = false;
+unsigned int optimizer::default_passes = optimizer::none;
+std::map<::size_t, unsigned int> optimizer::kernel_passes;
+
+void optimizer::configure() {
+  if (is_configured) {
+    return;
+  }
+  is_configured = true;
+
+  auto value = std::getenv("SYCL_GTX_IR_PASSES");
+  if (value == nullptr) {
+    return;
+  }
+
+  std::stringstream list(value);
+  string_class name;
+  while (std::getline(list, name, ',')) {
+    if (name == "all") {
+      default_passes = all;
+    } else if (name == "none" || name == "0") {
+      default_passes = none;
+    } else if (name == "fold") {
+      default_passes |= constant_folding;
+    } else if (name == "copy") {
+      default_passes |= copy_propagation;
+    } else if (name == "cse") {
+      default_passes |= common_subexpressions;
+    } else if (name == "dce") {
+      default_passes |= dead_code;
+    }
+  }
+}
+
+void optimizer::set_default_passes(unsigned int passes) {
+  std::lock_guard<mutex_class> lock(mutex);
+  is_configured = true;
+  default_passes = passes;
+}
+
+void optimizer::set_passes(::size_t kernel_name_id, unsigned int passes) {
+  std::lock_guard<mutex_class> lock(mutex);
+  kernel_passes[kernel_name_id] = passes;
+}
+
+unsigned int optimizer::get_passes(::size_t kernel_name_id) {
+  std::lock_guard<mutex_class> lock(mutex);
+  configure();
+  auto it = kernel_passes.find(kernel_name_id);
+  if (it == kernel_passes.end()) {
+    return default_passes;
+  }
+  return it->second;
+}
+
+namespace {
+
+using detail::counter_t;
+using detail::ir::node;
+using detail::ir::node_t;
+using detail::ir::statement;
+using detail::ir::statement_t;
+using name_set = std::set<string_class>;
+using type_map = std::map<string_class, string_class>;
+
+static const unsigned int max_rounds = 8;
+
+bool is_name_start(char c) {
+  return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool is_name_char(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+bool is_name(const string_class& text) {
+  return !text.empty() && is_name_start(text[0]) &&
+         std::all_of(text.begin(), text.end(), is_name_char);
+}
+
+/** Identifiers in generated code, skipping literals and member names */
+void scan_names(const string_class& text, name_set& names) {
+  ::size_t i = 0;
+  while (i < text.size()) {
+    auto start = i;
+    if (is_name_start(text[i])) {
+      while (i < text.size() && is_name_char(text[i])) {
+        ++i;
+      }
+      if (start == 0 || text[start - 1] != '.') {
+        names.insert(text.substr(start, i - start));
+      }
+    } else if (std::isdigit(static_cast<unsigned char>(text[i]))) {
+      while (i < text.size() && (is_name_char(text[i]) || text[i] == '.')) {
+        ++i;
+      }
+    } else {
+      ++i;
+    }
+  }
+}
+
+enum class literal_t { none, integer, floating };
+
+struct literal {
+  literal_t type = literal_t::none;
+  long long integer = 0;
+  float floating = 0;
+};
+
+/** Only literals as generated by get_string: 12, -3, 1.f, 0.25f, 1e+10f */
+literal parse_literal(const string_class& text) {
+  literal lit;
+  auto body = text;
+  if (!body.empty() && body[0] == '-') {
+    body.erase(0, 1);
+  }
+  if (body.empty() || !std::isdigit(static_cast<unsigned char>(body[0]))) {
+    return lit;
+  }
+
+  if (body.find_first_not_of("0123456789") == string_class::npos) {
+    // Leading zeros would make it octal
+    if (body.size() > 10 || (body.size() > 1 && body[0] == '0')) {
+      return lit;
+    }
+    auto value = std::strtoll(text.c_str(), nullptr, 10);
+    if (value >= INT_MIN && value <= INT_MAX) {
+      lit.type = literal_t::integer;
+      lit.integer = value;
+    }
+    return lit;
+  }
+
+  if (body.back() != 'f' ||
+      body.find_first_not_of("0123456789.e+-") != body.size() - 1 ||
+      body.find_first_of(".e") == string_class::npos) {
+    return lit;
+  }
+  auto number = text.substr(0, text.size() - 1);
+  char* end = nullptr;
+  auto value = std::strtof(number.c_str(), &end);
+  if (end == number.c_str() + number.size() && std::isfinite(value)) {
+    lit.type = literal_t::floating;
+    lit.floating = value;
+  }
+  return lit;
+}
+
+/** Shortest text that reads back as the same float, suffixed as get_string */
+string_class float_literal(float value) {
+  string_class str;
+  for (int precision = 6; precision <= 9; ++precision) {
+    std::stringstream s;
+    s << std::setprecision(precision) << value;
+    str = s.str();
+    if (std::strtof(str.c_str(), nullptr) == value) {
+      break;
+    }
+  }
+  if (str.find('e') == string_class::npos &&
+      str.find('.') == string_class::npos) {
+    str += ".f";
+  } else {
+    str += 'f';
+  }
+  return str;
+}
+
+bool is_pure_call(const string_class& name) {
+  static const name_set pure = {
+      "get_global_id", "get_local_id", "get_global_size", "get_local_size",
+      "get_group_id",  "get_num_groups", "sqrt",          "cos",
+      "sin",           "tan",          "fabs",            "pow",
+      "min",           "max",          "fmin",            "fmax",
+      "exp",           "log",          "floor",           "ceil",
+      "dot",           "cross",        "length",          "normalize",
+      "&",             "*",
+  };
+  // Vector literals, as in (float3)(x, y, z)
+  return (!name.empty() && name.front() == '(' && name.back() == ')') ||
+         pure.count(name) > 0;
+}
+
+bool is_boundary(const statement& s) {
+  return s.type == statement_t::text || s.type == statement_t::control;
+}
+
+/** Only the condition of an if is evaluated once, where it stands */
+bool is_if(const statement& s) {
+  return s.type == statement_t::control && std::strcmp(s.text, "if(") == 0;
+}
+
+struct split_type {
+  string_class element;
+  int size = 0;
+};
+
+split_type split(const string_class& type) {
+  static const name_set scalars = {"char",  "uchar", "short", "ushort",
+                                   "int",   "uint",  "long",  "ulong",
+                                   "float", "double"};
+  split_type result;
+  auto digits = type.find_first_of("0123456789");
+  auto element = type.substr(0, digits);
+  if (scalars.count(element) == 0) {
+    return result;
+  }
+  int size = 1;
+  if (digits != string_class::npos) {
+    size = std::atoi(type.c_str() + digits);
+    if (size != 2 && size != 3 && size != 4 && size != 8 && size != 16) {
+      return result;
+    }
+  }
+  result.element = element;
+  result.size = size;
+  return result;
+}
+
+string_class join(const string_class& element, int size) {
+  if (size == 1) {
+    return element;
+  }
+  if (size != 2 && size != 3 && size != 4 && size != 8 && size != 16) {
+    return "";
+  }
+  return element + detail::get_string<int>::get(size);
+}
+
+/** Types that are not promoted when combined with an int literal */
+bool is_arithmetic_element(const string_class& element) {
+  return element == "int" || element == "uint" || element == "long" ||
+         element == "ulong" || element == "float" || element == "double";
+}
+
+/** Statements of one kernel together with what is known about its names */
+class kernel_ir {
+ public:
+  kernel_ir(detail::ir::arena& nodes, vector_class<statement>& lines,
+            counter_t& num_variables, type_map resources)
+      : nodes(nodes),
+        lines(lines),
+        num_variables(num_variables),
+        resources(std::move(resources)) {}
+
+  bool fold();
+  bool propagate_copies();
+  bool eliminate_common_subexpressions();
+  bool eliminate_dead_code();
+
+ private:
+  detail::ir::arena& nodes;
+  vector_class<statement>& lines;
+  counter_t& num_variables;
+  // Element type of each kernel parameter
+  type_map resources;
+  // Declared type of each variable
+  type_map types;
+  // Variables that could be changed without an assignment to them
+  name_set escaped;
+  std::unordered_map<const node*, string_class> texts;
+  std::unordered_map<const node*, const node*> folded;
+
+  struct occurrences {
+    string_class type;
+    const node* expression;
+    name_set names;
+    bool memory;
+    // Variable already holding the value
+    string_class holder;
+    // Statements containing the expression, the first one computes it
+    vector_class<::size_t> lines;
+    unsigned int count;
+  };
+  using available_map = std::map<string_class, occurrences>;
+
+  void analyze();
+  void find_escaped(const node* n);
+
+  const string_class& text(const node* n);
+  void names(const node* n, name_set& found);
+  void all_names(const statement& s, name_set& found);
+  void read_names(const statement& s, name_set& found);
+  bool is_variable(const string_class& name) const;
+  string_class type_of(const node* n);
+  bool is_pure(const node* n);
+  bool is_pure(const statement& s);
+  bool reads_memory(const node* n);
+
+  string_class target(const statement& s);
+  bool is_full_definition(const statement& s);
+  bool is_copy(const string_class& name, const node* value);
+  std::map<string_class, const node*> invariant_copies();
+
+  const node* leaf(const string_class& name);
+  const node* rebuild(const node* n, const node* first, const node* second);
+  const node* fold(const node* n);
+  const node* fold_binary(const node* n, const node* a, const node* b);
+  const node* substitute(const node* n,
+                         const std::map<string_class, const node*>& values);
+
+  void collect(const node* n, ::size_t line, available_map& available);
+  bool is_candidate(const node* n);
+  bool remove_unused();
+  bool remove_dead_stores();
+};
+
+void kernel_ir::analyze() {
+  types.clear();
+  escaped.clear();
+  for (auto& s : lines) {
+    if (s.type == statement_t::declare) {
+      string_class type(s.text);
+      if (type.compare(0, 6, "const ") == 0) {
+        type.erase(0, 6);
+      }
+      types[text(s.first)] = type;
+    }
+  }
+  for (auto& s : lines) {
+    if (s.type == statement_t::text) {
+      scan_names(s.text, escaped);
+    }
+    if (s.first != nullptr) {
+      find_escaped(s.first);
+    }
+    if (s.second != nullptr) {
+      find_escaped(s.second);
+    }
+  }
+}
+
+void kernel_ir::find_escaped(const node* n) {
+  if (n->type == node_t::leaf) {
+    auto& name = text(n);
+    if (!is_name(name) && parse_literal(name).type == literal_t::none) {
+      // Flattened expression, its names cannot be rewritten
+      scan_names(name, escaped);
+    }
+    return;
+  }
+  if (n->type == node_t::call && std::strcmp(n->text, "&") == 0) {
+    names(n, escaped);
+  }
+  if (n->first != nullptr) {
+    find_escaped(n->first);
+  }
+  if (n->second != nullptr) {
+    find_escaped(n->second);
+  }
+}
+
+const string_class& kernel_ir::text(const node* n) {
+  auto it = texts.find(n);
+  if (it != texts.end()) {
+    return it->second;
+  }
+  auto& code = texts[n];
+  detail::ir::append(code, n);
+  return code;
+}
+
+void kernel_ir::names(const node* n, name_set& found) {
+  scan_names(text(n), found);
+}
+
+void kernel_ir::all_names(const statement& s, name_set& found) {
+  if (s.type == statement_t::text) {
+    scan_names(s.text, found);
+  }
+  if (s.first != nullptr) {
+    names(s.first, found);
+  }
+  if (s.second != nullptr) {
+    names(s.second, found);
+  }
+}
+
+/** Names whose value the statement depends on, including partial writes */
+void kernel_ir::read_names(const statement& s, name_set& found) {
+  if (s.type == statement_t::declare) {
+    if (s.second != nullptr) {
+      names(s.second, found);
+    }
+  } else if (s.type == statement_t::assign && is_full_definition(s)) {
+    names(s.second, found);
+  } else {
+    all_names(s, found);
+  }
+}
+
+bool kernel_ir::is_variable(const string_class& name) const {
+  return types.count(name) > 0 && escaped.count(name) == 0;
+}
+
+string_class kernel_ir::type_of(const node* n) {
+  switch (n->type) {
+    case node_t::leaf: {
+      auto& name = text(n);
+      auto it = types.find(name);
+      if (it != types.end()) {
+        return it->second;
+      }
+      auto lit = parse_literal(name);
+      if (lit.type == literal_t::integer) {
+        return "int";
+      }
+      if (lit.type == literal_t::floating) {
+        return "float";
+      }
+      return "";
+    }
+    case node_t::binary:
+    case node_t::infix: {
+      auto a = type_of(n->first);
+      auto b = type_of(n->second);
+      if (a.empty() || b.empty()) {
+        return "";
+      }
+      static const name_set comparisons = {"<",  ">",  "<=", ">=",
+                                           "==", "!=", "&&", "||"};
+      if (comparisons.count(n->text) > 0) {
+        return (split(a).size == 1 && split(b).size == 1) ? "int" : "";
+      }
+      if (a == b) {
+        return a;
+      }
+      static const name_set arithmetic = {"+", "-", "*", "/", "%"};
+      if (arithmetic.count(n->text) == 0) {
+        return "";
+      }
+      auto is_int_literal = [this](const node* operand) {
+        return operand->type == node_t::leaf &&
+               parse_literal(text(operand)).type == literal_t::integer;
+      };
+      if (is_int_literal(n->first) && is_arithmetic_element(split(b).element)) {
+        return b;
+      }
+      if (is_int_literal(n->second) &&
+          is_arithmetic_element(split(a).element)) {
+        return a;
+      }
+      return "";
+    }
+    case node_t::prefix: {
+      auto a = type_of(n->first);
+      if (std::strcmp(n->text, "!") == 0) {
+        return split(a).size == 1 ? "int" : "";
+      }
+      return a;
+    }
+    case node_t::call: {
+      string_class name(n->text);
+      if (name.size() > 2 && name.front() == '(' && name.back() == ')') {
+        return name.substr(1, name.size() - 2);
+      }
+      if (n->first == nullptr) {
+        return "";
+      }
+      auto a = type_of(n->first->first);
+      static const name_set same_as_argument = {
+          "sqrt", "cos", "sin", "tan", "fabs", "exp",
+          "log",  "floor", "ceil", "normalize"};
+      if (same_as_argument.count(name) > 0) {
+        return split(a).element == "float" ? a : "";
+      }
+      static const name_set same_as_arguments = {"pow", "min", "max",
+                                                 "fmin", "fmax"};
+      if (same_as_arguments.count(name) > 0 && n->first->second != nullptr &&
+          n->first->second->second == nullptr &&
+          type_of(n->first->second->first) == a) {
+        return a;
+      }
+      return "";
+    }
+    case node_t::member: {
+      auto vec = split(type_of(n->first));
+      string_class member(n->text);
+      if (vec.size < 2 || member.size() < 2 || member[0] != '.') {
+        return "";
+      }
+      member.erase(0, 1);
+      int size = 0;
+      if (member == "lo" || member == "hi" || member == "even" ||
+          member == "odd") {
+        size = (vec.size + 1) / 2;
+      } else if (member[0] == 's' || member[0] == 'S') {
+        size = static_cast<int>(member.size()) - 1;
+        if (member.find_first_not_of("0123456789abcdefABCDEF", 1) !=
+            string_class::npos) {
+          return "";
+        }
+      } else if (member.find_first_not_of("xyzw") == string_class::npos) {
+        size = static_cast<int>(member.size());
+      }
+      if (size < 1) {
+        return "";
+      }
+      return join(vec.element, size);
+    }
+    case node_t::subscript: {
+      if (n->first->type != node_t::leaf) {
+        return "";
+      }
+      auto it = resources.find(text(n->first));
+      return it == resources.end() ? "" : it->second;
+    }
+    case node_t::postfix:
+    case node_t::argument:
+    default:
+      return "";
+  }
+}
+
+bool kernel_ir::is_pure(const node* n) {
+  switch (n->type) {
+    case node_t::leaf:
+      return true;
+    case node_t::prefix:
+    case node_t::postfix:
+      if (std::strcmp(n->text, "++") == 0 || std::strcmp(n->text, "--") == 0) {
+        return false;
+      }
+      break;
+    case node_t::call:
+      if (!is_pure_call(n->text)) {
+        return false;
+      }
+      break;
+    default:
+      break;
+  }
+  return (n->first == nullptr || is_pure(n->first)) &&
+         (n->second == nullptr || is_pure(n->second));
+}
+
+bool kernel_ir::is_pure(const statement& s) {
+  switch (s.type) {
+    case statement_t::declare:
+      return s.second == nullptr || is_pure(s.second);
+    case statement_t::assign:
+      return is_pure(s.first) && is_pure(s.second);
+    case statement_t::expression:
+      return is_pure(s.first);
+    case statement_t::text:
+    case statement_t::control:
+    default:
+      return false;
+  }
+}
+
+bool kernel_ir::reads_memory(const node* n) {
+  if (n->type == node_t::subscript ||
+      (n->type == node_t::call && std::strcmp(n->text, "*") == 0)) {
+    return true;
+  }
+  return (n->first != nullptr && reads_memory(n->first)) ||
+         (n->second != nullptr && reads_memory(n->second));
+}
+
+/** Variable written by a declaration or assignment, empty for stores */
+string_class kernel_ir::target(const statement& s) {
+  if (s.type == statement_t::declare) {
+    return text(s.first);
+  }
+  if (s.type != statement_t::assign) {
+    return "";
+  }
+  auto n = s.first;
+  while (n->type == node_t::member) {
+    n = n->first;
+  }
+  if (n->type == node_t::leaf && types.count(text(n)) > 0) {
+    return text(n);
+  }
+  return "";
+}
+
+bool kernel_ir::is_full_definition(const statement& s) {
+  if (s.type == statement_t::declare) {
+    return true;
+  }
+  return s.type == statement_t::assign && std::strcmp(s.text, "=") == 0 &&
+         s.first->type == node_t::leaf && types.count(text(s.first)) > 0;
+}
+
+const node* kernel_ir::leaf(const string_class& name) {
+  return nodes.make(node_t::leaf, nodes.copy(name));
+}
+
+const node* kernel_ir::rebuild(const node* n, const node* first,
+                               const node* second) {
+  if (first == n->first && second == n->second) {
+    return n;
+  }
+  return nodes.make(n->type, n->text, first, second);
+}
+
+const node* kernel_ir::fold(const node* n) {
+  if (n == nullptr || n->type == node_t::leaf) {
+    return n;
+  }
+  auto it = folded.find(n);
+  if (it != folded.end()) {
+    return it->second;
+  }
+
+  const node* result;
+  if (n->type == node_t::infix) {
+    // The text of nested infix nodes is not parenthesized,
+    // so only self-contained operands are folded
+    auto a = n->first->type == node_t::infix ? n->first : fold(n->first);
+    auto b = n->second->type == node_t::infix ? n->second : fold(n->second);
+    result = rebuild(n, a, b);
+  } else if (n->type == node_t::binary) {
+    result = fold_binary(n, fold(n->first), fold(n->second));
+  } else if (n->type == node_t::prefix && std::strcmp(n->text, "-") == 0) {
+    auto a = fold(n->first);
+    auto lit = a->type == node_t::leaf ? parse_literal(text(a)) : literal();
+    if (lit.type == literal_t::integer && lit.integer != INT_MIN) {
+      result = leaf(detail::get_string<long long>::get(-lit.integer));
+    } else if (lit.type == literal_t::floating) {
+      result = leaf(float_literal(-lit.floating));
+    } else {
+      result = rebuild(n, a, nullptr);
+    }
+  } else {
+    result = rebuild(n, fold(n->first), fold(n->second));
+  }
+
+  folded[n] = result;
+  return result;
+}
+
+const node* kernel_ir::fold_binary(const node* n, const node* a,
+                                   const node* b) {
+  auto x = a->type == node_t::leaf ? parse_literal(text(a)) : literal();
+  auto y = b->type == node_t::leaf ? parse_literal(text(b)) : literal();
+  char op = (std::strlen(n->text) == 1) ? n->text[0] : 0;
+
+  if (x.type == literal_t::integer && y.type == literal_t::integer) {
+    long long value;
+    switch (op) {
+      case '+':
+        value = x.integer + y.integer;
+        break;
+      case '-':
+        value = x.integer - y.integer;
+        break;
+      case '*':
+        value = x.integer * y.integer;
+        break;
+      case '/':
+      case '%':
+        if (y.integer == 0) {
+          return rebuild(n, a, b);
+        }
+        value = (op == '/') ? x.integer / y.integer : x.integer % y.integer;
+        break;
+      default:
+        return rebuild(n, a, b);
+    }
+    if (value >= INT_MIN && value <= INT_MAX) {
+      return leaf(detail::get_string<long long>::get(value));
+    }
+    return rebuild(n, a, b);
+  }
+
+  // Integers are only exact as floats up to 2^24
+  static const long long exact = 1 << 24;
+  auto as_float = [](const literal& lit, float& value) {
+    if (lit.type == literal_t::floating) {
+      value = lit.floating;
+      return true;
+    }
+    if (lit.type == literal_t::integer && std::llabs(lit.integer) <= exact) {
+      value = static_cast<float>(lit.integer);
+      return true;
+    }
+    return false;
+  };
+  float fx, fy;
+  if ((x.type == literal_t::floating || y.type == literal_t::floating) &&
+      as_float(x, fx) && as_float(y, fy)) {
+    float value;
+    switch (op) {
+      case '+':
+        value = fx + fy;
+        break;
+      case '-':
+        value = fx - fy;
+        break;
+      case '*':
+        value = fx * fy;
+        break;
+      case '/':
+        if (fy == 0) {
+          return rebuild(n, a, b);
+        }
+        value = fx / fy;
+        break;
+      default:
+        return rebuild(n, a, b);
+    }
+    if (std::isfinite(value)) {
+      return leaf(float_literal(value));
+    }
+    return rebuild(n, a, b);
+  }
+
+  // x * 1, 1 * x, x / 1 and x - 0 keep the type of x,
+  // as long as an int literal does not promote it
+  auto is_identity = [&](const literal& lit, const node* other, int value) {
+    if (other->type == node_t::infix) {
+      return false;
+    }
+    auto element = split(type_of(other)).element;
+    if (lit.type == literal_t::integer) {
+      return lit.integer == value && is_arithmetic_element(element);
+    }
+    return lit.type == literal_t::floating && lit.floating == value &&
+           element == "float";
+  };
+  if ((op == '*' || op == '/') && is_identity(y, a, 1)) {
+    return a;
+  }
+  if (op == '*' && is_identity(x, b, 1)) {
+    return b;
+  }
+  if (op == '-' && is_identity(y, a, 0) && !std::signbit(y.floating)) {
+    return a;
+  }
+  return rebuild(n, a, b);
+}
+
+bool kernel_ir::fold() {
+  analyze();
+  bool changed = false;
+  for (auto& s : lines) {
+    auto first = (s.type == statement_t::declare) ? s.first : fold(s.first);
+    auto second = fold(s.second);
+    if (first != s.first || second != s.second) {
+      s.first = first;
+      s.second = second;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+const node* kernel_ir::substitute(
+    const node* n, const std::map<string_class, const node*>& values) {
+  if (n == nullptr || values.empty()) {
+    return n;
+  }
+  if (n->type == node_t::leaf) {
+    auto it = values.find(text(n));
+    return it == values.end() ? n : it->second;
+  }
+  auto first = substitute(n->first, values);
+  // (--1) would be a decrement
+  if (n->type == node_t::prefix && first->type == node_t::leaf &&
+      text(first)[0] == '-') {
+    first = n->first;
+  }
+  return rebuild(n, first, substitute(n->second, values));
+}
+
+bool kernel_ir::is_copy(const string_class& name, const node* value) {
+  if (value == nullptr || value->type != node_t::leaf || !is_variable(name)) {
+    return false;
+  }
+  auto& value_text = text(value);
+  if (types.count(value_text) > 0) {
+    return is_variable(value_text) && value_text != name &&
+           types[value_text] == types[name];
+  }
+  return parse_literal(value_text).type != literal_t::none &&
+         type_of(value) == types[name];
+}
+
+/**
+ * Copies that hold everywhere after their declaration,
+ * because neither side is ever assigned again.
+ * Uses can only follow the declaration, even across blocks.
+ */
+std::map<string_class, const node*> kernel_ir::invariant_copies() {
+  name_set written;
+  std::map<string_class, const node*> initial;
+  for (auto& s : lines) {
+    if (s.type == statement_t::declare) {
+      auto name = text(s.first);
+      if (initial.count(name) > 0 || s.second == nullptr) {
+        written.insert(name);
+      }
+      initial[name] = s.second;
+    } else if (s.type == statement_t::assign) {
+      auto name = target(s);
+      if (!name.empty()) {
+        written.insert(name);
+      } else if (s.first->type != node_t::subscript || !is_pure(s.first)) {
+        names(s.first, written);
+      }
+      if (!is_pure(s.second)) {
+        names(s.second, written);
+      }
+    } else if (s.type == statement_t::control) {
+      // Loop increment, the condition is only read when pure
+      if (s.second != nullptr) {
+        names(s.second, written);
+      }
+      if (s.first != nullptr && !is_pure(s.first)) {
+        names(s.first, written);
+      }
+    } else if (s.type == statement_t::expression || !is_pure(s)) {
+      all_names(s, written);
+    }
+  }
+
+  std::map<string_class, const node*> copies;
+  for (auto& definition : initial) {
+    auto& name = definition.first;
+    auto value = definition.second;
+    if (written.count(name) > 0 || !is_copy(name, value)) {
+      continue;
+    }
+    auto& value_text = text(value);
+    if (types.count(value_text) == 0 || written.count(value_text) == 0) {
+      copies[name] = value;
+    }
+  }
+  return copies;
+}
+
+bool kernel_ir::propagate_copies() {
+  analyze();
+  bool changed = false;
+  // Copies holding across blocks
+  auto invariant = invariant_copies();
+  // Variables known to hold the value of another variable or a literal
+  auto copies = invariant;
+
+  auto forget = [&copies, this](const name_set& changed_names) {
+    for (auto it = copies.begin(); it != copies.end();) {
+      if (changed_names.count(it->first) > 0 ||
+          changed_names.count(text(it->second)) > 0) {
+        it = copies.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  };
+
+  for (auto& s : lines) {
+    if (is_boundary(s)) {
+      if (is_if(s) && is_pure(s.first)) {
+        auto condition = substitute(s.first, copies);
+        changed |= (condition != s.first);
+        s.first = condition;
+      }
+      copies = invariant;
+      continue;
+    }
+    if (s.type == statement_t::expression || !is_pure(s)) {
+      name_set changed_names;
+      all_names(s, changed_names);
+      forget(changed_names);
+      continue;
+    }
+
+    auto name = target(s);
+    if (s.second != nullptr) {
+      auto value = substitute(s.second, copies);
+      changed |= (value != s.second);
+      s.second = value;
+    }
+    if (s.type == statement_t::assign && name.empty()) {
+      auto store = substitute(s.first, copies);
+      changed |= (store != s.first);
+      s.first = store;
+    }
+    if (name.empty()) {
+      continue;
+    }
+
+    forget({name});
+    if (is_full_definition(s) && is_copy(name, s.second)) {
+      copies[name] = s.second;
+    }
+  }
+  return changed;
+}
+
+bool kernel_ir::is_candidate(const node* n) {
+  switch (n->type) {
+    case node_t::binary:
+    case node_t::prefix:
+    case node_t::call:
+    case node_t::subscript:
+      break;
+    case node_t::member:
+      // Reading a vector element of a variable costs nothing
+      if (n->first->type == node_t::leaf) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+  if (!is_pure(n) || !is_name(type_of(n))) {
+    return false;
+  }
+  name_set used;
+  names(n, used);
+  for (auto& name : used) {
+    if (escaped.count(name) > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void kernel_ir::collect(const node* n, ::size_t line,
+                        available_map& available) {
+  if (n == nullptr || n->type == node_t::leaf) {
+    return;
+  }
+  if (is_candidate(n)) {
+    auto& key = text(n);
+    auto it = available.find(key);
+    if (it == available.end()) {
+      occurrences o;
+      o.type = type_of(n);
+      o.expression = n;
+      names(n, o.names);
+      o.memory = reads_memory(n);
+      o.count = 0;
+      it = available.insert({key, std::move(o)}).first;
+    }
+    auto& o = it->second;
+    ++o.count;
+    if (o.lines.empty() || o.lines.back() != line) {
+      o.lines.push_back(line);
+    }
+  }
+  collect(n->first, line, available);
+  collect(n->second, line, available);
+}
+
+bool kernel_ir::eliminate_common_subexpressions() {
+  bool changed = false;
+
+  for (unsigned int round = 0; round < max_rounds; ++round) {
+    analyze();
+    available_map available;
+    vector_class<std::pair<string_class, occurrences>> finished;
+
+    auto retire = [&](const name_set& changed_names, bool memory) {
+      for (auto it = available.begin(); it != available.end();) {
+        auto& o = it->second;
+        bool stale = (memory && o.memory) ||
+                     (!o.holder.empty() && changed_names.count(o.holder) > 0);
+        for (auto& name : o.names) {
+          stale = stale || changed_names.count(name) > 0;
+        }
+        if (stale) {
+          finished.emplace_back(it->first, std::move(o));
+          it = available.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    };
+    auto retire_all = [&]() {
+      for (auto& entry : available) {
+        finished.emplace_back(entry.first, std::move(entry.second));
+      }
+      available.clear();
+    };
+
+    for (::size_t i = 0; i < lines.size(); ++i) {
+      auto& s = lines[i];
+      if (is_boundary(s)) {
+        if (is_if(s) && is_pure(s.first)) {
+          collect(s.first, i, available);
+        }
+        retire_all();
+        continue;
+      }
+      if (s.type == statement_t::expression || !is_pure(s)) {
+        name_set changed_names;
+        all_names(s, changed_names);
+        retire(changed_names, true);
+        continue;
+      }
+
+      collect(s.second, i, available);
+      auto name = target(s);
+      if (name.empty()) {
+        retire({}, s.type == statement_t::assign);
+      } else {
+        retire({name}, false);
+      }
+
+      // The assigned variable can hold the value for the following statements
+      if (s.second != nullptr && is_full_definition(s) && is_variable(name)) {
+        auto it = available.find(text(s.second));
+        if (it != available.end() && it->second.count == 1 &&
+            it->second.type == types[name] &&
+            it->second.names.count(name) == 0) {
+          it->second.holder = name;
+        }
+      }
+    }
+    retire_all();
+
+    // Largest expressions first, the ones inside them wait for the next round
+    vector_class<std::pair<string_class, occurrences>*> selected;
+    vector_class<std::pair<string_class, occurrences>*> candidates;
+    for (auto& entry : finished) {
+      if (entry.second.count > 1) {
+        candidates.push_back(&entry);
+      }
+    }
+    std::stable_sort(
+        candidates.begin(), candidates.end(),
+        [](const std::pair<string_class, occurrences>* a,
+           const std::pair<string_class, occurrences>* b) {
+          return a->first.size() > b->first.size();
+        });
+    for (auto c : candidates) {
+      bool overlaps = false;
+      for (auto s : selected) {
+        overlaps = overlaps ||
+                   (s->first.find(c->first) != string_class::npos &&
+                    c->second.lines.front() <= s->second.lines.back() &&
+                    s->second.lines.front() <= c->second.lines.back());
+      }
+      if (!overlaps) {
+        selected.push_back(c);
+      }
+    }
+    if (selected.empty()) {
+      break;
+    }
+
+    std::map<::size_t, std::map<string_class, const node*>> replacements;
+    std::map<::size_t, vector_class<statement>> declarations;
+    for (auto c : selected) {
+      auto& o = c->second;
+      auto first = o.lines.front();
+      auto name = o.holder;
+      if (name.empty()) {
+        name = '_' + o.type + '_' + detail::get_string<counter_t>::get(
+                                        num_variables++);
+        declarations[first].push_back({statement_t::declare, true,
+                                       lines[first].depth,
+                                       nodes.copy(o.type), leaf(name),
+                                       o.expression});
+      }
+      auto value = leaf(name);
+      for (auto line : o.lines) {
+        if (line != first || o.holder.empty()) {
+          replacements[line][c->first] = value;
+        }
+      }
+    }
+
+    // Replaces whole subexpressions by their key
+    std::function<const node*(const node*,
+                              const std::map<string_class, const node*>&)>
+        replace = [&](const node* n,
+                      const std::map<string_class, const node*>& values)
+        -> const node* {
+      if (n == nullptr || n->type == node_t::leaf) {
+        return n;
+      }
+      auto it = values.find(text(n));
+      if (it != values.end()) {
+        return it->second;
+      }
+      return rebuild(n, replace(n->first, values), replace(n->second, values));
+    };
+    for (auto& r : replacements) {
+      auto& s = lines[r.first];
+      if (is_if(s)) {
+        s.first = replace(s.first, r.second);
+      } else {
+        s.second = replace(s.second, r.second);
+      }
+    }
+
+    vector_class<statement> result;
+    result.reserve(lines.size() + declarations.size());
+    for (::size_t i = 0; i < lines.size(); ++i) {
+      auto it = declarations.find(i);
+      if (it != declarations.end()) {
+        result.insert(result.end(), it->second.begin(), it->second.end());
+      }
+      result.push_back(lines[i]);
+    }
+    lines.swap(result);
+    changed = true;
+  }
+  return changed;
+}
+
+/** Declarations and writes of variables that are never read */
+bool kernel_ir::remove_unused() {
+  bool changed = false;
+  for (;;) {
+    analyze();
+    name_set used;
+    name_set kept;
+    for (auto& s : lines) {
+      auto name = target(s);
+      if (name.empty()) {
+        all_names(s, used);
+        continue;
+      }
+      if (s.second != nullptr) {
+        names(s.second, used);
+      }
+      if (!is_pure(s)) {
+        kept.insert(name);
+      }
+    }
+
+    vector_class<statement> result;
+    result.reserve(lines.size());
+    for (auto& s : lines) {
+      auto name = target(s);
+      bool unused = !name.empty() && is_variable(name) &&
+                    used.count(name) == 0 && kept.count(name) == 0;
+      bool no_effect = s.type == statement_t::expression && is_pure(s.first);
+      if (!unused && !no_effect) {
+        result.push_back(s);
+      }
+    }
+    if (result.size() == lines.size()) {
+      return changed;
+    }
+    lines.swap(result);
+    changed = true;
+  }
+}
+
+/** Writes overwritten in the same straight-line code before being read */
+bool kernel_ir::remove_dead_stores() {
+  analyze();
+  vector_class<bool> dead(lines.size(), false);
+  bool changed = false;
+
+  for (::size_t i = 0; i < lines.size(); ++i) {
+    auto& s = lines[i];
+    if (!is_full_definition(s) || s.second == nullptr || !is_pure(s)) {
+      continue;
+    }
+    auto name = target(s);
+    if (!is_variable(name)) {
+      continue;
+    }
+    for (auto j = i + 1; j < lines.size() && !is_boundary(lines[j]); ++j) {
+      auto& next = lines[j];
+      name_set read;
+      read_names(next, read);
+      if (read.count(name) > 0) {
+        break;
+      }
+      if (is_full_definition(next) && target(next) == name) {
+        changed = true;
+        if (s.type == statement_t::declare) {
+          s.second = nullptr;
+        } else {
+          dead[i] = true;
+        }
+        break;
+      }
+    }
+  }
+
+  if (changed) {
+    vector_class<statement> result;
+    result.reserve(lines.size());
+    for (::size_t i = 0; i < lines.size(); ++i) {
+      if (!dead[i]) {
+        result.push_back(lines[i]);
+      }
+    }
+    lines.swap(result);
+  }
+  return changed;
+}
+
+bool kernel_ir::eliminate_dead_code() {
+  bool changed = remove_dead_stores();
+  changed |= remove_unused();
+  return changed;
+}
+
+}  // namespace
+
+void optimizer::run(source& src, ::size_t kernel_name_id) {
+  run_passes(src, get_passes(kernel_name_id));
+}
+
+void optimizer::run_passes(source& src, unsigned int passes) {
+  if (passes == none || src.nodes == nullptr) {
+    return;
+  }
+
+  type_map resources;
+  for (auto& info : src.resources) {
+    auto type = info.type_name;
+    if (!type.empty() && type.back() == '*') {
+      type.pop_back();
+    }
+    resources[info.resource_name] = type;
+  }
+  kernel_ir kernel(*src.nodes, src.lines, src.num_variables,
+                   std::move(resources));
+
+  auto simplify = [&kernel, passes]() {
+    for (unsigned int round = 0; round < max_rounds; ++round) {
+      bool changed = false;
+      if (passes & copy_propagation) {
+        changed |= kernel.propagate_copies();
+      }
+      if (passes & constant_folding) {
+        changed |= kernel.fold();
+      }
+      if (passes & dead_code) {
+        changed |= kernel.eliminate_dead_code();
+      }
+      if (!changed) {
+        break;
+      }
+    }
+  };
+
+  simplify();
+  if (passes & common_subexpressions) {
+    if (kernel.eliminate_common_subexpressions()) {
+      simplify();
+    }
+  }
+}
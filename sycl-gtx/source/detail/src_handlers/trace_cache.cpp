@@ -0,0 +1,151 @@
+#include "SYCL/detail/src_handlers/trace_cache.h"
+
+#include "SYCL/buffer_base.h"
+#include "SYCL/command_group.h"
+#include "SYCL/detail/debug.h"
+#include "SYCL/error_handler.h"
+#include <cstdlib>
+
+using namespace cl::sycl;
+using namespace detail::kernel_ns;
+
+mutex_class trace_cache::mutex;
+bool trace_cache::is_configured = false;
+bool trace_cache::enabled = false;
+std::map<::size_t, trace_cache::entry> trace_cache::entries;
+
+bool trace_cache::accessor_info::operator==(
+    const accessor_info& other) const {
+  return mode == other.mode && target == other.target && shape == other.shape;
+}
+
+vector_class<trace_cache::accessor_info> trace_cache::describe(
+    const vector_class<buffer_access>& accessors) {
+  vector_class<accessor_info> infos;
+  infos.reserve(accessors.size());
+  for (auto& acc : accessors) {
+    infos.push_back({acc.mode, acc.target,
+                     acc.data == nullptr ? vector_class<::size_t>()
+                                         : acc.data->get_shape()});
+  }
+  return infos;
+}
+
+vector_class<detail::command::scalar> trace_cache::describe(
+    const vector_class<detail::command::scalar>& scalars) {
+  auto infos = scalars;
+  for (auto& s : infos) {
+    if (!s.specialized) {
+      s.value.clear();
+    }
+  }
+  return infos;
+}
+
+void trace_cache::set_enabled(bool enable) {
+  std::lock_guard<mutex_class> lock(mutex);
+  is_configured = true;
+  enabled = enable;
+  if (!enabled) {
+    entries.clear();
+  }
+}
+
+bool trace_cache::is_enabled() {
+  std::lock_guard<mutex_class> lock(mutex);
+  if (!is_configured) {
+    is_configured = true;
+    auto value = std::getenv("SYCL_GTX_TRACE_ONCE");
+    enabled = (value != nullptr && string_class(value) != "0");
+  }
+  return enabled;
+}
+
+bool trace_cache::find(::size_t kernel_name_id, source& src) {
+  if (!is_enabled() || !command::group_detail::in_scope()) {
+    return false;
+  }
+
+  // Buffer ranges are part of the traced source
+  auto accessors = command::group_detail::get_accessors();
+
+  std::lock_guard<mutex_class> lock(mutex);
+  auto it = entries.find(kernel_name_id);
+  if (it == entries.end()) {
+    return false;
+  }
+  auto& e = it->second;
+  if (describe(accessors) != e.accessors ||
+      describe(command::group_detail::get_scalars()) != e.scalars) {
+    return false;
+  }
+
+  src = e.src;
+  for (::size_t i = 0; i < src.resources.size(); ++i) {
+    auto& res = src.resources[i];
+    res.acc = accessors[e.resource_slots[i]];
+    res.resource = res.acc.data;
+  }
+  src.bind_scalars();
+  return true;
+}
+
+void trace_cache::add(::size_t kernel_name_id, const source& src) {
+  if (!is_enabled() || !command::group_detail::in_scope()) {
+    return;
+  }
+
+  auto accessors = command::group_detail::get_accessors();
+  entry e;
+  e.accessors = describe(accessors);
+  e.scalars = describe(command::group_detail::get_scalars());
+
+  for (auto& res : src.resources) {
+    // Kernels with local accessors are not memoized,
+    // they cannot be matched to the accessors of the command group
+    if (res.acc.target == access::target::local) {
+      return;
+    }
+
+    ::size_t slot = 0;
+    for (; slot < accessors.size(); ++slot) {
+      auto& acc = accessors[slot];
+      if (acc.data == res.acc.data && acc.mode == res.acc.mode &&
+          acc.target == res.acc.target) {
+        break;
+      }
+    }
+    if (slot == accessors.size()) {
+      return;
+    }
+    e.resource_slots.push_back(slot);
+  }
+
+  e.src = src;
+  std::lock_guard<mutex_class> lock(mutex);
+  entries[kernel_name_id] = std::move(e);
+}
+
+void trace_cache::verify(const source& cached, const source& traced) {
+  bool same = (cached.get_code() == traced.get_code() &&
+               cached.resources.size() == traced.resources.size());
+  for (::size_t i = 0; same && i < cached.resources.size(); ++i) {
+    auto& first = cached.resources[i];
+    auto& second = traced.resources[i];
+    same = (first.acc.data == second.acc.data &&
+            first.acc.mode == second.acc.mode &&
+            first.acc.target == second.acc.target &&
+            first.size == second.size);
+  }
+
+  if (!same) {
+    debug() << "Kernel" << traced.get_kernel_name()
+            << "changed since it was first traced";
+    detail::error::report(detail::error::code::TRACED_KERNEL_CHANGED);
+  }
+}
+
+void trace_cache::clear() {
+  std::lock_guard<mutex_class> lock(mutex);
+  entries.clear();
+}
@@ -7,46 +7,186 @@
 using namespace cl::sycl;
 using namespace detail;
 
+mutex_class synchronizer::queues_mutex;
 std::set<queue*> synchronizer::queues;
+std::map<queue*, ::size_t> synchronizer::pinned;
+std::condition_variable synchronizer::unpinned;
+mutex_class synchronizer::host_accessors_mutex;
 std::map<accessor_base*, buffer_base*> synchronizer::host_accessors;
+std::unordered_map<buffer_base*, ::size_t> synchronizer::host_accessed;
+mutex_class synchronizer::users_mutex;
+std::unordered_map<buffer_base*, std::set<queue*>> synchronizer::users;
 
-void synchronizer::wait_on_queues(buffer_base* buf) {
-  for (auto&& q : queues) {
-    if (q->buffers_in_use.count(buf) > 0) {
-      q->wait();
+vector_class<queue*> synchronizer::get_users(buffer_base* buf) {
+  std::lock_guard<mutex_class> lock(users_mutex);
+  auto it = users.find(buf);
+  if (it == users.end()) {
+    return {};
+  }
+  return vector_class<queue*>(it->second.begin(), it->second.end());
+}
+
+vector_class<queue*> synchronizer::pin_users(buffer_base* buf) {
+  std::lock_guard<mutex_class> lock(queues_mutex);
+  vector_class<queue*> queues_in_use;
+  for (auto q : get_users(buf)) {
+    // Already being destroyed
+    if (queues.count(q) == 0) {
+      continue;
     }
+    ++pinned[q];
+    queues_in_use.push_back(q);
   }
+  return queues_in_use;
 }
 
-void synchronizer::flush_queues(buffer_base* buf) {
-  for (auto&& q : queues) {
-    if (q->buffers_in_use.count(buf) > 0) {
-      q->flush();
+void synchronizer::unpin(const vector_class<queue*>& queues_in_use) {
+  std::lock_guard<mutex_class> lock(queues_mutex);
+  bool released = false;
+  for (auto q : queues_in_use) {
+    auto it = pinned.find(q);
+    if (--it->second == 0) {
+      pinned.erase(it);
+      released = true;
     }
   }
+  if (released) {
+    unpinned.notify_all();
+  }
+}
+
+template <class F>
+void synchronizer::for_each_user(buffer_base* buf, F f) {
+  // Also unpinned when flushing throws
+  struct pin_guard {
+    vector_class<queue*> queues_in_use;
+    ~pin_guard() {
+      unpin(queues_in_use);
+    }
+  } guard = {pin_users(buf)};
+
+  // The queues mutex is not held while blocking on a queue,
+  // host tasks running meanwhile can create and destroy queues
+  for (auto q : guard.queues_in_use) {
+    std::lock_guard<queue::mutex_t> queue_lock(q->mutex.value);
+    f(q);
+  }
+}
+
+void synchronizer::wait_on_queues(buffer_base* buf) {
+  for_each_user(buf, [](queue* q) { q->wait(); });
+}
+
+void synchronizer::flush_queues(buffer_base* buf) {
+  for_each_user(buf, [](queue* q) { q->flush(); });
 }
 
 void synchronizer::add(queue* q) {
+  std::lock_guard<mutex_class> lock(queues_mutex);
   queues.insert(q);
 }
 
 void synchronizer::remove(queue* q) {
+  std::unique_lock<mutex_class> lock(queues_mutex);
   queues.erase(q);
+  // Host accessors flushing or waiting on the queue are done with it first
+  unpinned.wait(lock, [q] { return pinned.count(q) == 0; });
+
+  std::lock_guard<mutex_class> users_lock(users_mutex);
+  auto it = users.begin();
+  while (it != users.end()) {
+    it->second.erase(q);
+    if (it->second.empty()) {
+      it = users.erase(it);
+    } else {
+      ++it;
+    }
+  }
 }
 
-void synchronizer::add(accessor_base* acc, buffer_base* buf) {
+void synchronizer::add(accessor_base* acc, buffer_base* buf,
+                       access::mode mode) {
   DSELF() << acc << buf;
-  host_accessors.emplace(acc, buf);
+  // A sub-buffer uses the data of its parent
+  auto parent = buf->parent;
+  // Before the buffer is blocked for them
+  flush_deferred(buf);
+  if (parent != nullptr) {
+    flush_deferred(parent);
+  }
+  {
+    std::lock_guard<mutex_class> lock(host_accessors_mutex);
+    if (host_accessors.emplace(acc, buf).second) {
+      ++host_accessed[buf];
+      if (parent != nullptr) {
+        ++host_accessed[parent];
+      }
+    }
+  }
   wait_on_queues(buf);
+  if (parent != nullptr) {
+    wait_on_queues(parent);
+  }
+  buf->use_on_host(mode);
 }
 
 void synchronizer::remove(accessor_base* acc, buffer_base* buf) {
-  host_accessors.erase(acc);
+  auto parent = buf->parent;
+  bool last = false;
+  {
+    std::lock_guard<mutex_class> lock(host_accessors_mutex);
+    auto it = host_accessors.find(acc);
+    if (it != host_accessors.end()) {
+      auto release = [](buffer_base* b) {
+        auto count = host_accessed.find(b);
+        if (--count->second > 0) {
+          return false;
+        }
+        host_accessed.erase(count);
+        return true;
+      };
+      last = release(buf);
+      if (parent != nullptr) {
+        release(parent);
+      }
+      host_accessors.erase(it);
+    }
+  }
+  if (last && buf->host_written) {
+    // Before the command groups blocked on the host accessor use the parent
+    buf->write_to_parent(parent->device_queue.get(), true, {});
+  }
   flush_queues(buf);
+  if (parent != nullptr) {
+    flush_queues(parent);
+  }
+}
+
+void synchronizer::use(queue* q, const std::set<buffer_base*>& buffers) {
+  std::lock_guard<mutex_class> lock(users_mutex);
+  for (auto buf : buffers) {
+    users[buf].insert(q);
+  }
+}
+
+void synchronizer::release(queue* q,
+                           const vector_class<buffer_base*>& buffers) {
+  std::lock_guard<mutex_class> lock(users_mutex);
+  for (auto buf : buffers) {
+    auto it = users.find(buf);
+    if (it == users.end()) {
+      continue;
+    }
+    it->second.erase(q);
+    if (it->second.empty()) {
+      users.erase(it);
+    }
+  }
 }
 
 bool synchronizer::can_flush(
     const std::set<detail::buffer_base*>& buffers_in_use) {
+  std::lock_guard<mutex_class> lock(host_accessors_mutex);
   {
     auto d = DSELF();
     d << "buffers_in_use";
@@ -54,17 +194,19 @@ bool synchronizer::can_flush(
       d << buf;
     }
   }
-  {
-    auto d = DSELF();
-    d << "host_accessors";
-    for (auto&& acc : host_accessors) {
-      d << "{" << acc.first << acc.second << "}";
-    }
-  }
-  for (auto&& acc : host_accessors) {
-    if (buffers_in_use.count(acc.second) > 0) {
+  for (auto buf : buffers_in_use) {
+    if (host_accessed.count(buf) > 0) {
+      DSELF() << "host accessor to" << buf;
       return false;
     }
   }
   return true;
 }
+
+void synchronizer::flush_deferred(buffer_base* buf) {
+  for_each_user(buf, [](queue* q) {
+    q->flush();
+    // The caller is about to block on the results
+    q->flush_commands();
+  });
+}
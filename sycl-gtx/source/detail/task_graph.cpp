@@ -0,0 +1,152 @@
+#include "SYCL/detail/task_graph.h"
+
+#include <algorithm>
+
+using namespace cl::sycl;
+using namespace detail;
+
+bool task_graph::node::is_complete() const {
+  return is_flushed &&
+         (completion.get() == nullptr || completion.is_complete());
+}
+
+void task_graph::add_edge(node& to, const node_ptr& from, hazard type) {
+  if (from == nullptr || from->id == to.id) {
+    return;
+  }
+  for (auto& e : to.predecessors) {
+    if (e.from_id == from->id) {
+      return;
+    }
+  }
+  to.predecessors.push_back({from->id, type, from});
+  to.depth = std::max(to.depth, from->depth + 1);
+}
+
+task_graph::node_ptr task_graph::add(const std::set<buffer_base*>& reads,
+                                     const std::set<buffer_base*>& writes) {
+  node_ptr n(new node{totals.nodes, 1, reads.size(), writes.size(), {}, false,
+                      event(), {}});
+
+  for (auto buf : reads) {
+    add_edge(*n, buffers[buf].last_writer, hazard::raw);
+  }
+  for (auto buf : writes) {
+    auto& state = buffers[buf];
+    add_edge(*n, state.last_writer, hazard::waw);
+    for (auto& reader : state.readers) {
+      add_edge(*n, reader, hazard::war);
+    }
+  }
+
+  for (auto buf : reads) {
+    if (writes.count(buf) == 0) {
+      buffers[buf].readers.push_back(n);
+    }
+  }
+  for (auto buf : writes) {
+    auto& state = buffers[buf];
+    state.last_writer = n;
+    state.readers.clear();
+  }
+
+  ++totals.nodes;
+  totals.edges += n->predecessors.size();
+  totals.critical_path = std::max(totals.critical_path, n->depth);
+
+  history.push_back(n);
+  active.push_back(n);
+  if (history.size() > max_history) {
+    history.pop_front();
+  }
+  return n;
+}
+
+bool task_graph::get_wait_events(const node& n,
+                                 vector_class<cl_event>& events) {
+  for (auto& e : n.predecessors) {
+    if (e.from == nullptr) {
+      continue;
+    }
+    if (!e.from->is_flushed) {
+      return false;
+    }
+    auto ev = e.from->completion.get();
+    if (ev != nullptr) {
+      events.push_back(ev);
+    }
+  }
+  return true;
+}
+
+void task_graph::set_flushed(node& n, event completion,
+                             vector_class<event> commands) {
+  n.completion = std::move(completion);
+  n.commands = std::move(commands);
+  n.is_flushed = true;
+  for (auto& e : n.predecessors) {
+    e.from = nullptr;
+  }
+}
+
+vector_class<buffer_base*> task_graph::retire() {
+  vector_class<node_ptr> running;
+  for (auto& n : active) {
+    if (n->is_complete()) {
+      n->completion = event();
+      n->commands.clear();
+    } else {
+      running.push_back(n);
+    }
+  }
+  active = std::move(running);
+
+  vector_class<buffer_base*> retired;
+  auto it = buffers.begin();
+  while (it != buffers.end()) {
+    auto& state = it->second;
+    bool complete =
+        (state.last_writer == nullptr || state.last_writer->is_complete());
+    for (auto& reader : state.readers) {
+      complete = complete && reader->is_complete();
+    }
+    if (complete) {
+      retired.push_back(it->first);
+      it = buffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return retired;
+}
+
+task_graph::stats task_graph::get_stats() const {
+  return totals;
+}
+
+static const char* get_name(task_graph::hazard type) {
+  switch (type) {
+    case task_graph::hazard::raw:
+      return "RAW";
+    case task_graph::hazard::war:
+      return "WAR";
+    case task_graph::hazard::waw:
+    default:
+      return "WAW";
+  }
+}
+
+void task_graph::dump(std::ostream& os) const {
+  os << "digraph task_graph {\n";
+  for (auto& n : history) {
+    os << "  cg" << n->id << " [label=\"" << n->id << "\\nr" << n->num_reads
+       << " w" << n->num_writes << "\"];\n";
+  }
+  for (auto& n : history) {
+    for (auto& e : n->predecessors) {
+      os << "  cg" << e.from_id << " -> cg" << n->id << " [label=\""
+         << get_name(e.type) << "\"];\n";
+    }
+  }
+  os << "}\n";
+}
@@ -2,9 +2,36 @@
 
 using namespace cl::sycl;
 
+namespace {
+
+void CL_API_CALL call_back(cl_event, ::cl_int status, void* data) {
+  using callback_t = function_class<void(::cl_int)>;
+  unique_ptr_class<callback_t> callback(static_cast<callback_t*>(data));
+  try {
+    (*callback)(status);
+  } catch (...) {
+    // Cannot be thrown into the driver
+    debug::warning(__func__) << "callback threw an exception";
+  }
+}
+
+}  // namespace
+
+function_class<void(::cl_int)> detail::fulfil(
+    shared_ptr_class<std::promise<void>> promise) {
+  return [promise](::cl_int status) {
+    if (status < 0) {
+      auto e = error::thrower::get(status, nullptr);
+      promise->set_exception(std::make_exception_ptr(*e));
+    } else {
+      promise->set_value();
+    }
+  };
+}
+
 event::event(cl_event clEvent) : evnt(clEvent) {}
 
-cl_event event::get() {
+cl_event event::get() const {
   return evnt.get();
 }
 
@@ -36,6 +63,32 @@ void event::wait(const vector_class<event>& event_list) {
   detail::error::report(error_code);
 }
 
+bool event::is_complete() const {
+  return get_info<info::event::command_execution_status>() <= CL_COMPLETE;
+}
+
+void event::then(function_class<void(::cl_int)> callback) const {
+  if (evnt.get() == nullptr) {
+    callback(CL_COMPLETE);
+    return;
+  }
+
+  auto data = new function_class<void(::cl_int)>(std::move(callback));
+  auto error_code =
+      clSetEventCallback(evnt.get(), CL_COMPLETE, &call_back, data);
+  if (error_code != CL_SUCCESS) {
+    delete data;
+  }
+  detail::error::report(error_code);
+}
+
+std::future<void> event::get_future() const {
+  auto promise = std::make_shared<std::promise<void>>();
+  auto result = promise->get_future();
+  then(detail::fulfil(promise));
+  return result;
+}
+
 void event::wait_and_throw() {
   wait();
   // TODO(progtx):
@@ -1,6 +1,8 @@
 #include "SYCL/handler.h"
 
 #include "SYCL/context.h"
+#include "SYCL/detail/host_task.h"
+#include "SYCL/detail/src_handlers/kernel_fusion.h"
 #include "SYCL/queue.h"
 
 using namespace cl::sycl;
@@ -9,3 +11,38 @@ using namespace detail;
 context handler::get_context(queue* q) {
   return q->get_context();
 }
+
+void handler::host_task(function_class<void()> task) {
+  detail::host_task::add(std::move(task));
+}
+
+shared_ptr_class<kernel> handler::fuse(shared_ptr_class<kernel> kern,
+                                       ::size_t kernel_name_id,
+                                       range<1> num_work_items, id<1> offset) {
+  using kernel_ns::fusion;
+  using group = command::group_detail;
+  ::size_t size = num_work_items.size();
+  if (!fusion::is_enabled() || static_cast<::size_t&>(offset[0]) != 0 ||
+      !kern->arguments.empty() || group::has_kernel()) {
+    return kern;
+  }
+
+  auto producer = group::get_fusible_producer();
+  if (producer.kern != nullptr &&
+      producer.num_work_items == size &&
+      fusion::can_fuse(producer.kern->src, kern->src)) {
+    auto fused_id =
+        fusion::get_kernel_name_id(producer.kernel_name_id, kernel_name_id);
+    auto fused = shared_ptr_class<kernel>(new kernel(true));
+    fused->src = fusion::fuse(producer.kern->src, kern->src, fused_id);
+    program prog(get_context(q));
+    prog.compile("", fused_id, fused);
+    prog.link_async();
+    group::take_over_kernel();
+    kern = fused;
+    kernel_name_id = fused_id;
+  }
+
+  group::set_fusible({kern, kernel_name_id, size});
+  return kern;
+}
@@ -1,6 +1,9 @@
 #include "SYCL/program.h"
 
+#include "SYCL/detail/binary_cache.h"
+#include "SYCL/detail/build_mode.h"
 #include "SYCL/detail/debug.h"
+#include "SYCL/detail/program_cache.h"
 #include "SYCL/kernel.h"
 #include "SYCL/queue.h"
 
@@ -22,28 +25,53 @@ program::program(const context& context, cl_program clProgram)
 void program::compile(string_class compile_options, ::size_t kernel_name_id,
                       shared_ptr_class<kernel> kern) {
   kernels.emplace(kernel_name_id, kern);
-  auto& src = kern->src;
-  auto code = src.get_code();
+  auto code = kern->src.get_code();
+
+  using detail::program_cache;
+  auto device_pointers = detail::get_cl_array(devices);
+  kern->cache_entry = program_cache::find(ctx.get(), kernel_name_id, code,
+                                          device_pointers, compile_options);
+  if (kern->cache_entry == nullptr) {
+    // Added right away, so that a build in progress can be found
+    kern->cache_entry =
+        program_cache::add(ctx.get(), kernel_name_id, code, device_pointers,
+                           compile_options, nullptr);
+  } else {
+    auto& e = *kern->cache_entry;
+    std::unique_lock<mutex_class> lock(e.mutex);
+    if (!e.is_building() && e.compiled.get() != nullptr) {
+      auto compiled = e.compiled.get();
+      lock.unlock();
+      kern->set(ctx, compiled);
+      return;
+    }
+  }
+
+  // Deferred until link, which might find a built binary on disk instead
+  pending.push_back({kern, std::move(code), std::move(compile_options)});
+}
+
+void program::compile(pending_compile& p) {
+  auto& kern = p.kern;
 
   debug() << "Compiled kernel:";
-  debug() << code;
+  debug() << p.code;
 
-  const char* code_p = code.c_str();
-  ::size_t length = code.size();
+  auto device_pointers = detail::get_cl_array(devices);
+  const char* code_p = p.code.c_str();
+  ::size_t length = p.code.size();
   ::cl_int error_code;
 
-  auto p =
+  auto source_prog =
       clCreateProgramWithSource(ctx.get(), 1, &code_p, &length, &error_code);
   detail::error::report(error_code);
-  kern->set(ctx, p);
+  kern->set(ctx, source_prog);
   kern->prog->prog.release_one();
 
-  auto device_pointers = detail::get_cl_array(devices);
-
   error_code = clCompileProgram(kern->prog.get()->get(),
                                 static_cast<::cl_uint>(devices.size()),
-                                device_pointers.data(), compile_options.c_str(),
-                                0, nullptr, nullptr, nullptr, nullptr);
+                                device_pointers.data(), p.options.c_str(), 0,
+                                nullptr, nullptr, nullptr, nullptr);
 
   try {
     detail::error::report(error_code);
@@ -51,27 +79,29 @@ void program::compile(string_class compile_options, ::size_t kernel_name_id,
     debug() << "Error while compiling kernel" << kern->src.get_kernel_name()
             << "->";
     for (auto& d : devices) {
-      report_compile_error(kern, d);
+      report_compile_error(kern->prog->get(), d);
     }
     throw e;
   }
+
+  std::lock_guard<mutex_class> lock(kern->cache_entry->mutex);
+  kern->cache_entry->compiled = kern->prog->get();
 }
 
-void program::report_compile_error(shared_ptr_class<kernel> kern,
-                                   device& dev) const {
+void program::report_compile_error(cl_program failed, device& dev) const {
   // http://stackoverflow.com/a/9467325/793006
 
   // Determine the size of the log
   ::size_t log_size;
-  clGetProgramBuildInfo(kern->prog.get()->get(), dev.get(),
-                        CL_PROGRAM_BUILD_LOG, 0, nullptr, &log_size);
+  clGetProgramBuildInfo(failed, dev.get(), CL_PROGRAM_BUILD_LOG, 0, nullptr,
+                        &log_size);
 
   // Allocate memory for the log
   auto log = new char[log_size];
 
   // Get the log
-  clGetProgramBuildInfo(kern->prog.get()->get(), dev.get(),
-                        CL_PROGRAM_BUILD_LOG, log_size, log, nullptr);
+  clGetProgramBuildInfo(failed, dev.get(), CL_PROGRAM_BUILD_LOG, log_size, log,
+                        nullptr);
 
   debug() << "\tWhile compiling for device"
           << dev.get_info<info::device::name>() << "->\n"
@@ -98,12 +128,250 @@ vector_class<cl_program> program::get_program_pointers() const {
   return program_pointers;
 }
 
+bool program::build_from_binaries(const string_class& descriptor,
+                                  const string_class& linking_options) {
+  using detail::binary_cache;
+  binary_cache::binaries_t binaries;
+  if (!binary_cache::load(descriptor, binaries) ||
+      binaries.size() != devices.size()) {
+    return false;
+  }
+
+  vector_class<::size_t> lengths;
+  vector_class<const unsigned char*> binary_pointers;
+  for (auto& binary : binaries) {
+    lengths.push_back(binary.size());
+    binary_pointers.push_back(binary.data());
+  }
+
+  auto device_pointers = detail::get_cl_array(devices);
+  ::cl_int error_code;
+  decltype(prog) built = clCreateProgramWithBinary(
+      ctx.get(), static_cast<::cl_uint>(device_pointers.size()),
+      device_pointers.data(), lengths.data(), binary_pointers.data(), nullptr,
+      &error_code);
+  if (error_code != CL_SUCCESS) {
+    // Stale or corrupt binary, rebuild from source
+    return false;
+  }
+  built.release_one();
+
+  error_code = clBuildProgram(built.get(),
+                              static_cast<::cl_uint>(device_pointers.size()),
+                              device_pointers.data(), linking_options.c_str(),
+                              nullptr, nullptr);
+  if (error_code != CL_SUCCESS) {
+    return false;
+  }
+
+  prog = std::move(built);
+  init_built_program(linking_options);
+  return true;
+}
+
+bool program::can_build_from_source() const {
+  if (pending.size() != kernels.size()) {
+    return false;
+  }
+  for (auto& p : pending) {
+    if (p.options != pending.front().options) {
+      return false;
+    }
+  }
+  return !pending.empty();
+}
+
+string_class program::get_pending_code() const {
+  string_class code;
+  for (auto& p : pending) {
+    code += p.code;
+  }
+  return code;
+}
+
+void program::build_batched(const string_class& linking_options) {
+  auto code = get_pending_code();
+
+  debug() << "Compiled kernels:";
+  debug() << code;
+
+  const char* code_p = code.c_str();
+  ::size_t length = code.size();
+  ::cl_int error_code;
+
+  decltype(prog) built =
+      clCreateProgramWithSource(ctx.get(), 1, &code_p, &length, &error_code);
+  detail::error::report(error_code);
+  built.release_one();
+
+  // Build options take both compile and link options
+  auto options = pending.front().options + ' ' + linking_options;
+  auto device_pointers = detail::get_cl_array(devices);
+  error_code = clBuildProgram(built.get(),
+                              static_cast<::cl_uint>(device_pointers.size()),
+                              device_pointers.data(), options.c_str(), nullptr,
+                              nullptr);
+
+  try {
+    detail::error::report(error_code);
+  } catch (::cl::sycl::exception& e) {
+    debug() << "Error while building kernels ->";
+    for (auto& d : devices) {
+      report_compile_error(built.get(), d);
+    }
+    throw e;
+  }
+
+  prog = std::move(built);
+  init_built_program(linking_options);
+}
+
+void program::init_built_program(const string_class& linking_options) {
+  init_kernels();
+
+  for (auto& p : pending) {
+    p.kern->set(ctx, prog.get());
+  }
+  pending.clear();
+
+  if (kernels.size() == 1) {
+    auto& kern = kernels.begin()->second;
+    std::lock_guard<mutex_class> lock(kern->cache_entry->mutex);
+    kern->cache_entry->link_options = linking_options;
+    kern->cache_entry->linked = prog.get();
+    kern->cache_entry->kern = kern->get();
+  }
+}
+
 void program::link(string_class linking_options) {
   if (linked) {
     // TODO(progtx): Error?
     return;
   }
 
+  // Another submission might be building the same kernels
+  for (auto& kern : kernels) {
+    auto& cache_entry = kern.second->cache_entry;
+    if (cache_entry == nullptr) {
+      continue;
+    }
+    std::unique_lock<mutex_class> lock(cache_entry->mutex);
+    auto built = cache_entry->built;
+    lock.unlock();
+    if (built.valid()) {
+      built.wait();
+    }
+  }
+  link_programs(linking_options);
+}
+
+void program::link_async(string_class linking_options) {
+  using detail::compile_pool;
+  if (linked) {
+    return;
+  }
+  if (pending.empty() || !compile_pool::is_enabled()) {
+    link(linking_options);
+    return;
+  }
+
+  // Configured here, before compile threads read them
+  detail::binary_cache::is_enabled();
+  detail::build_mode::get();
+
+  // Earlier builds of the same kernels are finished first and then reused
+  vector_class<compile_pool::future_t> previous;
+  for (auto& kern : kernels) {
+    auto& cache_entry = kern.second->cache_entry;
+    std::lock_guard<mutex_class> lock(cache_entry->mutex);
+    if (cache_entry->built.valid()) {
+      previous.push_back(cache_entry->built);
+    }
+  }
+
+  program copy(*this);
+  auto task = [copy, previous, linking_options]() mutable {
+    for (auto& p : previous) {
+      p.wait();
+    }
+    copy.link_programs(linking_options);
+  };
+  auto built = compile_pool::submit(task);
+
+  for (auto& kern : kernels) {
+    kern.second->built = built;
+    auto& cache_entry = kern.second->cache_entry;
+    std::lock_guard<mutex_class> lock(cache_entry->mutex);
+    if (!cache_entry->is_building()) {
+      cache_entry->built = built;
+    }
+  }
+  linked = true;
+}
+
+void program::link_programs(const string_class& linking_options) {
+
+  // A program with a single cached kernel can reuse the linked kernel
+  shared_ptr_class<detail::program_cache::entry> cache_entry;
+  if (kernels.size() == 1) {
+    cache_entry = kernels.begin()->second->cache_entry;
+  }
+  std::unique_lock<mutex_class> lock;
+  if (cache_entry != nullptr) {
+    lock = std::unique_lock<mutex_class>(cache_entry->mutex);
+  }
+  if (cache_entry != nullptr && cache_entry->linked.get() != nullptr &&
+      cache_entry->link_options == linking_options) {
+    prog = cache_entry->linked.get();
+    auto& kern = kernels.begin()->second;
+    kern->set(cache_entry->kern.get());
+    if (cache_entry->compiled.get() == nullptr) {
+      kern->set(ctx, prog.get());
+    }
+    pending.clear();
+    linked = true;
+    return;
+  }
+  if (lock.owns_lock()) {
+    lock.unlock();
+  }
+
+  using detail::build_mode;
+  auto batched = build_mode::get() == build_mode::batched &&
+                 can_build_from_source();
+
+  // Otherwise a program built from source can be loaded from the on-disk cache
+  string_class descriptor;
+  if ((batched || (kernels.size() == 1 && pending.size() == 1)) &&
+      detail::binary_cache::is_enabled()) {
+    descriptor = detail::binary_cache::describe(
+        get_pending_code(), devices,
+        pending.front().options + '\n' + linking_options);
+    if (build_from_binaries(descriptor, linking_options)) {
+      linked = true;
+      return;
+    }
+  }
+
+  if (batched) {
+    build_batched(linking_options);
+    if (!descriptor.empty()) {
+      detail::binary_cache::store(
+          descriptor, detail::binary_cache::get_binaries(prog.get(),
+                                                         devices.size()));
+    }
+    linked = true;
+    return;
+  }
+
+  for (auto& p : pending) {
+    compile(p);
+  }
+  pending.clear();
+  if (kernels.size() == 1) {
+    cache_entry = kernels.begin()->second->cache_entry;
+  }
+
   auto device_pointers = detail::get_cl_array(devices);
   auto program_pointers = get_program_pointers();
   ::cl_int error_code;
@@ -115,8 +383,23 @@ void program::link(string_class linking_options) {
                     program_pointers.data(), nullptr, nullptr, &error_code);
   detail::error::report(error_code);
 
+  prog.release_one();
+
   // Can only initialize after program successfully built
   init_kernels();
 
+  if (cache_entry != nullptr) {
+    std::lock_guard<mutex_class> entry_lock(cache_entry->mutex);
+    cache_entry->link_options = linking_options;
+    cache_entry->linked = prog.get();
+    cache_entry->kern = kernels.begin()->second->get();
+  }
+
+  if (!descriptor.empty()) {
+    detail::binary_cache::store(
+        descriptor, detail::binary_cache::get_binaries(prog.get(),
+                                                       devices.size()));
+  }
+
   linked = true;
 }
@@ -1,9 +1,25 @@
 #include "SYCL/queue.h"
 
 #include "SYCL/buffer_base.h"
+#include <algorithm>
+#include <thread>
 
 using namespace cl::sycl;
 
+void detail::async_errors::add(exception_ptr thrown,
+                               string_class description) {
+  std::lock_guard<mutex_class> lock(mutex);
+  list.list.push_back(
+      async_exception(std::move(thrown), std::move(description)));
+}
+
+exception_list detail::async_errors::take() {
+  std::lock_guard<mutex_class> lock(mutex);
+  exception_list taken;
+  std::swap(taken.list, list.list);
+  return taken;
+}
+
 void queue::display_device_info() const {
   debug printLine;
   debug() << "Queue device information:";
@@ -17,15 +33,23 @@ void queue::display_device_info() const {
 
 cl_command_queue queue::create_queue(bool display_info,
                                      bool register_with_synchronizer,
-                                     info::queue_profiling enable_profiling) {
+                                     info::queue_profiling enable_profiling,
+                                     info::queue_out_of_order out_of_order) {
   if (display_info) {
     display_device_info();
   }
 
+  cl_command_queue_properties properties = 0;
+  if (enable_profiling) {
+    properties |= CL_QUEUE_PROFILING_ENABLE;
+  }
+  if (out_of_order) {
+    properties |= CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+  }
+
   ::cl_int error_code;
-  auto q = clCreateCommandQueue(
-      ctx.get(), dev.get(), (enable_profiling ? CL_QUEUE_PROFILING_ENABLE : 0),
-      &error_code);
+  auto q =
+      clCreateCommandQueue(ctx.get(), dev.get(), properties, &error_code);
   detail::error::report(error_code);
 
   if (register_with_synchronizer) {
@@ -35,6 +59,30 @@ cl_command_queue queue::create_queue(bool display_info,
   return q;
 }
 
+cl_command_queue queue::get_pooled_queue() {
+  if (command_q_pool.size() < command_q_pool_size) {
+    command_q_pool.emplace_back(
+        create_queue(false, false, enable_profiling, out_of_order));
+    command_q_pool.back().release_one();
+    return command_q_pool.back().get();
+  }
+
+  // Command groups only depend on each other through buffer events,
+  // so any pooled queue can take the next one
+  auto q = command_q_pool[next_pooled_q].get();
+  next_pooled_q = (next_pooled_q + 1) % command_q_pool.size();
+  return q;
+}
+
+bool queue::supports_out_of_order() const {
+  auto properties = dev.get_info<info::device::queue_properties>();
+  if ((properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) == 0) {
+    debug() << "Out-of-order execution not supported, using in-order queues";
+    return false;
+  }
+  return true;
+}
+
 queue::queue(const async_handler& asyncHandler)
     : ctx(asyncHandler),
       dev(ctx.get_devices()[0]),
@@ -73,10 +121,18 @@ queue::queue(const context& syclContext, const device& syclDevice,
 queue::queue(const context& syclContext, const device& syclDevice,
              info::queue_profiling profilingFlag,
              const async_handler& asyncHandler)
+    : queue(syclContext, syclDevice, profilingFlag, false, asyncHandler) {}
+
+queue::queue(const context& syclContext, const device& syclDevice,
+             info::queue_profiling profilingFlag,
+             info::queue_out_of_order outOfOrderFlag,
+             const async_handler& asyncHandler)
     : ctx(syclContext.get(), asyncHandler),
       dev(syclDevice),
-      command_q(create_queue(profilingFlag)),
-      command_group(this) {
+      command_group(this),
+      enable_profiling(profilingFlag) {
+  out_of_order = (outOfOrderFlag && supports_out_of_order());
+  command_q = create_queue(true, true, enable_profiling, out_of_order);
   command_q.release_one();
 }
 
@@ -104,8 +160,37 @@ queue::queue(cl_command_queue clQueue, const async_handler& asyncHandler)
 }
 
 queue::~queue() {
+  if (is_subqueue) {
+    // The OpenCL queue is shared with other command groups,
+    // only wait for the commands of this one
+    if (is_flushed && completion.get() != nullptr) {
+      completion.wait();
+    }
+    if (!is_flushed && pending != nullptr) {
+      pending->cancel();
+    }
+    return;
+  }
+  // Watchers still flush this queue once the kernels are built
+  for (auto& watcher : build_watchers) {
+    watcher.wait();
+  }
   detail::synchronizer::remove(this);
   wait_and_throw();
+
+  {
+    // Pending events no longer start this queue once detached from it
+    std::lock_guard<mutex_t> lock(mutex.value);
+    for (auto& q : subqueues) {
+      if (q.pending != nullptr) {
+        q.pending->cancel();
+      }
+    }
+  }
+  // The ones that were already starting still use it
+  while (mutex.starting > 0) {
+    std::this_thread::yield();
+  }
 }
 
 bool queue::is_host() {
@@ -131,84 +216,250 @@ device queue::get_device() const {
  * If no async_handler was provided then asynchronous exceptions will be lost.
  */
 void queue::throw_asynchronous() {
-  if (ex_list.size() > 0) {
-    detail::error::thrower::report_async(&ctx, ex_list);
+  std::lock_guard<mutex_t> lock(mutex.value);
+  if (errors == nullptr) {
+    // Moved from
+    return;
+  }
+  auto list = errors->take();
+  if (list.size() > 0) {
+    detail::error::thrower::report_async(&ctx, list);
+  }
+}
+
+void queue::set_flush_policy(const detail::flush_policy& policy) {
+  std::lock_guard<mutex_t> lock(mutex.value);
+  batch.set_policy(policy);
+}
+
+detail::flush_policy queue::get_flush_policy() const {
+  std::lock_guard<mutex_t> lock(mutex.value);
+  return batch.get_policy();
+}
+
+detail::flush_batch::stats queue::get_flush_stats() const {
+  std::lock_guard<mutex_t> lock(mutex.value);
+  return batch.get_stats();
+}
+
+void queue::begin_recording() {
+  std::lock_guard<mutex_t> lock(mutex.value);
+  recording.reset(new detail::command_graph());
+}
+
+detail::command_graph queue::end_recording() {
+  std::lock_guard<mutex_t> lock(mutex.value);
+  detail::command_graph recorded;
+  if (recording != nullptr) {
+    recorded = std::move(*recording);
+    recording.reset();
+  }
+  recorded.finish_recording();
+  return recorded;
+}
+
+void queue::replay(detail::command_graph& recorded) {
+  recorded.check_buffers();
+  std::lock_guard<mutex_t> lock(mutex.value);
+  // Earlier command groups are enqueued first, so that the graph can wait
+  flush();
+  auto replay_node = add_node(recorded.read_buffers, recorded.write_buffers);
+  vector_class<cl_event> wait_events;
+  detail::task_graph::get_wait_events(*replay_node, wait_events);
+
+  auto issued = recorded.replay(this, wait_events, !out_of_order);
+  auto transferred = recorded.get_bytes_transferred();
+
+  auto completed = enqueue_completion(issued, wait_events);
+  batch.add(command_q.get(), issued.size(), transferred);
+  detail::task_graph::set_flushed(*replay_node, completed, std::move(issued));
+  if (batch.is_due()) {
+    batch.flush();
   }
 }
 
 void queue::wait() {
+  std::lock_guard<mutex_t> lock(mutex.value);
+  flush();
+  flush_commands();
   finish();
   wait_subqueues(false);
+  retire_buffers();
 }
 
 void queue::wait_and_throw() {
+  std::lock_guard<mutex_t> lock(mutex.value);
+  flush();
+  flush_commands();
   finish();
   wait_subqueues(true);
+  retire_buffers();
   throw_asynchronous();
 }
 
-void queue::flush() {
+void queue::flush(bool wait_for_builds) {
   for (auto& q : subqueues) {
-    q.process(buffers_in_use);
+    if (!wait_for_builds && !q.is_flushed &&
+        (q.command_group.is_building() ||
+         q.command_group.fusible.kern != nullptr)) {
+      break;
+    }
+    q.process(batch);
+    if (batch.is_due()) {
+      batch.flush();
+    }
   }
 }
 
+vector_class<detail::compile_pool::future_t> queue::get_builds() const {
+  vector_class<detail::compile_pool::future_t> building;
+  for (auto& q : subqueues) {
+    if (!q.is_flushed && q.command_group.is_building()) {
+      building.insert(building.end(), q.command_group.builds.begin(),
+                      q.command_group.builds.end());
+    }
+  }
+  return building;
+}
+
+void queue::add_build_watcher(detail::compile_pool::future_t watcher) {
+  auto done = std::remove_if(build_watchers.begin(), build_watchers.end(),
+                             detail::compile_pool::is_done);
+  build_watchers.erase(done, build_watchers.end());
+  build_watchers.push_back(std::move(watcher));
+}
+
+void queue::flush_commands() {
+  batch.flush();
+}
+
 void queue::finish() {
   if (command_q.get() != nullptr) {
     auto error_code = clFinish(command_q.get());
     detail::error::report(error_code);
   }
+  for (auto& pooled_q : command_q_pool) {
+    auto error_code = clFinish(pooled_q.get());
+    detail::error::report(error_code);
+  }
 }
 
+/** Must be called after finish, which completes all flushed command groups */
 void queue::wait_subqueues(bool and_throw) {
-  for (auto& q : subqueues) {
-    if (and_throw) {
-      q.wait_and_throw();
+  auto it = subqueues.begin();
+  while (it != subqueues.end()) {
+    if (it->is_flushed) {
+      if (and_throw) {
+        it->throw_asynchronous();
+      }
+      it = subqueues.erase(it);
     } else {
-      q.wait();
+      ++it;
     }
   }
 }
 
-handler_event queue::process(buffer_set& buffers_in_use_master) {
-  if (is_flushed ||
-      !detail::synchronizer::can_flush(command_group.read_buffers) ||
-      !detail::synchronizer::can_flush(command_group.write_buffers)) {
-    // TODO(progtx):
-    return handler_event();
+bool queue::is_complete() const {
+  return is_flushed &&
+         (completion.get() == nullptr || completion.is_complete());
+}
+
+/**
+ * Retires sub-queues whose commands have completed.
+ * If there are still too many of them, waits on the oldest ones.
+ */
+void queue::retire_subqueues() {
+  subqueues.remove_if([](const queue& q) { return q.is_complete(); });
+  retire_buffers();
+
+  auto it = subqueues.begin();
+  if (subqueues.size() >= max_subqueues) {
+    flush_commands();
+  }
+  while (subqueues.size() >= max_subqueues && it != subqueues.end()) {
+    if (it->is_flushed) {
+      // Destructor waits for the commands to finish
+      it = subqueues.erase(it);
+    } else {
+      ++it;
+    }
   }
-  command_group.optimize();
-  command_group.flush(
-      get_wait_events(command_group.read_buffers, buffers_in_use_master));
-  buffers_in_use_master.insert(command_group.write_buffers.begin(),
-                               command_group.write_buffers.end());
-  is_flushed = true;
-  return handler_event();
 }
 
-vector_class<cl_event> queue::get_wait_events(const buffer_set& dependencies,
-                                              buffer_set& buffers_in_use) {
-  vector_class<cl_event> wait_events;
-  vector_class<decltype(buffers_in_use.begin())> remove_dependencies;
-
-  for (auto&& buf : dependencies) {
-    auto buf_it = buffers_in_use.find(buf);
-    if (buf_it != buffers_in_use.end()) {
-      auto size = buf->events.size();
-      if (size == 0) {
-        remove_dependencies.push_back(buf_it);
-      } else {
-        wait_events.reserve(wait_events.size() + size);
-        for (auto& ev : buf->events) {
-          wait_events.push_back(ev.get());
-        }
-      }
+detail::task_graph::node_ptr queue::add_node(const buffer_set& read_buffers,
+                                             const buffer_set& write_buffers) {
+  detail::synchronizer::use(this, read_buffers);
+  detail::synchronizer::use(this, write_buffers);
+  return graph.add(read_buffers, write_buffers);
+}
+
+void queue::adopt_subqueues() {
+  for (auto& q : subqueues) {
+    if (q.pending != nullptr) {
+      q.pending->set_master(this);
+    }
+  }
+}
+
+void queue::retire_buffers() {
+  detail::synchronizer::release(this, graph.retire());
+}
+
+detail::command_group* queue::get_fusion_producer() {
+  if (subqueues.empty()) {
+    return nullptr;
+  }
+  auto& last = subqueues.back();
+  if (last.is_flushed || last.command_group.fusible.kern == nullptr) {
+    return nullptr;
+  }
+  return &last.command_group;
+}
+
+event queue::enqueue_completion(const vector_class<event>& issued,
+                                const vector_class<cl_event>& wait_events) {
+  // Without a wait list, a marker on an out-of-order queue
+  // waits for everything enqueued before it, including other command groups
+  vector_class<cl_event> marker_events;
+  if (out_of_order) {
+    for (auto& e : issued) {
+      marker_events.push_back(e.get());
+    }
+    if (marker_events.empty()) {
+      marker_events = wait_events;
     }
   }
 
-  for (auto& buf_it : remove_dependencies) {
-    buffers_in_use.erase(buf_it);
+  cl_event marker;
+  auto error_code = clEnqueueMarkerWithWaitList(
+      command_q.get(), static_cast<::cl_uint>(marker_events.size()),
+      (marker_events.empty() ? nullptr : marker_events.data()), &marker);
+  detail::error::report(error_code);
+  event completed(marker);
+  error_code = clReleaseEvent(marker);
+  detail::error::report(error_code);
+  return completed;
+}
+
+handler_event queue::process(detail::flush_batch& batch_master) {
+  vector_class<cl_event> wait_events;
+  if (is_flushed ||
+      !detail::synchronizer::can_flush(command_group.read_buffers) ||
+      !detail::synchronizer::can_flush(command_group.write_buffers) ||
+      !detail::task_graph::get_wait_events(*node, wait_events)) {
+    // TODO(progtx):
+    return handler_event();
+  }
+  auto issued = command_group.flush(wait_events, !out_of_order);
+  auto transferred = command_group.bytes_transferred;
+
+  completion = enqueue_completion(issued, wait_events);
+  batch_master.add(command_q.get(), issued.size(), transferred);
+  if (pending != nullptr) {
+    pending->set(completion, command_q.get());
   }
+  detail::task_graph::set_flushed(*node, completion, std::move(issued));
 
-  return wait_events;
+  is_flushed = true;
+  return handler_event();
 }
@@ -0,0 +1,117 @@
+#include "../common.h"
+
+#include <SYCL/detail/build_mode.h>
+#include <SYCL/detail/program_cache.h>
+#include <chrono>
+#include <set>
+
+#ifdef __linux__
+#include <fstream>
+#include <unistd.h>
+#endif
+
+// Building a program with many kernels,
+// each kernel compiled and then linked compared with a single clBuildProgram
+
+using namespace cl::sycl;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static const int num_kernels = 16;
+
+template <int N>
+struct bench_kernel {
+  void operator()(id<1> i) {
+    float1 x = i[0];
+    SYCL_FOR(int1 n = 0, n < 32, ++n) {
+      x = x * 1.5f + static_cast<float>(N);
+    }
+    SYCL_END;
+  }
+};
+
+template <int N>
+struct kernels {
+  static void compile(program& p) {
+    kernels<N - 1>::compile(p);
+    p.compile_from_kernel_name<bench_kernel<N - 1>>();
+  }
+  static void collect(const program& p, vector_class<kernel>& list) {
+    kernels<N - 1>::collect(p, list);
+    list.push_back(p.get_kernel<bench_kernel<N - 1>>());
+  }
+};
+
+template <>
+struct kernels<0> {
+  static void compile(program&) {}
+  static void collect(const program&, vector_class<kernel>&) {}
+};
+
+/** Resident set size in KiB, zero where unknown */
+static long resident_kib() {
+#ifdef __linux__
+  std::ifstream statm("/proc/self/statm");
+  long pages = 0;
+  long resident = 0;
+  statm >> pages >> resident;
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+  return 0;
+#endif
+}
+
+static void measure(const context& ctx, detail::build_mode::value_t mode,
+                    const char* name) {
+  detail::build_mode::set(mode);
+  detail::program_cache::clear();
+
+  auto memory_before = resident_kib();
+  auto start = clock_type::now();
+
+  program p(ctx);
+  kernels<num_kernels>::compile(p);
+  p.link();
+
+  auto time = std::chrono::duration<double>(clock_type::now() - start).count();
+  auto memory = resident_kib() - memory_before;
+
+  // The linked program and the programs the kernels were compiled in
+  vector_class<kernel> list;
+  kernels<num_kernels>::collect(p, list);
+  std::set<cl_program> programs = {p.get()};
+  for (auto& k : list) {
+    programs.insert(k.get_program().get());
+  }
+  ::size_t binary_bytes = 0;
+  for (auto prog : programs) {
+    auto sizes = program(ctx, prog).get_info<info::program::binary_sizes>();
+    for (auto size : sizes) {
+      binary_bytes += size;
+    }
+  }
+
+  std::cout << name << " build time (ms): " << time * 1e3 << std::endl;
+  std::cout << name << " program objects: " << programs.size() << std::endl;
+  std::cout << name << " program binaries (KiB): " << binary_bytes / 1024
+            << std::endl;
+  std::cout << name << " resident memory growth (KiB): " << memory
+            << std::endl;
+}
+
+int main() {
+  queue myQueue;
+  auto ctx = myQueue.get_context();
+
+  // Keeps the compiler start-up out of the first measurement
+  {
+    program warm_up(ctx);
+    warm_up.build_from_kernel_name<bench_kernel<num_kernels>>();
+  }
+
+  std::cout << "kernels: " << num_kernels << std::endl;
+  measure(ctx, detail::build_mode::separate, "separate");
+  measure(ctx, detail::build_mode::batched, "batched");
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include "../../smallpt/sycl_gtx_kernel.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+// Host-side cost of tracing the smallpt path tracing kernel
+// No device is needed, the kernel is only traced into OpenCL C
+
+using namespace cl::sycl;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static ::size_t num_allocations = 0;
+
+void* operator new(std::size_t size) {
+  ++num_allocations;
+  auto ptr = std::malloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+int main() {
+  using namespace ns_sycl_gtx;
+
+  const int num_traces = 200;
+  const int size = 64;
+
+  buffer<float3> colors(size);
+  buffer<float16> spheres_buf(numSpheres);
+  buffer<cl::sycl::cl_uint2> seeds_buf(size);
+
+  auto cgh = detail::get_handler(nullptr);
+  accessor<float3, 1, access::mode::discard_read_write> c(colors, *cgh);
+  spheres_t spheres(spheres_buf, *cgh);
+  accessor<cl::sycl::cl_uint2, 1, access::mode::read> seeds(seeds_buf, *cgh);
+
+  auto kern = [=](id<2> i) {
+    RaySycl cam(Vector(50, 52, 295.6f), Vector(0, -0.042612f, -1).norm());
+    uint2 randomSeed;
+    randomSeed.x() = seeds[i].x() * i[0] + i[0] + 1;
+    randomSeed.y() = seeds[i].y() * i[1] + i[1] + 1;
+
+    Vector rad;
+    radiance(rad, spheres, cam, randomSeed);
+
+    auto ci = c[i];
+    ci.x() = rad.x;
+    ci.y() = rad.y;
+    ci.z() = rad.z;
+  };
+
+  ::size_t code_size = 0;
+  detail::ir::arena::stats ir_stats{};
+  auto allocations_before = num_allocations;
+  auto start = clock_type::now();
+  for (int n = 0; n < num_traces; ++n) {
+    auto src = detail::kernel_ns::constructor<id<2>>::get(kern, 1);
+    code_size = src.get_code().size();
+    ir_stats = src.get_ir_stats();
+  }
+  auto time = std::chrono::duration<double>(clock_type::now() - start).count();
+  auto allocations = num_allocations - allocations_before;
+
+  std::cout << "traces: " << num_traces << std::endl;
+  std::cout << "generated code (bytes): " << code_size << std::endl;
+  std::cout << "trace and emit time (ms): " << time * 1e3 / num_traces
+            << std::endl;
+  std::cout << "allocations per trace: " << allocations / num_traces
+            << std::endl;
+  std::cout << "IR nodes: " << ir_stats.nodes << std::endl;
+  std::cout << "IR arena (KiB): " << ir_stats.bytes / 1024 << std::endl;
+
+  return 0;
+}
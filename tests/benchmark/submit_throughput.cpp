@@ -0,0 +1,66 @@
+#include "../common.h"
+
+#include <chrono>
+
+// Command group submission throughput
+// Many small command groups on the same queue,
+// compared with the cost of creating an OpenCL queue per submit
+
+using namespace cl::sycl;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static double seconds_since(clock_type::time_point start) {
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+int main() {
+  const int size = 256;
+  const int num_submits = 2000;
+
+  queue myQueue;
+  buffer<int> data(size);
+
+  auto start = clock_type::now();
+  for (int n = 0; n < num_submits; ++n) {
+    myQueue.submit([&](handler& cgh) {
+      auto d = data.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class small>(range<1>(size),
+                                    [=](id<1> i) { d[i] = i; });
+    });
+  }
+  myQueue.wait();
+  auto submit_time = seconds_since(start);
+
+  // What every submit used to pay for its own sub-queue
+  auto ctx = myQueue.get_context();
+  auto dev = myQueue.get_device();
+  start = clock_type::now();
+  for (int n = 0; n < num_submits; ++n) {
+    ::cl_int error_code;
+    auto q = clCreateCommandQueue(ctx.get(), dev.get(), 0, &error_code);
+    if (error_code != CL_SUCCESS) {
+      debug() << "clCreateCommandQueue failed:" << error_code;
+      return 1;
+    }
+    clReleaseCommandQueue(q);
+  }
+  auto create_time = seconds_since(start);
+
+  std::cout << "submits: " << num_submits << std::endl;
+  std::cout << "submits/s: " << num_submits / submit_time << std::endl;
+  std::cout << "clCreateCommandQueue per submit (us): "
+            << create_time * 1e6 / num_submits << std::endl;
+  std::cout << "submits/s with a queue per submit (estimate): "
+            << num_submits / (submit_time + create_time) << std::endl;
+
+  auto d = data.get_access<access::mode::read, access::target::host_buffer>();
+  for (int i = 0; i < size; ++i) {
+    if (d[i] != i) {
+      debug() << i << "expected" << i << "actual" << d[i];
+      return 1;
+    }
+  }
+
+  return 0;
+}
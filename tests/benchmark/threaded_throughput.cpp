@@ -0,0 +1,83 @@
+#include "../common.h"
+
+#include <chrono>
+#include <thread>
+
+// Submission throughput from several host threads,
+// each with its own queue, compared with a single thread
+
+using namespace cl::sycl;
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static double seconds_since(clock_type::time_point start) {
+  return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+static const int size = 256;
+static const int num_submits = 500;
+
+static bool submit_all() {
+  queue myQueue;
+  buffer<int> data(size);
+
+  for (int n = 0; n < num_submits; ++n) {
+    myQueue.submit([&](handler& cgh) {
+      auto d = data.get_access<access::mode::read_write>(cgh);
+      cgh.parallel_for<class step>(range<1>(size),
+                                   [=](id<1> i) { d[i] += 1; });
+    });
+  }
+  myQueue.wait();
+
+  auto d = data.get_access<access::mode::read, access::target::host_buffer>();
+  for (int i = 0; i < size; ++i) {
+    if (d[i] != num_submits) {
+      debug() << i << "expected" << num_submits << "actual" << d[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  auto num_threads = std::thread::hardware_concurrency();
+  if (num_threads < 2) {
+    num_threads = 2;
+  }
+
+  auto start = clock_type::now();
+  if (!submit_all()) {
+    return 1;
+  }
+  auto single_time = seconds_since(start);
+
+  vector_class<char> results(num_threads);
+  start = clock_type::now();
+  {
+    vector_class<std::thread> threads;
+    for (unsigned int t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&results, t] { results[t] = submit_all(); });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  auto threaded_time = seconds_since(start);
+
+  for (auto result : results) {
+    if (!result) {
+      return 1;
+    }
+  }
+
+  std::cout << "submits per thread: " << num_submits << std::endl;
+  std::cout << "threads: " << num_threads << std::endl;
+  std::cout << "submits/s, 1 thread: " << num_submits / single_time
+            << std::endl;
+  std::cout << "submits/s, " << num_threads
+            << " threads: " << num_threads * num_submits / threaded_time
+            << std::endl;
+
+  return 0;
+}
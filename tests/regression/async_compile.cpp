@@ -0,0 +1,51 @@
+#include "../common.h"
+
+#include <SYCL/detail/compile_pool.h>
+
+// Kernels built on compile threads, including one submitted again while its
+// first build is still running
+
+int main() {
+  using namespace cl::sycl;
+
+  static const int size = 1024;
+
+  detail::compile_pool::set_num_threads(4);
+
+  {
+    queue myQueue;
+    buffer<int> a(size);
+    buffer<int> b(size);
+    buffer<int> c(size);
+
+    myQueue.submit([&](handler& cgh) {
+      auto d = a.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class fill_a>(range<1>(size),
+                                     [=](id<1> i) { d[i] = i; });
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto d = b.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class fill_b>(range<1>(size),
+                                     [=](id<1> i) { d[i] = i * 3; });
+    });
+    for (int n = 0; n < 2; ++n) {
+      myQueue.submit([&](handler& cgh) {
+        auto x = a.get_access<access::mode::read>(cgh);
+        auto y = b.get_access<access::mode::read>(cgh);
+        auto z = c.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class add>(range<1>(size),
+                                    [=](id<1> i) { z[i] = x[i] + y[i]; });
+      });
+    }
+
+    auto d = c.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      if (d[i] != i * 4) {
+        debug() << i << "expected" << i * 4 << "actual" << d[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include "../common.h"
+
+#include <SYCL/detail/build_mode.h>
+
+// All kernels of a program built together into one OpenCL program
+
+using namespace cl::sycl;
+
+struct first_kernel {
+  void operator()(id<1> i) {
+    int1 x = i[0];
+    x = x * 2;
+  }
+};
+
+struct second_kernel {
+  void operator()(id<1> i) {
+    int1 x = i[0];
+    x = x + 3;
+  }
+};
+
+int main() {
+  static const int size = 64;
+
+  detail::build_mode::set(detail::build_mode::batched);
+
+  {
+    queue myQueue;
+
+    program p(myQueue.get_context());
+    p.compile_from_kernel_name<first_kernel>();
+    p.compile_from_kernel_name<second_kernel>();
+    p.link();
+
+    auto first = p.get_kernel<first_kernel>();
+    auto second = p.get_kernel<second_kernel>();
+    auto built = first.get_info<info::kernel::program>();
+    if (built != second.get_info<info::kernel::program>() ||
+        built != p.get()) {
+      debug() << "kernels are not in the same program";
+      return 1;
+    }
+
+    myQueue.submit([&](handler& cgh) {
+      cgh.parallel_for(range<1>(size), first);
+    });
+    myQueue.submit([&](handler& cgh) {
+      cgh.parallel_for(range<1>(size), second);
+    });
+    myQueue.wait();
+  }
+
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include "../common.h"
+
+#include <SYCL/detail/binary_cache.h>
+#include <SYCL/detail/program_cache.h>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+// Linked binaries are stored on disk and reused once the process cache is gone
+
+using namespace cl::sycl;
+using detail::binary_cache;
+using detail::program_cache;
+
+static const int size = 1024;
+
+// Kernel names
+class scale;
+class other;
+
+static string_class make_directory() {
+#ifdef _WIN32
+  char base[MAX_PATH];
+  GetTempPathA(MAX_PATH, base);
+  string_class dir = string_class(base) + "sycl_gtx_binary_cache";
+  _mkdir(dir.c_str());
+  return dir;
+#else
+  char dir[] = "/tmp/sycl_gtx_binary_cache.XXXXXX";
+  return mkdtemp(dir) != nullptr ? dir : "";
+#endif
+}
+
+static vector_class<string_class> list_entries(const string_class& dir) {
+  vector_class<string_class> paths;
+#ifdef _WIN32
+  WIN32_FIND_DATAA data;
+  auto handle = FindFirstFileA((dir + "\\*.clbin").c_str(), &data);
+  if (handle != INVALID_HANDLE_VALUE) {
+    do {
+      paths.push_back(dir + '/' + data.cFileName);
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+  }
+#else
+  auto d = opendir(dir.c_str());
+  if (d != nullptr) {
+    while (auto entry = readdir(d)) {
+      string_class name = entry->d_name;
+      if (name.size() > 6 && name.compare(name.size() - 6, 6, ".clbin") == 0) {
+        paths.push_back(dir + '/' + name);
+      }
+    }
+    closedir(d);
+  }
+#endif
+  return paths;
+}
+
+static ::size_t file_size(const string_class& path) {
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 ? static_cast<::size_t>(info.st_size)
+                                        : 0;
+}
+
+static std::time_t modified(const string_class& path) {
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+}
+
+/** Makes the entry look like it was last used a while ago */
+static void age(const string_class& path) {
+  struct utimbuf times;
+  times.actime = times.modtime = std::time(nullptr) - 1000;
+  utime(path.c_str(), &times);
+}
+
+/** Builds the kernel again, bypassing the process-wide program cache */
+template <class name>
+static bool run(queue& myQueue, buffer<int>& data, int factor) {
+  program_cache::clear();
+  myQueue.submit([&](handler& cgh) {
+    auto d = data.get_access<access::mode::discard_write>(cgh);
+    cgh.parallel_for<name>(range<1>(size), [=](id<1> i) { d[i] = i * factor; });
+  });
+
+  auto d = data.get_access<access::mode::read, access::target::host_buffer>();
+  for (int i = 0; i < size; ++i) {
+    if (d[i] != i * factor) {
+      debug() << i << "expected" << i * factor << "actual" << d[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+static int test(const string_class& dir) {
+  queue myQueue;
+  buffer<int> data(size);
+
+  // First build from source stores the entry
+  if (!run<scale>(myQueue, data, 2)) {
+    return 1;
+  }
+  auto entries = list_entries(dir);
+  if (entries.size() != 1) {
+    debug() << "expected 1 entry, found" << entries.size();
+    return 1;
+  }
+  auto path = entries.front();
+  auto stored_size = file_size(path);
+
+  // Loading the entry marks it as recently used
+  age(path);
+  auto aged = modified(path);
+  if (!run<scale>(myQueue, data, 2)) {
+    return 1;
+  }
+  if (modified(path) <= aged) {
+    debug() << "entry was not reloaded";
+    return 1;
+  }
+
+  // A truncated entry is ignored, the kernel is built from source and stored
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "sycl-gtx";
+  }
+  if (!run<scale>(myQueue, data, 2)) {
+    return 1;
+  }
+  if (file_size(path) != stored_size) {
+    debug() << "truncated entry was not replaced";
+    return 1;
+  }
+
+  // Only room for one entry, the least recently used one is evicted
+  binary_cache::set_directory(dir, stored_size + stored_size / 2);
+  age(path);
+  if (!run<other>(myQueue, data, 3)) {
+    return 1;
+  }
+  entries = list_entries(dir);
+  if (entries.size() != 1 || entries.front() == path) {
+    debug() << "expected only the newest entry, found" << entries.size();
+    return 1;
+  }
+
+  return 0;
+}
+
+int main() {
+  auto dir = make_directory();
+  if (dir.empty()) {
+    debug() << "could not create a temporary directory";
+    return 1;
+  }
+
+  binary_cache::set_directory(dir);
+  auto result = test(dir);
+  binary_cache::set_directory("");
+
+  for (auto& path : list_entries(dir)) {
+    std::remove(path.c_str());
+  }
+#ifdef _WIN32
+  _rmdir(dir.c_str());
+#else
+  rmdir(dir.c_str());
+#endif
+
+  return result;
+}
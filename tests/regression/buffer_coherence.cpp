@@ -0,0 +1,73 @@
+#include "../common.h"
+
+// Kernels in a pipeline keep the data on the device
+// until the host accesses it
+
+int main() {
+  using namespace cl::sycl;
+  using detail::buffer_base;
+
+  static const int size = 1024;
+  static const int steps = 8;
+
+  // Counts copies, which mapping avoids on host unified memory
+  buffer_base::set_zero_copy(false);
+
+  vector_class<int> host(size);
+  for (int i = 0; i < size; ++i) {
+    host[i] = i;
+  }
+
+  {
+    queue myQueue;
+    buffer<int> ping(host.data(), size);
+    buffer<int> pong(size);
+
+    auto P = &ping;
+    auto Q = &pong;
+
+    auto before = buffer_base::get_transfer_stats();
+
+    for (int n = 0; n < steps; ++n) {
+      myQueue.submit([&](handler& cgh) {
+        auto input = P->get_access<access::mode::read>(cgh);
+        auto output = Q->get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class increment>(
+            range<1>(size), [=](id<1> i) { output[i] = input[i] + 1; });
+      });
+      std::swap(P, Q);
+    }
+    myQueue.wait();
+
+    auto after = buffer_base::get_transfer_stats();
+    auto uploads = after.uploads - before.uploads;
+    auto downloads = after.downloads - before.downloads;
+    if (uploads != 1 || downloads != 0) {
+      debug() << "expected 1 upload and no downloads, got" << uploads
+              << "uploads and" << downloads << "downloads";
+      return 1;
+    }
+
+    {
+      auto p = P->get_access<access::mode::read, access::target::host_buffer>();
+      for (int i = 0; i < size; ++i) {
+        if (p[i] != i + steps) {
+          debug() << i << "expected" << i + steps << "actual" << p[i];
+          return 1;
+        }
+      }
+    }
+
+    after = buffer_base::get_transfer_stats();
+    downloads = after.downloads - before.downloads;
+    if (downloads != 1) {
+      debug() << "expected 1 download for the host accessor, got" << downloads;
+      return 1;
+    }
+    debug() << "bytes transferred"
+            << after.bytes_transferred - before.bytes_transferred
+            << "- avoided" << after.bytes_avoided - before.bytes_avoided;
+  }
+
+  return 0;
+}
@@ -0,0 +1,224 @@
+#include "../common.h"
+
+#include <chrono>
+#include <thread>
+
+// Copies and fills between buffers stay on the device
+
+using namespace cl::sycl;
+using detail::buffer_base;
+
+int main() {
+  static const int size = 1024;
+
+  // Transfers are counted, mapping would avoid them
+  buffer_base::set_zero_copy(false);
+
+  vector_class<int> source(size);
+  for (int i = 0; i < size; ++i) {
+    source[i] = i;
+  }
+  vector_class<int> target(size, 0);
+  vector_class<int> read_back(size, 0);
+  vector_class<int> written(size);
+  for (int i = 0; i < size; ++i) {
+    written[i] = -i;
+  }
+  vector_class<int> larger(2 * size, 5);
+
+  {
+    queue myQueue;
+
+    buffer<int> a(source.data(), size);
+    buffer<int> b(target.data(), size);
+    buffer<int> c(size);
+    buffer<int> d(larger.data(), 2 * size);
+
+    myQueue.submit([&](handler& cgh) {
+      auto a_acc = a.get_access<access::mode::read_write>(cgh);
+      cgh.parallel_for<class increment>(range<1>(size),
+                                        [=](id<1> i) { a_acc[i] += 1; });
+    });
+    myQueue.wait();
+
+    auto before = buffer_base::get_transfer_stats();
+    myQueue.submit([&](handler& cgh) {
+      auto a_acc = a.get_access<access::mode::read>(cgh);
+      auto b_acc = b.get_access<access::mode::discard_write>(cgh);
+      cgh.copy(a_acc, b_acc);
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto c_acc = c.get_access<access::mode::discard_write>(cgh);
+      cgh.fill(c_acc, 3);
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto b_acc = b.get_access<access::mode::read>(cgh);
+      auto d_acc = d.get_access<access::mode::write>(cgh);
+      cgh.copy(b_acc, d_acc);
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto b_acc = b.get_access<access::mode::read_write>(cgh);
+      auto c_acc = c.get_access<access::mode::read>(cgh);
+      cgh.parallel_for<class add>(range<1>(size),
+                                  [=](id<1> i) { b_acc[i] += c_acc[i]; });
+    });
+    myQueue.wait();
+
+    auto after = buffer_base::get_transfer_stats();
+    // Only the tail of d is uploaded, kept by the copy
+    auto uploads = after.uploads - before.uploads;
+    auto downloads = after.downloads - before.downloads;
+    if (uploads != 1 || downloads != 0) {
+      debug() << "expected 1 upload and no downloads, got" << uploads << "and"
+              << downloads;
+      return 1;
+    }
+
+    myQueue.submit([&](handler& cgh) {
+      auto b_acc = b.get_access<access::mode::read>(cgh);
+      cgh.copy(b_acc, read_back.data());
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto c_acc = c.get_access<access::mode::discard_write>(cgh);
+      cgh.copy(written.data(), c_acc);
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto c_acc = c.get_access<access::mode::read>(cgh);
+      cgh.update_host(c_acc);
+    });
+    myQueue.wait();
+
+    // A source only on the host is read without going through the device
+    vector_class<int> host_copy(size, 0);
+    buffer<int> e(written.data(), size);
+    before = buffer_base::get_transfer_stats();
+    myQueue.submit([&](handler& cgh) {
+      auto e_acc = e.get_access<access::mode::read>(cgh);
+      cgh.copy(e_acc, host_copy.data());
+    });
+    myQueue.wait();
+    after = buffer_base::get_transfer_stats();
+    if (after.uploads != before.uploads ||
+        after.downloads != before.downloads || host_copy != written) {
+      debug() << "host data was not copied directly";
+      return 1;
+    }
+
+    // Unless a host task of the same group still has to write it
+    myQueue.submit([&](handler& cgh) {
+      auto e_host =
+          e.get_access<access::mode::read_write, access::target::host_buffer>(
+              cgh);
+      cgh.host_task([=]() mutable {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        for (int i = 0; i < size; ++i) {
+          e_host[i] = 2 * i;
+        }
+      });
+      auto e_acc = e.get_access<access::mode::read>(cgh);
+      cgh.copy(e_acc, host_copy.data());
+    });
+    myQueue.wait();
+    for (int i = 0; i < size; ++i) {
+      if (host_copy[i] != 2 * i) {
+        debug() << i << "expected" << 2 * i << "actual" << host_copy[i];
+        return 1;
+      }
+    }
+
+    // Nor a sub-buffer whose parent has newer data on the device
+    {
+      buffer<int> g(size);
+      buffer<int> sub(g, id<1>(3), range<1>(5));
+      myQueue.submit([&](handler& cgh) {
+        auto g_acc = g.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class count>(range<1>(size),
+                                      [=](id<1> i) { g_acc[i] = i; });
+      });
+      myQueue.submit([&](handler& cgh) {
+        auto s_acc = sub.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class increment_sub>(
+            range<1>(5), [=](id<1> i) { s_acc[i] += 1; });
+      });
+      {
+        auto h = sub.get_access<access::mode::discard_write,
+                                access::target::host_buffer>();
+        for (int i = 0; i < 5; ++i) {
+          h[i] = 0;
+        }
+      }
+      myQueue.submit([&](handler& cgh) {
+        auto g_acc = g.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class add_ten>(range<1>(size),
+                                        [=](id<1> i) { g_acc[i] += 10; });
+      });
+      myQueue.submit([&](handler& cgh) {
+        auto s_acc = sub.get_access<access::mode::read>(cgh);
+        cgh.copy(s_acc, host_copy.data());
+      });
+      myQueue.wait();
+      for (int i = 0; i < 5; ++i) {
+        if (host_copy[i] != 10) {
+          debug() << "sub-buffer" << i << "expected 10, actual"
+                  << host_copy[i];
+          return 1;
+        }
+      }
+    }
+
+    // Copies between overlapping parts of the same data are rejected
+    buffer<int> f(2 * size);
+    auto overlaps = [&](int from, int to) {
+      buffer<int> src(f, id<1>(from), range<1>(size / 2));
+      buffer<int> dst(f, id<1>(to), range<1>(size / 2));
+      try {
+        myQueue.submit([&](handler& cgh) {
+          auto src_acc = src.get_access<access::mode::read>(cgh);
+          auto dst_acc = dst.get_access<access::mode::write>(cgh);
+          cgh.copy(src_acc, dst_acc);
+        });
+      } catch (exception& e) {
+        debug() << "rejected copy:" << e.what();
+        return true;
+      }
+      return false;
+    };
+    if (!overlaps(0, 0) || !overlaps(0, size / 4)) {
+      debug() << "overlapping copy accepted";
+      return 1;
+    }
+    if (overlaps(0, size)) {
+      debug() << "copy between separate sub-buffers rejected";
+      return 1;
+    }
+
+    auto h = c.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      if (h[i] != -i) {
+        debug() << "c" << i << "expected" << -i << "actual" << h[i];
+        return 1;
+      }
+    }
+  }
+
+  for (int i = 0; i < size; ++i) {
+    if (read_back[i] != i + 4) {
+      debug() << "read back" << i << "expected" << i + 4 << "actual"
+              << read_back[i];
+      return 1;
+    }
+    if (target[i] != i + 4) {
+      debug() << "b" << i << "expected" << i + 4 << "actual" << target[i];
+      return 1;
+    }
+  }
+  for (int i = 0; i < 2 * size; ++i) {
+    auto expected = (i < size) ? i + 1 : 5;
+    if (larger[i] != expected) {
+      debug() << "d" << i << "expected" << expected << "actual" << larger[i];
+      return 1;
+    }
+  }
+
+  return 0;
+}
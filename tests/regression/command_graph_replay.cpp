@@ -0,0 +1,105 @@
+#include "../common.h"
+
+// Recorded command groups only run when replayed,
+// with the scalar arguments set for each replay
+
+int main() {
+  using namespace cl::sycl;
+
+  static const int size = 1024;
+  static const int replays = 3;
+  static const int last_step = 10;
+
+  {
+    queue myQueue;
+    buffer<int> x(size);
+    buffer<int> y(size);
+
+    myQueue.submit([&](handler& cgh) {
+      auto wx = x.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class init>(range<1>(size), [=](id<1> i) { wx[i] = i; });
+    });
+
+    myQueue.begin_recording();
+    myQueue.submit([&](handler& cgh) {
+      auto rwx = x.get_access<access::mode::read_write>(cgh);
+      scalar_arg<int> step(1);
+      cgh.parallel_for<class advance>(range<1>(size),
+                                      [=](id<1> i) { rwx[i] += step; });
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto rx = x.get_access<access::mode::read>(cgh);
+      auto wy = y.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class twice>(range<1>(size),
+                                    [=](id<1> i) { wy[i] = rx[i] * 2; });
+    });
+    auto recorded = myQueue.end_recording();
+
+    if (recorded.size() != 2) {
+      debug() << "recorded" << recorded.size() << "command groups";
+      return 1;
+    }
+    {
+      auto hx = x.get_access<access::mode::read, access::target::host_buffer>();
+      if (hx[1] != 1) {
+        debug() << "recorded command group ran, got" << hx[1];
+        return 1;
+      }
+    }
+
+    for (int n = 0; n < replays; ++n) {
+      myQueue.replay(recorded);
+    }
+    recorded.set_scalar(0, 0, last_step);
+    myQueue.replay(recorded);
+
+    // Submitted command groups wait for the replays
+    myQueue.submit([&](handler& cgh) {
+      auto rwy = y.get_access<access::mode::read_write>(cgh);
+      cgh.parallel_for<class increment>(range<1>(size),
+                                        [=](id<1> i) { rwy[i] += 1; });
+    });
+
+    auto stats = recorded.get_stats();
+    if (stats.replays != replays + 1 ||
+        stats.commands < 2 * (replays + 1)) {
+      debug() << stats.replays << "replays," << stats.commands << "commands";
+      return 1;
+    }
+
+    // The graph doesn't keep its buffers alive
+    detail::command_graph dangling;
+    {
+      buffer<int> z(size);
+      myQueue.begin_recording();
+      myQueue.submit([&](handler& cgh) {
+        auto wz = z.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class clear>(range<1>(size),
+                                      [=](id<1> i) { wz[i] = 0; });
+      });
+      dangling = myQueue.end_recording();
+    }
+    bool reported = false;
+    try {
+      myQueue.replay(dangling);
+    } catch (exception&) {
+      reported = true;
+    }
+    if (!reported) {
+      debug() << "replayed a graph with a destroyed buffer";
+      return 1;
+    }
+
+    auto hx = x.get_access<access::mode::read, access::target::host_buffer>();
+    auto hy = y.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      int expected = i + replays + last_step;
+      if (hx[i] != expected || hy[i] != expected * 2 + 1) {
+        debug() << i << "expected" << expected << "actual" << hx[i] << hy[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
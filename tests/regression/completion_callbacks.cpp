@@ -0,0 +1,125 @@
+#include "../common.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Completion of submitted command groups without blocking the host thread
+
+using namespace cl::sycl;
+
+static bool spin_until(const std::atomic<bool>& flag) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!flag) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+int main() {
+  static const int size = 1024;
+
+  {
+    queue myQueue;
+    buffer<int> data(size);
+
+    auto submitted = myQueue.submit([&](handler& cgh) {
+      auto d = data.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class init>(range<1>(size), [=](id<1> i) { d[i] = i; });
+    });
+
+    std::atomic<bool> called(false);
+    std::atomic<int> status(1);
+    submitted.then([&](::cl_int s) {
+      status = s;
+      called = true;
+    });
+    auto future = submitted.get_future();
+
+    while (!submitted.is_complete()) {
+      std::this_thread::yield();
+    }
+    future.get();
+    if (!spin_until(called) || status != CL_COMPLETE) {
+      debug() << "callback not called, status" << status.load();
+      return 1;
+    }
+
+    // Held back until the host accessor is gone
+    called = false;
+    std::future<void> increment;
+    {
+      auto h = data.get_access<access::mode::read_write,
+                               access::target::host_buffer>();
+      h[0] = -1;
+      auto held = myQueue.submit([&](handler& cgh) {
+        auto d = data.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class increment>(range<1>(size),
+                                          [=](id<1> i) { d[i] += 1; });
+      });
+      if (held.is_complete()) {
+        debug() << "completed while the host accessor exists";
+        return 1;
+      }
+      held.then([&](::cl_int) { called = true; });
+      increment = held.get_future();
+    }
+    if (increment.wait_for(std::chrono::seconds(10)) !=
+            std::future_status::ready ||
+        !spin_until(called)) {
+      debug() << "not completed after the host accessor";
+      return 1;
+    }
+
+    // Enqueued once its new kernel is built, without using the queue again
+    called = false;
+    auto built = myQueue.submit([&](handler& cgh) {
+      auto d = data.get_access<access::mode::read_write>(cgh);
+      cgh.parallel_for<class decrement>(range<1>(size),
+                                        [=](id<1> i) { d[i] -= 1; });
+    });
+    built.then([&](::cl_int) { called = true; });
+    if (!spin_until(called)) {
+      debug() << "not completed after the kernel was built";
+      return 1;
+    }
+
+    auto h = data.get_access<access::mode::read, access::target::host_buffer>();
+    if (h[0] != -1 || h[size - 1] != size - 1) {
+      debug() << "actual" << h[0] << h[size - 1];
+      return 1;
+    }
+  }
+
+  // Polled from another thread while the queue is being destroyed
+  for (int n = 0; n < 16; ++n) {
+    buffer<int> data(size);
+    handler_event submitted;
+    std::atomic<bool> destroyed(false);
+    std::thread poller;
+    {
+      queue myQueue;
+      submitted = myQueue.submit([&](handler& cgh) {
+        auto d = data.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class init>(range<1>(size),
+                                     [=](id<1> i) { d[i] = i; });
+      });
+      poller = std::thread([&] {
+        while (!destroyed && !submitted.is_complete()) {
+          std::this_thread::yield();
+        }
+      });
+    }
+    destroyed = true;
+    poller.join();
+    if (!submitted.is_complete()) {
+      debug() << "not completed after the queue was destroyed";
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,172 @@
+#include "../common.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Command groups submitted from several host threads,
+// each to its own queue and all of them to a shared one
+
+template <int N>
+struct name {};
+
+static const int inner_size = 256;
+
+static void fill(cl::sycl::queue& q, cl::sycl::buffer<int>& buf) {
+  using namespace cl::sycl;
+  q.submit([&](handler& cgh) {
+    auto out = buf.get_access<access::mode::discard_write>(cgh);
+    cgh.parallel_for<class inner_fill>(range<1>(inner_size),
+                                       [=](id<1> i) { out[i] = i; });
+  });
+}
+
+/**
+ * A host task creates and destroys a queue and a buffer
+ * while the main thread is blocked in a host accessor waiting for it
+ */
+static bool host_task_creates_queue() {
+  using namespace cl::sycl;
+
+  static const int size = inner_size;
+
+  queue myQueue;
+  buffer<int> data(size);
+  std::atomic<bool> accessing(false);
+  std::atomic<bool> done(false);
+
+  // Built here, the host task may be running on the only compile thread
+  fill(myQueue, data);
+  myQueue.wait();
+  auto ctx = myQueue.get_context();
+  auto dev = myQueue.get_device();
+
+  myQueue.submit([&](handler& cgh) {
+    auto h = data.get_access<access::mode::discard_write,
+                             access::target::host_buffer>(cgh);
+    cgh.host_task([=, &accessing, &done]() mutable {
+      while (!accessing) {
+        std::this_thread::yield();
+      }
+      // Gives the main thread time to block on this host task
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+      queue inner(ctx, dev);
+      buffer<int> temp(size);
+      fill(inner, temp);
+      auto ht =
+          temp.get_access<access::mode::read, access::target::host_buffer>();
+      for (int i = 0; i < size; ++i) {
+        h[i] = ht[i] + 1;
+      }
+      done = true;
+    });
+  });
+
+  accessing = true;
+  auto h = data.get_access<access::mode::read, access::target::host_buffer>();
+  if (!done) {
+    debug() << "host accessor did not wait for the host task";
+    return false;
+  }
+  for (int i = 0; i < size; ++i) {
+    if (h[i] != i + 1) {
+      debug() << i << "expected" << i + 1 << "actual" << h[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  using namespace cl::sycl;
+
+  static const int size = 256;
+  static const int num_threads = 4;
+  static const int num_submits = 25;
+
+  queue shared_queue;
+  auto ctx = shared_queue.get_context();
+  auto dev = shared_queue.get_device();
+  std::atomic<int> failures(0);
+
+  auto work = [&](int t) {
+    // Same context, so the threads share the cached cl_kernel of own_step
+    queue own_queue(ctx, dev);
+    buffer<int> own(size);
+    buffer<int> shared(size);
+
+    for (int n = 0; n < num_submits; ++n) {
+      own_queue.submit([&](handler& cgh) {
+        auto rwo = own.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class own_step>(range<1>(size),
+                                         [=](id<1> i) { rwo[i] += 1; });
+      });
+      shared_queue.submit([&](handler& cgh) {
+        auto ws = shared.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class shared_step>(range<1>(size),
+                                            [=](id<1> i) { ws[i] = i * t; });
+      });
+    }
+
+    auto ho = own.get_access<access::mode::read, access::target::host_buffer>();
+    auto hs =
+        shared.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      if (ho[i] != num_submits || hs[i] != i * t) {
+        debug() << "thread" << t << "element" << i << "actual" << ho[i]
+                << hs[i];
+        ++failures;
+        return;
+      }
+    }
+  };
+
+  {
+    vector_class<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      threads.emplace_back(work, t);
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  shared_queue.wait();
+
+  if (failures > 0) {
+    return 1;
+  }
+
+  // Kernel names first requested concurrently are still unique
+  vector_class<vector_class<::size_t>> ids(num_threads);
+  {
+    vector_class<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&ids, t] {
+        ids[t] = {detail::kernel_name::get<name<0>>(),
+                  detail::kernel_name::get<name<1>>(),
+                  detail::kernel_name::get<name<2>>()};
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  auto& first = ids[0];
+  if (first[0] == first[1] || first[1] == first[2] || first[0] == first[2]) {
+    debug() << "kernel names" << first[0] << first[1] << first[2];
+    return 1;
+  }
+  for (int t = 1; t < num_threads; ++t) {
+    if (ids[t] != first) {
+      debug() << "thread" << t << "got other kernel names";
+      return 1;
+    }
+  }
+
+  if (!host_task_creates_queue()) {
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include "../common.h"
+
+// Many small command groups are flushed to the device in batches
+
+int main() {
+  using namespace cl::sycl;
+
+  static const int size = 64;
+  static const ::size_t steps = 32;
+  static const ::size_t batch_size = 8;
+
+  {
+    queue myQueue;
+    buffer<int> data(size);
+
+    detail::flush_policy policy;
+    policy.max_groups = batch_size;
+    myQueue.set_flush_policy(policy);
+
+    myQueue.submit([&](handler& cgh) {
+      auto d = data.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class init>(range<1>(size), [=](id<1> i) { d[i] = i; });
+    });
+    for (::size_t n = 1; n < steps; ++n) {
+      myQueue.submit([&](handler& cgh) {
+        auto d = data.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class increment>(range<1>(size),
+                                          [=](id<1> i) { d[i] += 1; });
+      });
+    }
+    myQueue.wait();
+
+    auto stats = myQueue.get_flush_stats();
+    debug() << stats.command_groups << "command groups," << stats.commands
+            << "commands," << stats.flushes << "flushes";
+    auto expected = steps / batch_size;
+    if (stats.command_groups != steps || stats.flushes != expected ||
+        stats.flushes_avoided != steps - expected) {
+      debug() << "expected" << expected << "flushes";
+      return 1;
+    }
+
+    auto h = data.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      auto value = i + static_cast<int>(steps) - 1;
+      if (h[i] != value) {
+        debug() << i << "expected" << value << "actual" << h[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
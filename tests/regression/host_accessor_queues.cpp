@@ -0,0 +1,77 @@
+#include "../common.h"
+
+// A host accessor only flushes and waits on the queues using its buffer,
+// and releasing it enqueues the command groups it held back
+
+int main() {
+  using namespace cl::sycl;
+
+  static const int size = 64;
+  static const int num_queues = 8;
+  static const auto host_buffer = access::target::host_buffer;
+
+  {
+    detail::flush_policy policy;
+    policy.max_groups = 16;
+
+    vector_class<queue> queues(num_queues);
+    vector_class<buffer<int>> buffers;
+    buffers.reserve(num_queues);
+    for (int q = 0; q < num_queues; ++q) {
+      queues[q].set_flush_policy(policy);
+      buffers.emplace_back(range<1>(size));
+    }
+
+    for (int q = 0; q < num_queues; ++q) {
+      queues[q].submit([&](handler& cgh) {
+        auto w = buffers[q].get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class init>(range<1>(size),
+                                     [=](id<1> i) { w[i] = i * q; });
+      });
+    }
+
+    {
+      auto h = buffers[0].get_access<access::mode::read, host_buffer>();
+      for (int q = 1; q < num_queues; ++q) {
+        auto flushes = queues[q].get_flush_stats().flushes;
+        if (flushes != 0) {
+          debug() << "unrelated queue" << q << "flushed" << flushes << "times";
+          return 1;
+        }
+      }
+    }
+
+    // Its first command group might otherwise still wait for its kernel
+    queues[2].wait();
+    {
+      auto h = buffers[1].get_access<access::mode::write, host_buffer>();
+      queues[2].submit([&](handler& cgh) {
+        auto r = buffers[1].get_access<access::mode::read>(cgh);
+        auto w = buffers[2].get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class copy>(range<1>(size),
+                                     [=](id<1> i) { w[i] = r[i]; });
+      });
+      if (queues[2].get_flush_stats().command_groups != 1) {
+        debug() << "command group enqueued while the host accesses its buffer";
+        return 1;
+      }
+      for (int i = 0; i < size; ++i) {
+        h[i] = -i;
+      }
+    }
+    if (queues[2].get_flush_stats().command_groups != 2) {
+      debug() << "command group not enqueued after the host accessor";
+      return 1;
+    }
+
+    auto h = buffers[2].get_access<access::mode::read, host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      if (h[i] != -i) {
+        debug() << i << "expected" << -i << "actual" << h[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
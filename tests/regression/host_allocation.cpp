@@ -0,0 +1,95 @@
+#include "../common.h"
+
+// Runtime-owned host storage is aligned and comes from the buffer allocator
+
+using namespace cl::sycl;
+using detail::host_memory;
+
+static int allocations = 0;
+static int deallocations = 0;
+
+template <typename T>
+struct counting_allocator : public buffer_allocator<T> {
+  counting_allocator() = default;
+  template <typename U>
+  counting_allocator(const counting_allocator<U>&) {}
+
+  T* allocate(::size_t n) {
+    ++allocations;
+    return buffer_allocator<T>::allocate(n);
+  }
+  void deallocate(T* ptr, ::size_t n) {
+    ++deallocations;
+    buffer_allocator<T>::deallocate(ptr, n);
+  }
+};
+
+template <typename Buffer>
+static bool is_aligned(Buffer& buf, ::size_t alignment) {
+  auto h = buf.template get_access<access::mode::read,
+                                   access::target::host_buffer>();
+  auto address = reinterpret_cast<::size_t>(&h[0]);
+  if (address % alignment != 0) {
+    debug() << "host data at" << address << "not aligned to" << alignment;
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  static const int size = 1000;
+
+  {
+    queue myQueue;
+
+    buffer<int> aligned(size);
+    if (!is_aligned(aligned, host_memory::default_alignment)) {
+      return 1;
+    }
+
+    {
+      buffer<int, 1, counting_allocator<int>> counted(size);
+      myQueue.submit([&](handler& cgh) {
+        auto c = counted.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class fill>(range<1>(size),
+                                     [=](id<1> i) { c[i] = i; });
+      });
+      auto h = counted.get_access<access::mode::read,
+                                  access::target::host_buffer>();
+      for (int i = 0; i < size; ++i) {
+        if (h[i] != i) {
+          debug() << i << "expected" << i << "actual" << h[i];
+          return 1;
+        }
+      }
+    }
+    if (allocations != 1 || deallocations != 1) {
+      debug() << "expected 1 allocation and deallocation, got" << allocations
+              << "and" << deallocations;
+      return 1;
+    }
+
+    vector_class<int> values(size, 7);
+    buffer<int> copied(values.begin(), values.end());
+    if (!is_aligned(copied, host_memory::default_alignment)) {
+      return 1;
+    }
+    {
+      auto h = copied.get_access<access::mode::read,
+                                 access::target::host_buffer>();
+      if (h[size - 1] != 7) {
+        debug() << "iterator data not copied";
+        return 1;
+      }
+    }
+
+    host_memory::set_huge_page_threshold(host_memory::huge_page_size);
+    buffer<char> huge(2 * host_memory::huge_page_size);
+    if (!is_aligned(huge, host_memory::huge_page_size)) {
+      return 1;
+    }
+    host_memory::set_huge_page_threshold(0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include "../common.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+// Host tasks run between kernels on the same buffers
+// without blocking the submitting thread
+
+using namespace cl::sycl;
+
+static bool spin_until(const std::atomic<bool>& flag) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!flag) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+static bool run(queue& myQueue) {
+  static const int size = 1024;
+
+  buffer<int> data(size);
+  std::atomic<bool> submitted(false);
+  std::atomic<bool> waited(false);
+
+  myQueue.submit([&](handler& cgh) {
+    auto d = data.get_access<access::mode::discard_write>(cgh);
+    cgh.parallel_for<class init>(range<1>(size), [=](id<1> i) { d[i] = i; });
+  });
+
+  myQueue.submit([&](handler& cgh) {
+    auto h = data.get_access<access::mode::read_write,
+                             access::target::host_buffer>(cgh);
+    cgh.host_task([=, &submitted, &waited]() mutable {
+      waited = spin_until(submitted);
+      for (int i = 0; i < size; ++i) {
+        h[i] *= 2;
+      }
+    });
+  });
+  submitted = true;
+
+  myQueue.submit([&](handler& cgh) {
+    auto d = data.get_access<access::mode::read_write>(cgh);
+    cgh.parallel_for<class increment>(range<1>(size),
+                                      [=](id<1> i) { d[i] += 1; });
+  });
+
+  auto h = data.get_access<access::mode::read, access::target::host_buffer>();
+  if (!waited) {
+    debug() << "host task blocked the submitting thread";
+    return false;
+  }
+  for (int i = 0; i < size; ++i) {
+    if (h[i] != 2 * i + 1) {
+      debug() << i << "expected" << 2 * i + 1 << "actual" << h[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+/** An exception thrown by a host task reaches the async_handler */
+static bool throws() {
+  vector_class<string_class> reported;
+  queue myQueue([&](exception_list list) {
+    for (auto& e : list) {
+      try {
+        std::rethrow_exception(e);
+      } catch (std::runtime_error& thrown) {
+        reported.push_back(thrown.what());
+      }
+    }
+  });
+
+  myQueue.submit([&](handler& cgh) {
+    cgh.host_task([] { throw std::runtime_error("host task failed"); });
+  });
+  myQueue.wait_and_throw();
+  if (reported.size() != 1 || reported[0] != "host task failed") {
+    debug() << "expected the exception of the host task, got"
+            << reported.size();
+    return false;
+  }
+
+  // Only reported once
+  myQueue.throw_asynchronous();
+  if (reported.size() != 1) {
+    debug() << "reported again";
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  detail::compile_pool::set_num_threads(2);
+
+  if (!throws()) {
+    return 1;
+  }
+
+  {
+    queue myQueue;
+    if (!run(myQueue)) {
+      return 1;
+    }
+  }
+
+  {
+    context ctx;
+    queue myQueue(ctx, ctx.get_devices()[0], false, true);
+    if (!run(myQueue)) {
+      return 1;
+    }
+  }
+
+  // Still not run by the thread completing the commands before it
+  detail::compile_pool::set_num_threads(0);
+  {
+    queue myQueue;
+    if (!run(myQueue)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "../common.h"
+
+#include <SYCL/detail/src_handlers/optimizer.h>
+
+// Kernel traced with all IR optimization passes computes the same values
+
+using namespace cl::sycl;
+
+class optimized_kernel {
+ public:
+  using in_acc_t =
+      accessor<float, 1, access::mode::read, access::target::global_buffer>;
+  using out_acc_t = accessor<float, 1, access::mode::discard_write,
+                             access::target::global_buffer>;
+
+ private:
+  in_acc_t in;
+  out_acc_t out;
+
+ public:
+  optimized_kernel(in_acc_t in, out_acc_t out) : in(in), out(out) {}
+
+  void operator()(id<1> i) {
+    float1 a = in[i];
+    float1 b = a;
+    float1 two = 2.0f;
+    float1 c = two * 3.0f;
+    float1 unused = a * a;
+    float1 d;
+    SYCL_IF(b > 0.5f) {
+      d = (b + c) * (b + c);
+    }
+    SYCL_ELSE {
+      d = b * c;
+    }
+    SYCL_END;
+    out[i] = d + (b + c) * 1;
+  }
+};
+
+/** Source of the kernel traced with the given passes */
+static string_class render(queue& myQueue, buffer<float>& input,
+                           buffer<float>& output, unsigned int passes) {
+  using namespace detail::kernel_ns;
+  string_class code;
+  myQueue.submit([&](handler& cgh) {
+    auto in = input.get_access<access::mode::read>(cgh);
+    auto out = output.get_access<access::mode::discard_write>(cgh);
+    auto src = constructor<id<1>>::get(optimized_kernel(in, out), 0);
+    optimizer::run_passes(src, passes);
+    code = src.get_code();
+  });
+  return code;
+}
+
+static int count(const string_class& code, const string_class& what) {
+  int n = 0;
+  for (auto pos = code.find(what); pos != string_class::npos;
+       pos = code.find(what, pos + what.size())) {
+    ++n;
+  }
+  return n;
+}
+
+float expected(float a) {
+  float c = 6.0f;
+  float d = (a > 0.5f) ? (a + c) * (a + c) : a * c;
+  return d + (a + c);
+}
+
+int main() {
+  using detail::kernel_ns::optimizer;
+
+  static const int size = 1024;
+
+  optimizer::set_passes<optimized_kernel>(optimizer::all);
+
+  {
+    queue myQueue;
+    buffer<float> input(size);
+    buffer<float> output(size);
+
+    {
+      auto in =
+          input.get_access<access::mode::discard_write,
+                           access::target::host_buffer>();
+      for (int i = 0; i < size; ++i) {
+        in[i] = static_cast<float>(i) / size;
+      }
+    }
+
+    auto plain = render(myQueue, input, output, optimizer::none);
+    auto optimized = render(myQueue, input, output, optimizer::all);
+    debug() << plain;
+    debug() << optimized;
+
+    // 2 * 3 is folded, and b + c is computed once inside the branch
+    if (count(plain, "* 3.f") == 0 || count(optimized, "* 3.f") != 0 ||
+        count(optimized, "6.f") == 0) {
+      debug() << "constant was not folded";
+      return 1;
+    }
+    if (count(optimized, "+ 6.f)") >= count(plain, "* 3.f))")) {
+      debug() << "common subexpression was not eliminated";
+      return 1;
+    }
+    if (count(plain, "* 1)") == 0 || count(optimized, "* 1)") != 0) {
+      debug() << "multiplication by 1 was not removed";
+      return 1;
+    }
+    if (count(optimized, "_float_1") != 0 ||
+        count(optimized, "_float_0 * _float_0") != 0) {
+      debug() << "dead copies were not removed";
+      return 1;
+    }
+    if (optimized.size() >= plain.size()) {
+      debug() << "optimized code is not shorter";
+      return 1;
+    }
+
+    myQueue.submit([&](handler& cgh) {
+      auto in = input.get_access<access::mode::read>(cgh);
+      auto out = output.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for(range<1>(size), optimized_kernel(in, out));
+    });
+
+    auto out =
+        output.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      auto value = expected(static_cast<float>(i) / size);
+      if (std::fabs(out[i] - value) > 1e-4f) {
+        debug() << i << "expected" << value << "actual" << out[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include "../common.h"
+
+#include <SYCL/detail/src_handlers/kernel_fusion.h>
+
+// Chained element-wise kernels are fused into one,
+// a kernel reading other elements is not
+
+int main() {
+  using namespace cl::sycl;
+  using detail::kernel_ns::fusion;
+
+  static const int size = 1024;
+
+  fusion::set_enabled(true);
+
+  {
+    queue myQueue;
+    buffer<int> a(size);
+    buffer<int> b(size);
+    buffer<int> c(size);
+    buffer<int> d(size);
+
+    myQueue.submit([&](handler& cgh) {
+      auto wa = a.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class init>(range<1>(size),
+                                   [=](id<1> i) { wa[i] = i * 3; });
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto ra = a.get_access<access::mode::read>(cgh);
+      auto wb = b.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class twice>(range<1>(size),
+                                    [=](id<1> i) { wb[i] = ra[i] * 2; });
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto rb = b.get_access<access::mode::read>(cgh);
+      auto wc = c.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class increment>(range<1>(size),
+                                        [=](id<1> i) { wc[i] = rb[i] + 1; });
+    });
+    // Reads elements written by other work-items
+    myQueue.submit([&](handler& cgh) {
+      auto ra = a.get_access<access::mode::read>(cgh);
+      auto wd = d.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class reverse>(
+          range<1>(size), [=](id<1> i) { wd[i] = ra[size - i[0] - 1]; });
+    });
+    myQueue.wait();
+
+    auto stats = fusion::get_stats();
+    debug() << stats.fused << "kernels fused," << stats.loads_forwarded
+            << "loads forwarded";
+    if (stats.fused != 2 || stats.loads_forwarded < 2) {
+      debug() << "expected 2 fused kernels and 2 loads forwarded";
+      return 1;
+    }
+
+    auto ha = a.get_access<access::mode::read, access::target::host_buffer>();
+    auto hb = b.get_access<access::mode::read, access::target::host_buffer>();
+    auto hc = c.get_access<access::mode::read, access::target::host_buffer>();
+    auto hd = d.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      if (ha[i] != i * 3 || hb[i] != i * 6 || hc[i] != i * 6 + 1 ||
+          hd[i] != (size - i - 1) * 3) {
+        debug() << i << "actual" << ha[i] << hb[i] << hc[i] << hd[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include "../common.h"
+
+// Temporary buffers reuse the device memory of destroyed ones
+
+using namespace cl::sycl;
+using detail::mem_pool;
+
+static bool fill_and_check(queue& myQueue, int size, int value) {
+  buffer<int> temp(size);
+  myQueue.submit([&](handler& cgh) {
+    auto t = temp.get_access<access::mode::discard_write>(cgh);
+    cgh.parallel_for<class fill>(range<1>(size),
+                                 [=](id<1> i) { t[i] = i + value; });
+  });
+  auto h = temp.get_access<access::mode::read, access::target::host_buffer>();
+  for (int i = 0; i < size; ++i) {
+    if (h[i] != i + value) {
+      debug() << i << "expected" << i + value << "actual" << h[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  static const int size = 1000;
+  static const int iterations = 10;
+
+  if (mem_pool::get_size_class(1) != mem_pool::min_size ||
+      mem_pool::get_size_class(1024) != 1024 ||
+      mem_pool::get_size_class(1025) != 1280 ||
+      mem_pool::get_size_class(4000 * sizeof(int)) != 16384) {
+    debug() << "wrong size classes";
+    return 1;
+  }
+
+  mem_pool::set_max_bytes(64 * 1024 * 1024);
+  // Otherwise host unified memory would map host storage instead
+  detail::buffer_base::set_zero_copy(false);
+
+  {
+    queue myQueue;
+    auto before = mem_pool::get_stats();
+
+    for (int n = 0; n < iterations; ++n) {
+      if (!fill_and_check(myQueue, size, n)) {
+        return 1;
+      }
+    }
+    auto after = mem_pool::get_stats();
+    auto allocations = after.allocations - before.allocations;
+    auto reuses = after.reuses - before.reuses;
+    debug() << "allocations" << allocations << "reuses" << reuses;
+    if (allocations != 1 || reuses != iterations - 1 || after.cached != 1) {
+      debug() << "temporary buffers were not reused";
+      return 1;
+    }
+
+    // Same size class
+    if (!fill_and_check(myQueue, size - 10, 0) ||
+        mem_pool::get_stats().allocations != after.allocations) {
+      debug() << "buffer of the same size class not reused";
+      return 1;
+    }
+    // Larger size class
+    if (!fill_and_check(myQueue, 4 * size, 0) ||
+        mem_pool::get_stats().allocations != after.allocations + 1 ||
+        mem_pool::get_stats().cached != 2) {
+      debug() << "larger buffer reused smaller memory";
+      return 1;
+    }
+
+    mem_pool::trim();
+    auto trimmed = mem_pool::get_stats();
+    if (trimmed.cached != 0 || trimmed.bytes_cached != 0 ||
+        trimmed.releases != after.releases + 2) {
+      debug() << "memory kept after trimming";
+      return 1;
+    }
+
+    mem_pool::set_max_bytes(0);
+    if (mem_pool::is_enabled() || !fill_and_check(myQueue, size, 0) ||
+        mem_pool::get_stats().allocations != trimmed.allocations) {
+      debug() << "pool used while disabled";
+      return 1;
+    }
+  }
+
+  return 0;
+}
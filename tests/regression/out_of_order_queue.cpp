@@ -0,0 +1,196 @@
+#include "../common.h"
+
+#include <algorithm>
+#include <thread>
+
+// Independent command groups overlap on an out-of-order queue,
+// and only wait for the command groups they depend on
+
+using namespace cl::sycl;
+
+struct interval {
+  ::cl_ulong start;
+  ::cl_ulong end;
+};
+
+static interval get_interval(const detail::task_graph::node& n) {
+  interval result = {~::cl_ulong(0), 0};
+  for (auto& e : n.commands) {
+    result.start = std::min(
+        result.start,
+        e.get_profiling_info<info::event_profiling::command_start>());
+    result.end = std::max(
+        result.end, e.get_profiling_info<info::event_profiling::command_end>());
+  }
+  return result;
+}
+
+static const int size = 1024;
+static const int groups = 8;
+static const int iterations = 4096;
+
+static handler_event fill(queue& myQueue, buffer<int>& data, int n) {
+  return myQueue.submit([&](handler& cgh) {
+    auto out = data.get_access<access::mode::discard_write>(cgh);
+    auto value = scalar_arg<int>(n);
+    // Long enough for the fills to run at the same time
+    cgh.parallel_for<class fill>(range<1>(size), [=](id<1> i) {
+      int1 x = i;
+      SYCL_FOR(int1 k = 0, k < iterations, ++k) {
+        x += value;
+      }
+      SYCL_END;
+      out[i] = x;
+    });
+  });
+}
+
+static bool check_fills(vector_class<buffer<int>>& buffers) {
+  for (int n = 0; n < groups; ++n) {
+    auto h = buffers[n].get_access<access::mode::read,
+                                   access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      auto expected = i + n * iterations;
+      if (h[i] != expected) {
+        debug() << n << i << "expected" << expected << "actual" << h[i];
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main() {
+  context ctx;
+  auto dev = ctx.get_devices()[0];
+  auto properties = dev.get_info<info::device::queue_properties>();
+  bool supported = (properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0;
+
+  {
+    queue myQueue(ctx, dev, true, true);
+    auto& nodes = myQueue.get_task_graph().get_nodes();
+
+    vector_class<buffer<int>> buffers;
+    vector_class<handler_event> submitted;
+    for (int n = 0; n < groups; ++n) {
+      buffers.emplace_back(size);
+    }
+    {
+      // Keeps the fills from being flushed, completing and being retired
+      // before all of them are submitted
+      using host_acc_t =
+          accessor<int, 1, access::mode::read, access::target::host_buffer>;
+      vector_class<host_acc_t> holds;
+      for (auto& buf : buffers) {
+        holds.push_back(buf.get_access<access::mode::read,
+                                       access::target::host_buffer>());
+      }
+      for (int n = 0; n < groups; ++n) {
+        submitted.push_back(fill(myQueue, buffers[n], n));
+      }
+    }
+
+    // Nodes keep their events until the next submit or wait retires them
+    for (auto& e : submitted) {
+      while (!e.is_complete()) {
+        std::this_thread::yield();
+      }
+    }
+    vector_class<interval> intervals;
+    for (int n = 0; n < groups; ++n) {
+      if (nodes[n]->commands.empty()) {
+        debug() << "fill" << n << "has no commands";
+        return 1;
+      }
+      intervals.push_back(get_interval(*nodes[n]));
+    }
+
+    // In-order pooled queues would run at most one fill each at a time
+    static const int pooled_queues = 4;
+    int most_concurrent = 0;
+    for (int n = 0; n < groups; ++n) {
+      int concurrent = 0;
+      for (int m = 0; m < groups; ++m) {
+        if (intervals[m].start <= intervals[n].start &&
+            intervals[n].start < intervals[m].end) {
+          ++concurrent;
+        }
+      }
+      most_concurrent = std::max(most_concurrent, concurrent);
+    }
+    debug() << most_concurrent << "command groups ran at the same time";
+    if (!supported) {
+      debug() << "out-of-order execution not supported, overlap not checked";
+    } else if (most_concurrent <= pooled_queues) {
+      debug() << "expected more than" << pooled_queues;
+      return 1;
+    }
+
+    // Fills of fresh buffers followed by a sum depending on the first two
+    vector_class<buffer<int>> more;
+    for (int n = 0; n < groups; ++n) {
+      more.emplace_back(size);
+    }
+    auto first = nodes.size();
+    for (int n = 0; n < groups; ++n) {
+      fill(myQueue, more[n], n);
+    }
+    buffer<int> sum(size);
+    myQueue.submit([&](handler& cgh) {
+      auto a = more[0].get_access<access::mode::read>(cgh);
+      auto b = more[1].get_access<access::mode::read>(cgh);
+      auto out = sum.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class add>(range<1>(size),
+                                  [=](id<1> i) { out[i] = a[i] + b[i]; });
+    });
+
+    // Commands only wait for the events of their predecessors
+    if (nodes.size() != first + groups + 1) {
+      debug() << "expected" << groups + 1 << "new nodes, got"
+              << nodes.size() - first;
+      return 1;
+    }
+    for (int n = 0; n < groups; ++n) {
+      auto& node = nodes[first + n];
+      if (!node->predecessors.empty()) {
+        debug() << "fill" << n << "waits for" << node->predecessors.size()
+                << "command groups";
+        return 1;
+      }
+    }
+    // A fill without an edge must have completed and been retired
+    auto& edges = nodes[first + groups]->predecessors;
+    for (auto& e : edges) {
+      if (e.from_id != nodes[first]->id && e.from_id != nodes[first + 1]->id) {
+        debug() << "the sum should only wait for the first two fills";
+        return 1;
+      }
+    }
+    for (int n = 0; n < 2; ++n) {
+      auto& node = nodes[first + n];
+      bool found = std::any_of(edges.begin(), edges.end(),
+                               [&](const detail::task_graph::edge& e) {
+                                 return e.from_id == node->id;
+                               });
+      if (!found && !node->is_complete()) {
+        debug() << "the sum does not wait for fill" << n;
+        return 1;
+      }
+    }
+    myQueue.wait();
+
+    if (!check_fills(buffers) || !check_fills(more)) {
+      return 1;
+    }
+    auto h = sum.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      auto expected = 2 * i + iterations;
+      if (h[i] != expected) {
+        debug() << i << "expected" << expected << "actual" << h[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
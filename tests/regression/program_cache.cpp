@@ -0,0 +1,47 @@
+#include "../common.h"
+
+#include <SYCL/detail/program_cache.h>
+
+// Repeated submissions of the same kernel reuse the compiled program
+
+int main() {
+  using namespace cl::sycl;
+  using detail::program_cache;
+
+  static const int size = 1024;
+  static const int repeat = 5;
+
+  {
+    queue myQueue;
+    buffer<int> data(size);
+
+    auto before = program_cache::get_stats();
+
+    for (int n = 0; n < repeat; ++n) {
+      myQueue.submit([&](handler& cgh) {
+        auto d = data.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class fill>(range<1>(size),
+                                     [=](id<1> i) { d[i] = i * 2; });
+      });
+    }
+
+    auto after = program_cache::get_stats();
+    auto misses = after.misses - before.misses;
+    auto hits = after.hits - before.hits;
+    if (misses != 1 || hits != repeat - 1) {
+      debug() << "expected 1 miss and" << repeat - 1 << "hits, got" << misses
+              << "misses and" << hits << "hits";
+      return 1;
+    }
+
+    auto d = data.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      if (d[i] != i * 2) {
+        debug() << i << "expected" << i * 2 << "actual" << d[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include "../common.h"
+
+#include <SYCL/detail/program_cache.h>
+#include <cstring>
+
+// Scalars passed as kernel arguments instead of being written into the source
+
+using namespace cl::sycl;
+
+static const char* scale_source =
+    "__kernel void scale(__global int* data, int factor) {\n"
+    "  int i = get_global_id(0);\n"
+    "  data[i] = i * factor;\n"
+    "}\n";
+
+static bool check(buffer<int>& data, int factor, int offset) {
+  auto d = data.get_access<access::mode::read, access::target::host_buffer>();
+  for (int i = 0; i < static_cast<int>(data.get_count()); ++i) {
+    auto expected = i * factor + offset;
+    if (d[i] != expected) {
+      debug() << i << "expected" << expected << "actual" << d[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  using detail::program_cache;
+
+  static const int size = 1024;
+  static const int repeat = 5;
+
+  {
+    queue myQueue;
+    buffer<int> data(size);
+
+    auto before = program_cache::get_stats();
+
+    for (int n = 1; n <= repeat; ++n) {
+      myQueue.submit([&](handler& cgh) {
+        auto d = data.get_access<access::mode::discard_write>(cgh);
+        auto factor = scalar_arg<int>(n);
+        auto offset = scalar_arg<int>(7, true);
+        cgh.parallel_for<class scale_functor>(
+            range<1>(size), [=](id<1> i) { d[i] = i * factor + offset; });
+      });
+      if (!check(data, n, 7)) {
+        return 1;
+      }
+    }
+
+    auto misses = program_cache::get_stats().misses - before.misses;
+    if (misses != 1) {
+      debug() << "expected 1 miss, got" << misses;
+      return 1;
+    }
+
+    // Kernel objects from OpenCL C take their arguments from set_arg
+    auto ctx = myQueue.get_context();
+    ::size_t length = std::strlen(scale_source);
+    ::cl_int error_code;
+    auto prog = clCreateProgramWithSource(ctx.get(), 1, &scale_source, &length,
+                                          &error_code);
+    detail::error::report(error_code);
+    error_code = clBuildProgram(prog, 0, nullptr, nullptr, nullptr, nullptr);
+    detail::error::report(error_code);
+    auto k = clCreateKernel(prog, "scale", &error_code);
+    detail::error::report(error_code);
+    kernel scale(k);
+    clReleaseKernel(k);
+    clReleaseProgram(prog);
+
+    myQueue.submit([&](handler& cgh) {
+      auto d = data.get_access<access::mode::discard_write>(cgh);
+      cgh.set_arg(0, d);
+      cgh.set_arg(1, 3);
+      cgh.parallel_for(range<1>(size), scale);
+    });
+    if (!check(data, 3, 0)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
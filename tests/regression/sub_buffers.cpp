@@ -0,0 +1,293 @@
+#include "../common.h"
+
+// Sub-buffers only move their own region between the host and the device
+
+using namespace cl::sycl;
+using detail::buffer_base;
+
+int main() {
+  static const int size = 4096;
+  static const int width = 64;
+  static const int height = 64;
+
+  // Transfers are counted, mapping would avoid them
+  buffer_base::set_zero_copy(false);
+
+  vector_class<int> line(size, 1);
+  vector_class<int> matrix(width * height, 0);
+
+  {
+    queue myQueue;
+
+    buffer<int> whole(line.data(), size);
+    buffer<int, 2> grid(matrix.data(), range<2>(width, height));
+
+    auto before = buffer_base::get_transfer_stats();
+    {
+      buffer<int> part(whole, id<1>(1024), range<1>(1024));
+      myQueue.submit([&](handler& cgh) {
+        auto p = part.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class increment>(range<1>(1024),
+                                          [=](id<1> i) { p[i] += 1; });
+      });
+
+      // Not aligned for an OpenCL sub-buffer, copied instead
+      buffer<int> odd(whole, id<1>(3), range<1>(5));
+      myQueue.submit([&](handler& cgh) {
+        auto o = odd.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class increment_odd>(range<1>(5),
+                                              [=](id<1> i) { o[i] += 2; });
+      });
+
+      // Rows 16 to 23, columns 8 to 23
+      buffer<int, 2> tile(grid, id<2>(8, 16), range<2>(16, 8));
+      myQueue.submit([&](handler& cgh) {
+        auto t = tile.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class fill>(
+            range<2>(16, 8), [=](id<2> i) { t[i] = i[0] + i[1] * 100 + 1; });
+      });
+
+      auto h = tile.get_access<access::mode::read,
+                               access::target::host_buffer>();
+      if (h[15][7] != 716) {
+        debug() << "host accessor of the tile read" << h[15][7];
+        return 1;
+      }
+    }
+    myQueue.wait();
+
+    auto after = buffer_base::get_transfer_stats();
+    auto bytes = after.bytes_transferred - before.bytes_transferred;
+    // The 1024 and 5 elements up and back, the tile only back
+    ::size_t expected = (2 * 1024 + 2 * 5 + 16 * 8) * sizeof(int);
+    if (bytes != expected) {
+      debug() << "expected" << expected << "bytes transferred, got" << bytes;
+      return 1;
+    }
+  }
+
+  for (int i = 0; i < size; ++i) {
+    auto expected = (i >= 1024 && i < 2048) ? 2 : (i >= 3 && i < 8) ? 3 : 1;
+    if (line[i] != expected) {
+      debug() << i << "expected" << expected << "actual" << line[i];
+      return 1;
+    }
+  }
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      auto inside = (x >= 8 && x < 24 && y >= 16 && y < 24);
+      auto expected = inside ? (x - 8) + (y - 16) * 100 + 1 : 0;
+      auto actual = matrix[x + y * width];
+      if (actual != expected) {
+        debug() << x << y << "expected" << expected << "actual" << actual;
+        return 1;
+      }
+    }
+  }
+
+  // The parent sees what kernels write through its sub-buffers
+  {
+    queue myQueue;
+    buffer<int> whole(size);
+    buffer<int> copy(size);
+    myQueue.submit([&](handler& cgh) {
+      auto w = whole.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class init>(range<1>(size), [=](id<1> i) { w[i] = i; });
+    });
+
+    auto read_whole = [&]() {
+      myQueue.submit([&](handler& cgh) {
+        auto w = whole.get_access<access::mode::read>(cgh);
+        auto c = copy.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class read_whole>(range<1>(size),
+                                           [=](id<1> i) { c[i] = w[i]; });
+      });
+    };
+    // Negated by the sub-buffers so far
+    auto check = [&](bool part_done, bool odd_done, const char* what) {
+      auto h = whole.get_access<access::mode::read,
+                                access::target::host_buffer>();
+      auto c = copy.get_access<access::mode::read,
+                               access::target::host_buffer>();
+      for (int i = 0; i < size; ++i) {
+        auto negated = (part_done && i >= 1024 && i < 2048) ||
+                       (odd_done && i >= 3 && i < 8);
+        auto expected = negated ? -i : i;
+        if (h[i] != expected || c[i] != expected) {
+          debug() << what << i << "expected" << expected << "actual" << h[i]
+                  << "and" << c[i] << "in the kernel";
+          return false;
+        }
+      }
+      return true;
+    };
+
+    read_whole();
+    if (!check(false, false, "parent")) {
+      return 1;
+    }
+
+    // Both the host and the device data of the parent are up to date
+    read_whole();
+    if (!check(false, false, "parent")) {
+      return 1;
+    }
+
+    // Both the host and the device data of the parent are up to date
+    {
+      buffer<int> part(whole, id<1>(1024), range<1>(1024));
+      myQueue.submit([&](handler& cgh) {
+        auto p = part.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class negate>(range<1>(1024),
+                                       [=](id<1> i) { p[i] = 0 - p[i]; });
+      });
+      read_whole();
+      if (!check(true, false, "sub-buffer")) {
+        return 1;
+      }
+    }
+
+    {
+      buffer<int> odd(whole, id<1>(3), range<1>(5));
+      myQueue.submit([&](handler& cgh) {
+        auto o = odd.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class negate_odd>(
+            range<1>(5), [=](id<1> i) { o[i] = 0 - o[i]; });
+      });
+    }
+    read_whole();
+    if (!check(true, true, "copied sub-buffer")) {
+      return 1;
+    }
+  }
+
+  // Host accessors of sub-buffers only move their region,
+  // the parents keep their data on the device
+  {
+    queue myQueue;
+    buffer<int> whole(size);
+    buffer<int, 2> grid(range<2>(width, height));
+    myQueue.submit([&](handler& cgh) {
+      auto w = whole.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class init_whole>(range<1>(size),
+                                         [=](id<1> i) { w[i] = i; });
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto g = grid.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class init_grid>(
+          range<2>(width, height), [=](id<2> i) { g[i] = i[0] + i[1] * 100; });
+    });
+
+    auto before = buffer_base::get_transfer_stats();
+    {
+      buffer<int> part(whole, id<1>(1024), range<1>(1024));
+      auto p = part.get_access<access::mode::read_write,
+                               access::target::host_buffer>();
+      for (int i = 0; i < 1024; ++i) {
+        if (p[i] != 1024 + i) {
+          debug() << "part" << i << "expected" << 1024 + i << "actual" << p[i];
+          return 1;
+        }
+        p[i] = -p[i];
+      }
+    }
+    {
+      buffer<int, 2> tile(grid, id<2>(8, 16), range<2>(16, 8));
+      auto t = tile.get_access<access::mode::read_write,
+                               access::target::host_buffer>();
+      for (int x = 0; x < 16; ++x) {
+        for (int y = 0; y < 8; ++y) {
+          auto expected = (x + 8) + (y + 16) * 100;
+          if (t[x][y] != expected) {
+            debug() << "tile" << x << y << "expected" << expected << "actual"
+                    << t[x][y];
+            return 1;
+          }
+          t[x][y] = -expected;
+        }
+      }
+    }
+
+    // Kernels using the parents see what the host wrote
+    buffer<int> whole_copy(size);
+    buffer<int, 2> grid_copy(range<2>(width, height));
+    myQueue.submit([&](handler& cgh) {
+      auto w = whole.get_access<access::mode::read>(cgh);
+      auto c = whole_copy.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class copy_whole>(range<1>(size),
+                                         [=](id<1> i) { c[i] = w[i]; });
+    });
+    myQueue.submit([&](handler& cgh) {
+      auto g = grid.get_access<access::mode::read>(cgh);
+      auto c = grid_copy.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class copy_grid>(range<2>(width, height),
+                                        [=](id<2> i) { c[i] = g[i]; });
+    });
+    myQueue.wait();
+
+    auto after = buffer_base::get_transfer_stats();
+    auto bytes = after.bytes_transferred - before.bytes_transferred;
+    // Both regions back and forth, nothing else of the parents
+    ::size_t expected = (2 * 1024 + 2 * 16 * 8) * sizeof(int);
+    if (bytes != expected) {
+      debug() << "expected" << expected << "bytes transferred, got" << bytes;
+      return 1;
+    }
+
+    {
+      auto c = whole_copy.get_access<access::mode::read,
+                                     access::target::host_buffer>();
+      for (int i = 0; i < size; ++i) {
+        auto expected = (i >= 1024 && i < 2048) ? -i : i;
+        if (c[i] != expected) {
+          debug() << "whole" << i << "expected" << expected << "actual" << c[i];
+          return 1;
+        }
+      }
+      auto g = grid_copy.get_access<access::mode::read,
+                                    access::target::host_buffer>();
+      for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          auto inside = (x >= 8 && x < 24 && y >= 16 && y < 24);
+          auto expected = inside ? -(x + y * 100) : x + y * 100;
+          if (g[x][y] != expected) {
+            debug() << "grid" << x << y << "expected" << expected << "actual"
+                    << g[x][y];
+            return 1;
+          }
+        }
+      }
+    }
+
+    // Same for host tasks, written back before the next command group
+    {
+      buffer<int> part(whole, id<1>(1024), range<1>(1024));
+      myQueue.submit([&](handler& cgh) {
+        auto p = part.get_access<access::mode::read_write,
+                                 access::target::host_buffer>(cgh);
+        cgh.host_task([=]() mutable {
+          for (int i = 0; i < 1024; ++i) {
+            p[i] = 0 - p[i];
+          }
+        });
+      });
+    }
+    myQueue.submit([&](handler& cgh) {
+      auto w = whole.get_access<access::mode::read>(cgh);
+      auto c = whole_copy.get_access<access::mode::discard_write>(cgh);
+      cgh.parallel_for<class copy_again>(range<1>(size),
+                                         [=](id<1> i) { c[i] = w[i]; });
+    });
+    auto again = whole_copy.get_access<access::mode::read,
+                                       access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      if (again[i] != i) {
+        debug() << "host task" << i << "expected" << i << "actual"
+                << again[i];
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
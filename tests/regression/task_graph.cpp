@@ -0,0 +1,93 @@
+#include "../common.h"
+
+#include <sstream>
+
+// Command groups only depend on the earlier ones they conflict with
+
+int main() {
+  using namespace cl::sycl;
+
+  static const int size = 1024;
+
+  {
+    queue myQueue;
+    buffer<int> a(size);
+    buffer<int> b(size);
+    buffer<int> c(size);
+
+    {
+      // Keeps the command groups from completing, and being retired,
+      // before all of them are submitted
+      auto hold_a =
+          a.get_access<access::mode::read, access::target::host_buffer>();
+      auto hold_b =
+          b.get_access<access::mode::read, access::target::host_buffer>();
+
+      // Independent of each other
+      myQueue.submit([&](handler& cgh) {
+        auto out = a.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class fill_a>(range<1>(size),
+                                       [=](id<1> i) { out[i] = i; });
+      });
+      myQueue.submit([&](handler& cgh) {
+        auto out = b.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class fill_b>(range<1>(size),
+                                       [=](id<1> i) { out[i] = i * 2; });
+      });
+
+      // Read after write of both
+      myQueue.submit([&](handler& cgh) {
+        auto in_a = a.get_access<access::mode::read>(cgh);
+        auto in_b = b.get_access<access::mode::read>(cgh);
+        auto out = c.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class add>(range<1>(size), [=](id<1> i) {
+          out[i] = in_a[i] + in_b[i];
+        });
+      });
+
+      // Write after read and write after write
+      myQueue.submit([&](handler& cgh) {
+        auto out = a.get_access<access::mode::discard_write>(cgh);
+        cgh.parallel_for<class clear_a>(range<1>(size),
+                                        [=](id<1> i) { out[i] = 0; });
+      });
+    }
+
+    auto& graph = myQueue.get_task_graph();
+    std::stringstream dot;
+    graph.dump(dot);
+    debug() << dot.str();
+
+    auto stats = graph.get_stats();
+    if (stats.nodes != 4 || stats.edges != 4 || stats.critical_path != 3) {
+      debug() << "expected 4 nodes, 4 edges and a critical path of 3, got"
+              << stats.nodes << stats.edges << stats.critical_path;
+      return 1;
+    }
+
+    auto h = c.get_access<access::mode::read, access::target::host_buffer>();
+    for (int i = 0; i < size; ++i) {
+      if (h[i] != i * 3) {
+        debug() << i << "expected" << i * 3 << "actual" << h[i];
+        return 1;
+      }
+    }
+
+    // Retired nodes don't keep their events, only the edges
+    myQueue.wait();
+    ::size_t edges = 0;
+    for (auto& n : graph.get_nodes()) {
+      if (n->completion.get() != nullptr || !n->commands.empty()) {
+        debug() << "node" << n->id << "still holds its events";
+        return 1;
+      }
+      edges += n->predecessors.size();
+    }
+    if (edges != stats.edges) {
+      debug() << "expected" << stats.edges << "edges, got" << edges;
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "../common.h"
+
+#include <SYCL/detail/src_handlers/trace_cache.h>
+
+// Kernels are traced once per kernel name and rebound to later command groups
+
+using namespace cl::sycl;
+using detail::kernel_ns::trace_cache;
+
+static const int size = 1024;
+
+// Runs on the host each time the kernel functor is traced
+static int traced = 0;
+
+static void scale(queue& myQueue, buffer<int>& in, buffer<int>& out, int n,
+                  int baked) {
+  myQueue.submit([&](handler& cgh) {
+    auto i_acc = in.get_access<access::mode::read>(cgh);
+    auto o_acc = out.get_access<access::mode::discard_write>(cgh);
+    auto factor = scalar_arg<int>(n);
+    auto counter = &traced;
+    cgh.parallel_for<class scale>(range<1>(size), [=](id<1> i) {
+      ++*counter;
+      o_acc[i] = i_acc[i] * factor + baked;
+    });
+  });
+}
+
+static bool check(buffer<int>& out, int factor, int baked) {
+  auto h = out.get_access<access::mode::read, access::target::host_buffer>();
+  for (int i = 0; i < size; ++i) {
+    auto expected = i * factor + baked;
+    if (h[i] != expected) {
+      debug() << i << "expected" << expected << "actual" << h[i];
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  trace_cache::set_enabled(true);
+
+  {
+    queue myQueue;
+    vector_class<buffer<int>> inputs;
+    vector_class<buffer<int>> outputs;
+    for (int n = 0; n < 3; ++n) {
+      inputs.emplace_back(size);
+      outputs.emplace_back(size);
+      auto h = inputs[n].get_access<access::mode::discard_write,
+                                    access::target::host_buffer>();
+      for (int i = 0; i < size; ++i) {
+        h[i] = i;
+      }
+    }
+
+    // Other buffers and scalar values each time
+    for (int n = 0; n < 3; ++n) {
+      scale(myQueue, inputs[n], outputs[n], n + 2, 5);
+    }
+    for (int n = 0; n < 3; ++n) {
+      if (!check(outputs[n], n + 2, 5)) {
+        return 1;
+      }
+    }
+
+#if SYCL_ENABLE_DEBUG
+    // Still traced every time, to be compared
+    static const int expected = 3;
+#else
+    static const int expected = 1;
+#endif
+    if (traced != expected) {
+      debug() << "expected" << expected << "traces, got" << traced;
+      return 1;
+    }
+
+#if SYCL_ENABLE_DEBUG
+    // The captured value is part of the traced source
+    bool reported = false;
+    try {
+      scale(myQueue, inputs[0], outputs[0], 2, 6);
+    } catch (exception& e) {
+      debug() << "reported:" << e.what();
+      reported = true;
+    }
+    if (!reported) {
+      debug() << "changed kernel not reported";
+      return 1;
+    }
+#endif
+  }
+
+  trace_cache::set_enabled(false);
+  return 0;
+}
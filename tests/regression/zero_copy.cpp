@@ -0,0 +1,72 @@
+#include "../common.h"
+
+// On host unified memory buffers are mapped instead of copied
+
+int main() {
+  using namespace cl::sycl;
+  using detail::buffer_base;
+
+  static const int size = 1024;
+  static const int steps = 4;
+
+  vector_class<int> host(size);
+  for (int i = 0; i < size; ++i) {
+    host[i] = i;
+  }
+
+  {
+    queue myQueue;
+    if (!myQueue.get_device().get_info<info::device::host_unified_memory>()) {
+      debug() << "device does not share memory with the host, skipping";
+      return 0;
+    }
+    buffer_base::set_zero_copy(true);
+
+    auto before = buffer_base::get_transfer_stats();
+    buffer<int> data(host.data(), size);
+
+    auto increment = [&]() {
+      myQueue.submit([&](handler& cgh) {
+        auto d = data.get_access<access::mode::read_write>(cgh);
+        cgh.parallel_for<class increment>(range<1>(size),
+                                          [=](id<1> i) { d[i] += 1; });
+      });
+    };
+
+    for (int n = 0; n < steps; ++n) {
+      increment();
+    }
+    {
+      auto d = data.get_access<access::mode::read_write,
+                               access::target::host_buffer>();
+      for (int i = 0; i < size; ++i) {
+        if (d[i] != i + steps) {
+          debug() << i << "expected" << i + steps << "actual" << d[i];
+          return 1;
+        }
+        d[i] *= 2;
+      }
+    }
+    increment();
+    myQueue.wait();
+
+    auto after = buffer_base::get_transfer_stats();
+    auto uploads = after.uploads - before.uploads;
+    auto downloads = after.downloads - before.downloads;
+    if (uploads != 0 || downloads != 0 || after.maps == before.maps) {
+      debug() << "expected only maps, got" << uploads << "uploads and"
+              << downloads << "downloads";
+      return 1;
+    }
+  }
+
+  // The buffer was unmapped when destroyed
+  for (int i = 0; i < size; ++i) {
+    if (host[i] != (i + steps) * 2 + 1) {
+      debug() << i << "expected" << (i + steps) * 2 + 1 << "actual" << host[i];
+      return 1;
+    }
+  }
+
+  return 0;
+}